@@ -0,0 +1,207 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+#include "capture_format.h"
+#include "log.h"
+
+namespace vulkan_d3d12_interop::capture {
+
+    // Streams records to a capture file. Records are appended to a buffer and written by a background thread, so the
+    // calling threads never wait for the disk. Records are dropped when the writer cannot keep up.
+    class CaptureWriter {
+      public:
+        using Clock = std::chrono::steady_clock;
+
+        CaptureWriter() = default;
+        CaptureWriter(const CaptureWriter&) = delete;
+        CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+        // The writer should be closed by now (see close()). Otherwise, this might run from the destructor of a static
+        // object under the loader lock, where waiting for a thread deadlocks: the writer thread is told to stop and
+        // left to finish on its own, with the state that it shares. The reference on the module taken by open() is
+        // kept, so that the DLL is never unloaded under the thread.
+        ~CaptureWriter() {
+            if (m_isOpen) {
+                log::ErrorLog("Capture was not closed, the module stays loaded until the writer thread exits\n");
+                {
+                    std::unique_lock lock(m_state->mutex);
+                    m_state->stop = true;
+                }
+                m_state->wakeUp.notify_one();
+                m_thread.detach();
+            }
+        }
+
+        void open(const std::filesystem::path& path) {
+            auto state = std::make_shared<State>();
+            state->file.open(path, std::ios_base::binary | std::ios_base::trunc);
+            if (!state->file.is_open()) {
+                log::ErrorLog("Failed to open capture file %s\n", path.string().c_str());
+                return;
+            }
+
+            FileHeader header{};
+            memcpy(header.magic, Magic, sizeof(Magic));
+            header.version = Version;
+            state->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+            // Keep the module loaded while the writer thread runs its code.
+            if (!GetModuleHandleExW(
+                    GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, reinterpret_cast<LPCWSTR>(&Magic), &m_module)) {
+                log::ErrorLog("Failed to pin the module: %lu\n", GetLastError());
+                return;
+            }
+
+            m_origin = Clock::now();
+            m_state = std::move(state);
+            m_thread = std::thread([state = m_state] { writerThread(*state); });
+            m_isOpen = true;
+            log::Log("Capturing calls to %s\n", path.string().c_str());
+        }
+
+        // Flush the pending records and wait for the writer thread. Must not be called under the loader lock.
+        void close() {
+            if (!m_isOpen) {
+                return;
+            }
+            {
+                std::unique_lock lock(m_state->mutex);
+                m_state->stop = true;
+            }
+            m_state->wakeUp.notify_one();
+            m_thread.join();
+            m_state->file.close();
+            FreeLibrary(m_module);
+            m_module = nullptr;
+            m_isOpen = false;
+
+            log::Log("Capture: wrote %.1f MB, dropped %llu records\n",
+                     m_state->writtenBytes / (1024.0 * 1024.0),
+                     m_droppedCount);
+        }
+
+        bool isOpen() const {
+            return m_isOpen;
+        }
+
+        // The payload of a record being written.
+        class Payload {
+          public:
+            Payload(std::vector<uint8_t>& buffer) : m_buffer(buffer) {
+            }
+
+            template <typename T>
+            void append(const T& value) {
+                const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+                m_buffer.insert(m_buffer.end(), bytes, bytes + sizeof(T));
+            }
+
+          private:
+            std::vector<uint8_t>& m_buffer;
+        };
+
+        // Append a record for a call that started at the given time and ends now. The serializer appends the
+        // payload, directly into the pending buffer.
+        template <typename Serializer>
+        void writeWith(RecordType type, Clock::time_point start, XrResult result, Serializer&& serialize) {
+            const auto now = Clock::now();
+
+            RecordHeader header{};
+            header.type = type;
+            header.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_origin).count();
+            header.durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count();
+            header.result = result;
+
+            State& state = *m_state;
+            std::unique_lock lock(state.mutex);
+            if (state.pending.size() >= MaxPendingBytes) {
+                m_droppedCount++;
+                return;
+            }
+            const size_t offset = state.pending.size();
+            Payload payload(state.pending);
+            payload.append(header);
+            serialize(payload);
+            reinterpret_cast<RecordHeader*>(&state.pending[offset])->size =
+                (uint32_t)(state.pending.size() - offset - sizeof(header));
+            lock.unlock();
+            state.wakeUp.notify_one();
+        }
+
+        template <typename T>
+        void write(RecordType type, Clock::time_point start, XrResult result, const T& record) {
+            writeWith(type, start, result, [&](Payload& payload) { payload.append(record); });
+        }
+
+      private:
+        // The state shared with the writer thread, which outlives the writer if it is not closed.
+        struct State {
+            std::ofstream file;
+
+            std::mutex mutex;
+            std::condition_variable wakeUp;
+            std::vector<uint8_t> pending;
+            bool stop{false};
+
+            uint64_t writtenBytes{0};
+        };
+
+        // The writer thread swaps the pending buffer with its own, so the buffers keep their storage.
+        static void writerThread(State& state) {
+            std::vector<uint8_t> writing;
+            std::unique_lock lock(state.mutex);
+            while (true) {
+                state.wakeUp.wait(lock, [&] { return state.stop || !state.pending.empty(); });
+                const bool stop = state.stop;
+                std::swap(writing, state.pending);
+                lock.unlock();
+
+                if (!writing.empty()) {
+                    state.file.write(reinterpret_cast<const char*>(writing.data()), writing.size());
+                    state.writtenBytes += writing.size();
+                    writing.clear();
+                }
+                if (stop) {
+                    state.file.flush();
+                    break;
+                }
+
+                lock.lock();
+            }
+        }
+
+        static constexpr size_t MaxPendingBytes = 16 * 1024 * 1024;
+
+        bool m_isOpen{false};
+        HMODULE m_module{nullptr};
+        Clock::time_point m_origin;
+        std::shared_ptr<State> m_state;
+        std::thread m_thread;
+
+        uint64_t m_droppedCount{0};
+    };
+
+} // namespace vulkan_d3d12_interop::capture
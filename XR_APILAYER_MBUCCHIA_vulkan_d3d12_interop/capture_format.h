@@ -0,0 +1,121 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+
+// The format of the capture files. It has no dependencies, so that the captures can be read on any platform (see
+// tests/chain/replay.cpp).
+
+namespace vulkan_d3d12_interop::capture {
+
+    // The capture file starts with a FileHeader, followed by records. Each record is a RecordHeader followed by
+    // RecordHeader::size bytes of payload. The structures are packed and little-endian, and the handles are the values
+    // seen by the application. Timestamps are relative to the opening of the capture. See scripts/dump_capture.py.
+    constexpr char Magic[8] = {'X', 'R', 'V', 'K', 'C', 'A', 'P', 'T'};
+    constexpr uint32_t Version = 1;
+
+    enum class RecordType : uint32_t {
+        CreateSession = 1,
+        DestroySession,
+        CreateSwapchain,
+        DestroySwapchain,
+        AcquireSwapchainImage,
+        WaitSwapchainImage,
+        ReleaseSwapchainImage,
+        EndFrame,
+    };
+
+    enum class Api : uint32_t { Passthrough, Vulkan, OpenGL };
+
+#pragma pack(push, 1)
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+    };
+
+    struct RecordHeader {
+        RecordType type;
+        uint32_t size;
+        uint64_t timestampNs;
+        uint64_t durationNs;
+        int32_t result;
+        uint32_t reserved;
+    };
+
+    struct SessionRecord {
+        uint64_t session;
+        Api api;
+        uint32_t reserved;
+    };
+
+    struct CreateSwapchainRecord {
+        uint64_t session;
+        uint64_t swapchain;
+        int64_t format;
+        uint64_t usageFlags;
+        uint64_t createFlags;
+        uint32_t sampleCount;
+        uint32_t width;
+        uint32_t height;
+        uint32_t faceCount;
+        uint32_t arraySize;
+        uint32_t mipCount;
+    };
+
+    struct SwapchainRecord {
+        uint64_t swapchain;
+        // The index for AcquireSwapchainImage, the timeout for WaitSwapchainImage.
+        int64_t value;
+    };
+
+    // Followed by layerCount LayerRecord.
+    struct EndFrameRecord {
+        uint64_t session;
+        int64_t displayTime;
+        uint32_t environmentBlendMode;
+        uint32_t layerCount;
+    };
+
+    // Followed by subImageCount SubImageRecord (one per view of a projection layer, one for the other layers).
+    struct LayerRecord {
+        uint32_t type;
+        uint32_t layerFlags;
+        uint64_t space;
+        uint32_t subImageCount;
+        uint32_t reserved;
+    };
+
+    struct SubImageRecord {
+        uint64_t swapchain;
+        int32_t x;
+        int32_t y;
+        int32_t width;
+        int32_t height;
+        uint32_t imageArrayIndex;
+        uint32_t reserved;
+    };
+#pragma pack(pop)
+
+} // namespace vulkan_d3d12_interop::capture
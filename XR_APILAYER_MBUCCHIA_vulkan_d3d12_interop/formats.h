@@ -0,0 +1,378 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+
+// The registry of the formats that we can translate. It only depends on the format enums of DXGI (dxgiformat.h), Vulkan
+// (vulkan_core.h) and OpenGL (GL/glext.h), which must be included first, so that it can be tested on any platform (see
+// tests/formats_test.cpp).
+
+namespace vulkan_d3d12_interop::util {
+
+    // Everything we know about a format, as seen from each graphics API.
+    struct FormatInfo {
+        DXGI_FORMAT dxgi;
+        VkFormat vk; // VK_FORMAT_UNDEFINED when there is no Vulkan equivalent.
+        GLint gl;    // 0 when there is no OpenGL equivalent.
+
+        // The size of a compression block (1x1 for uncompressed formats) and its size in memory.
+        uint32_t blockWidth;
+        uint32_t blockHeight;
+        uint32_t bytesPerBlock;
+
+        VkImageAspectFlags aspects;
+
+        // Formats that share the same typeless family may alias each other in views and copies.
+        DXGI_FORMAT typeless;
+
+        // The sRGB (resp. linear) counterpart of a linear (resp. sRGB) format.
+        DXGI_FORMAT srgbPair;
+    };
+
+    namespace detail {
+
+        constexpr FormatInfo Texel(DXGI_FORMAT dxgi,
+                                   VkFormat vk,
+                                   GLint gl,
+                                   uint32_t bytes,
+                                   DXGI_FORMAT typeless = DXGI_FORMAT_UNKNOWN,
+                                   DXGI_FORMAT srgbPair = DXGI_FORMAT_UNKNOWN) {
+            return {dxgi, vk, gl, 1, 1, bytes, VK_IMAGE_ASPECT_COLOR_BIT, typeless, srgbPair};
+        }
+
+        constexpr FormatInfo DepthStencil(DXGI_FORMAT dxgi,
+                                          VkFormat vk,
+                                          GLint gl,
+                                          uint32_t bytes,
+                                          VkImageAspectFlags aspects,
+                                          DXGI_FORMAT typeless) {
+            return {dxgi, vk, gl, 1, 1, bytes, aspects, typeless, DXGI_FORMAT_UNKNOWN};
+        }
+
+        constexpr FormatInfo Block(DXGI_FORMAT dxgi,
+                                   VkFormat vk,
+                                   GLint gl,
+                                   uint32_t width,
+                                   uint32_t height,
+                                   uint32_t bytes,
+                                   DXGI_FORMAT typeless = DXGI_FORMAT_UNKNOWN,
+                                   DXGI_FORMAT srgbPair = DXGI_FORMAT_UNKNOWN) {
+            return {dxgi, vk, gl, width, height, bytes, VK_IMAGE_ASPECT_COLOR_BIT, typeless, srgbPair};
+        }
+
+        constexpr VkImageAspectFlags Depth = VK_IMAGE_ASPECT_DEPTH_BIT;
+        constexpr VkImageAspectFlags DepthStencilAspects = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+
+    } // namespace detail
+
+    // The formats that we can translate. When several DXGI formats map to the same Vulkan or OpenGL format, the first
+    // one in this table is the one used for the reverse translation.
+    // Vulkan mappings based on https://github.com/doitsujin/dxvk/blob/master/src/dxgi/dxgi_format.cpp
+    // OpenGL mappings based on
+    // https://chromium.googlesource.com/angle/angle/+/34cc136a689711ee7f64f90b2de9b07cfb9a9f17/src/libANGLE/renderer/d3d/d3d11/formatutils11.cpp
+    constexpr FormatInfo Formats[] = {
+        // clang-format off
+        detail::Texel(DXGI_FORMAT_R32G32B32A32_FLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, GL_RGBA32F, 16, DXGI_FORMAT_R32G32B32A32_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R32G32B32A32_UINT, VK_FORMAT_R32G32B32A32_UINT, GL_RGBA32UI, 16, DXGI_FORMAT_R32G32B32A32_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R32G32B32A32_SINT, VK_FORMAT_R32G32B32A32_SINT, GL_RGBA32I, 16, DXGI_FORMAT_R32G32B32A32_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R32G32B32_FLOAT, VK_FORMAT_R32G32B32_SFLOAT, GL_RGB32F, 12, DXGI_FORMAT_R32G32B32_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32_UINT, GL_RGB32UI, 12, DXGI_FORMAT_R32G32B32_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32_SINT, GL_RGB32I, 12, DXGI_FORMAT_R32G32B32_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16G16B16A16_FLOAT, VK_FORMAT_R16G16B16A16_SFLOAT, GL_RGBA16F, 8, DXGI_FORMAT_R16G16B16A16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R16G16B16A16_UNORM, 0, 8, DXGI_FORMAT_R16G16B16A16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16G16B16A16_UINT, VK_FORMAT_R16G16B16A16_UINT, GL_RGBA16UI, 8, DXGI_FORMAT_R16G16B16A16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16G16B16A16_SNORM, VK_FORMAT_R16G16B16A16_SNORM, 0, 8, DXGI_FORMAT_R16G16B16A16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16G16B16A16_SINT, VK_FORMAT_R16G16B16A16_SINT, GL_RGBA16I, 8, DXGI_FORMAT_R16G16B16A16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R32G32_FLOAT, VK_FORMAT_R32G32_SFLOAT, GL_RG32F, 8, DXGI_FORMAT_R32G32_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R32G32_UINT, VK_FORMAT_R32G32_UINT, GL_RG32UI, 8, DXGI_FORMAT_R32G32_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R32G32_SINT, VK_FORMAT_R32G32_SINT, GL_RG32I, 8, DXGI_FORMAT_R32G32_TYPELESS),
+        detail::DepthStencil(DXGI_FORMAT_D32_FLOAT_S8X24_UINT, VK_FORMAT_D32_SFLOAT_S8_UINT, GL_DEPTH32F_STENCIL8, 8, detail::DepthStencilAspects, DXGI_FORMAT_R32G8X24_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R10G10B10A2_UNORM, VK_FORMAT_A2B10G10R10_UNORM_PACK32, GL_RGB10_A2, 4, DXGI_FORMAT_R10G10B10A2_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R10G10B10A2_UINT, VK_FORMAT_A2B10G10R10_UINT_PACK32, GL_RGB10_A2UI, 4, DXGI_FORMAT_R10G10B10A2_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R11G11B10_FLOAT, VK_FORMAT_B10G11R11_UFLOAT_PACK32, GL_R11F_G11F_B10F, 4),
+        detail::Texel(DXGI_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, GL_RGBA8, 4, DXGI_FORMAT_R8G8B8A8_TYPELESS, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB),
+        detail::Texel(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, VK_FORMAT_R8G8B8A8_SRGB, GL_SRGB8_ALPHA8, 4, DXGI_FORMAT_R8G8B8A8_TYPELESS, DXGI_FORMAT_R8G8B8A8_UNORM),
+        detail::Texel(DXGI_FORMAT_R8G8B8A8_UINT, VK_FORMAT_R8G8B8A8_UINT, GL_RGBA8UI, 4, DXGI_FORMAT_R8G8B8A8_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R8G8B8A8_SNORM, VK_FORMAT_R8G8B8A8_SNORM, GL_RGBA8_SNORM, 4, DXGI_FORMAT_R8G8B8A8_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R8G8B8A8_SINT, VK_FORMAT_R8G8B8A8_SINT, GL_RGBA8I, 4, DXGI_FORMAT_R8G8B8A8_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16G16_FLOAT, VK_FORMAT_R16G16_SFLOAT, GL_RG16F, 4, DXGI_FORMAT_R16G16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16_UNORM, 0, 4, DXGI_FORMAT_R16G16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16G16_UINT, VK_FORMAT_R16G16_UINT, GL_RG16UI, 4, DXGI_FORMAT_R16G16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16_SNORM, 0, 4, DXGI_FORMAT_R16G16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16G16_SINT, VK_FORMAT_R16G16_SINT, GL_RG16I, 4, DXGI_FORMAT_R16G16_TYPELESS),
+        detail::DepthStencil(DXGI_FORMAT_D32_FLOAT, VK_FORMAT_D32_SFLOAT, GL_DEPTH_COMPONENT32F, 4, detail::Depth, DXGI_FORMAT_R32_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R32_FLOAT, VK_FORMAT_R32_SFLOAT, GL_R32F, 4, DXGI_FORMAT_R32_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R32_UINT, VK_FORMAT_R32_UINT, GL_R32UI, 4, DXGI_FORMAT_R32_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R32_SINT, VK_FORMAT_R32_SINT, GL_R32I, 4, DXGI_FORMAT_R32_TYPELESS),
+        detail::DepthStencil(DXGI_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, GL_DEPTH24_STENCIL8, 4, detail::DepthStencilAspects, DXGI_FORMAT_R24G8_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8_UNORM, GL_RG8, 2, DXGI_FORMAT_R8G8_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R8G8_UINT, VK_FORMAT_R8G8_UINT, GL_RG8UI, 2, DXGI_FORMAT_R8G8_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R8G8_SNORM, VK_FORMAT_R8G8_SNORM, GL_RG8_SNORM, 2, DXGI_FORMAT_R8G8_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R8G8_SINT, VK_FORMAT_R8G8_SINT, GL_RG8I, 2, DXGI_FORMAT_R8G8_TYPELESS),
+        // OpenGL depth formats are imported as R16_TYPELESS first.
+        detail::DepthStencil(DXGI_FORMAT_R16_TYPELESS, VK_FORMAT_UNDEFINED, GL_DEPTH_COMPONENT16, 2, detail::Depth, DXGI_FORMAT_R16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16_FLOAT, VK_FORMAT_R16_SFLOAT, GL_R16F, 2, DXGI_FORMAT_R16_TYPELESS),
+        detail::DepthStencil(DXGI_FORMAT_D16_UNORM, VK_FORMAT_D16_UNORM, GL_DEPTH_COMPONENT16, 2, detail::Depth, DXGI_FORMAT_R16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16_UNORM, VK_FORMAT_R16_UNORM, GL_DEPTH_COMPONENT16, 2, DXGI_FORMAT_R16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16_UINT, VK_FORMAT_R16_UINT, GL_R16UI, 2, DXGI_FORMAT_R16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16_SNORM, VK_FORMAT_R16_SNORM, 0, 2, DXGI_FORMAT_R16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R16_SINT, VK_FORMAT_R16_SINT, GL_R16I, 2, DXGI_FORMAT_R16_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R8_UNORM, VK_FORMAT_R8_UNORM, GL_R8, 1, DXGI_FORMAT_R8_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R8_UINT, VK_FORMAT_R8_UINT, GL_R8UI, 1, DXGI_FORMAT_R8_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R8_SNORM, VK_FORMAT_R8_SNORM, GL_R8_SNORM, 1, DXGI_FORMAT_R8_TYPELESS),
+        detail::Texel(DXGI_FORMAT_R8_SINT, VK_FORMAT_R8_SINT, GL_R8I, 1, DXGI_FORMAT_R8_TYPELESS),
+        detail::Texel(DXGI_FORMAT_A8_UNORM, VK_FORMAT_R8_UNORM, GL_ALPHA8_EXT, 1),
+        detail::Texel(DXGI_FORMAT_R9G9B9E5_SHAREDEXP, VK_FORMAT_E5B9G9R9_UFLOAT_PACK32, GL_RGB9_E5, 4),
+        detail::Block(DXGI_FORMAT_R8G8_B8G8_UNORM, VK_FORMAT_B8G8R8G8_422_UNORM, 0, 2, 1, 4),
+        detail::Block(DXGI_FORMAT_G8R8_G8B8_UNORM, VK_FORMAT_G8B8G8R8_422_UNORM, 0, 2, 1, 4),
+        detail::Block(DXGI_FORMAT_BC1_UNORM, VK_FORMAT_BC1_RGBA_UNORM_BLOCK, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 4, 4, 8, DXGI_FORMAT_BC1_TYPELESS, DXGI_FORMAT_BC1_UNORM_SRGB),
+        detail::Block(DXGI_FORMAT_BC1_UNORM_SRGB, VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 0, 4, 4, 8, DXGI_FORMAT_BC1_TYPELESS, DXGI_FORMAT_BC1_UNORM),
+        detail::Block(DXGI_FORMAT_BC2_UNORM, VK_FORMAT_BC2_UNORM_BLOCK, 0, 4, 4, 16, DXGI_FORMAT_BC2_TYPELESS, DXGI_FORMAT_BC2_UNORM_SRGB),
+        detail::Block(DXGI_FORMAT_BC2_UNORM_SRGB, VK_FORMAT_BC2_SRGB_BLOCK, 0, 4, 4, 16, DXGI_FORMAT_BC2_TYPELESS, DXGI_FORMAT_BC2_UNORM),
+        detail::Block(DXGI_FORMAT_BC3_UNORM, VK_FORMAT_BC3_UNORM_BLOCK, 0, 4, 4, 16, DXGI_FORMAT_BC3_TYPELESS, DXGI_FORMAT_BC3_UNORM_SRGB),
+        detail::Block(DXGI_FORMAT_BC3_UNORM_SRGB, VK_FORMAT_BC3_SRGB_BLOCK, 0, 4, 4, 16, DXGI_FORMAT_BC3_TYPELESS, DXGI_FORMAT_BC3_UNORM),
+        detail::Block(DXGI_FORMAT_BC4_UNORM, VK_FORMAT_BC4_UNORM_BLOCK, 0, 4, 4, 8, DXGI_FORMAT_BC4_TYPELESS),
+        detail::Block(DXGI_FORMAT_BC4_SNORM, VK_FORMAT_BC4_SNORM_BLOCK, 0, 4, 4, 8, DXGI_FORMAT_BC4_TYPELESS),
+        detail::Block(DXGI_FORMAT_BC5_UNORM, VK_FORMAT_BC5_UNORM_BLOCK, 0, 4, 4, 16, DXGI_FORMAT_BC5_TYPELESS),
+        detail::Block(DXGI_FORMAT_BC5_SNORM, VK_FORMAT_BC5_SNORM_BLOCK, 0, 4, 4, 16, DXGI_FORMAT_BC5_TYPELESS),
+        detail::Texel(DXGI_FORMAT_B5G6R5_UNORM, VK_FORMAT_R5G6B5_UNORM_PACK16, 0, 2),
+        detail::Texel(DXGI_FORMAT_B5G5R5A1_UNORM, VK_FORMAT_A1R5G5B5_UNORM_PACK16, 0, 2),
+        detail::Texel(DXGI_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_B8G8R8A8_UNORM, 0, 4, DXGI_FORMAT_B8G8R8A8_TYPELESS, DXGI_FORMAT_B8G8R8A8_UNORM_SRGB),
+        detail::Texel(DXGI_FORMAT_B8G8R8X8_UNORM, VK_FORMAT_B8G8R8A8_UNORM, 0, 4, DXGI_FORMAT_B8G8R8X8_TYPELESS, DXGI_FORMAT_B8G8R8X8_UNORM_SRGB),
+        detail::Texel(DXGI_FORMAT_B8G8R8A8_UNORM_SRGB, VK_FORMAT_B8G8R8A8_SRGB, 0, 4, DXGI_FORMAT_B8G8R8A8_TYPELESS, DXGI_FORMAT_B8G8R8A8_UNORM),
+        detail::Texel(DXGI_FORMAT_B8G8R8X8_UNORM_SRGB, VK_FORMAT_B8G8R8A8_SRGB, 0, 4, DXGI_FORMAT_B8G8R8X8_TYPELESS, DXGI_FORMAT_B8G8R8X8_UNORM),
+        detail::Block(DXGI_FORMAT_BC6H_UF16, VK_FORMAT_BC6H_UFLOAT_BLOCK, 0, 4, 4, 16, DXGI_FORMAT_BC6H_TYPELESS),
+        detail::Block(DXGI_FORMAT_BC6H_SF16, VK_FORMAT_BC6H_SFLOAT_BLOCK, 0, 4, 4, 16, DXGI_FORMAT_BC6H_TYPELESS),
+        detail::Block(DXGI_FORMAT_BC7_UNORM, VK_FORMAT_BC7_UNORM_BLOCK, 0, 4, 4, 16, DXGI_FORMAT_BC7_TYPELESS, DXGI_FORMAT_BC7_UNORM_SRGB),
+        detail::Block(DXGI_FORMAT_BC7_UNORM_SRGB, VK_FORMAT_BC7_SRGB_BLOCK, 0, 4, 4, 16, DXGI_FORMAT_BC7_TYPELESS, DXGI_FORMAT_BC7_UNORM),
+        detail::Texel(DXGI_FORMAT_AYUV, VK_FORMAT_R8G8B8A8_UNORM, 0, 4),
+        detail::Texel(DXGI_FORMAT_Y410, VK_FORMAT_A2B10G10R10_UNORM_PACK32, 0, 4),
+        // 4 luma samples and one pair of chroma samples for each 2x2 block.
+        detail::Block(DXGI_FORMAT_420_OPAQUE, VK_FORMAT_G8_B8R8_2PLANE_420_UNORM, 0, 2, 2, 6),
+        detail::Block(DXGI_FORMAT_YUY2, VK_FORMAT_G8B8G8R8_422_UNORM, 0, 2, 1, 4),
+        detail::Texel(DXGI_FORMAT_B4G4R4A4_UNORM, VK_FORMAT_A4R4G4B4_UNORM_PACK16_EXT, 0, 2),
+        // clang-format on
+    };
+
+    namespace detail {
+
+        // DXGI formats are small consecutive values, we index them directly.
+        constexpr size_t DxgiIndexSize = 256;
+
+        // Vulkan and OpenGL formats are sparse, we use an open-addressing hash table (linear probing). The slots hold
+        // the index in the Formats table plus one, 0 meaning an empty slot.
+        constexpr size_t HashIndexSize = 256;
+
+        constexpr size_t HashFormat(uint32_t value) {
+            return (size_t)((value * 2654435761u) >> 24) & (HashIndexSize - 1);
+        }
+
+        constexpr std::array<uint8_t, DxgiIndexSize> BuildDxgiIndex() {
+            std::array<uint8_t, DxgiIndexSize> index{};
+            for (size_t i = 0; i < std::size(Formats); i++) {
+                index[Formats[i].dxgi] = (uint8_t)(i + 1);
+            }
+            return index;
+        }
+
+        // Only the first entry for a given value is inserted.
+        template <typename T>
+        constexpr std::array<uint8_t, HashIndexSize> BuildHashIndex(T FormatInfo::*field) {
+            std::array<uint8_t, HashIndexSize> index{};
+            for (size_t i = 0; i < std::size(Formats); i++) {
+                const uint32_t value = (uint32_t)(Formats[i].*field);
+                if (!value) {
+                    continue;
+                }
+                for (size_t slot = HashFormat(value);; slot = (slot + 1) & (HashIndexSize - 1)) {
+                    if (!index[slot]) {
+                        index[slot] = (uint8_t)(i + 1);
+                        break;
+                    }
+                    if ((uint32_t)(Formats[index[slot] - 1].*field) == value) {
+                        break;
+                    }
+                }
+            }
+            return index;
+        }
+
+        constexpr auto DxgiIndex = BuildDxgiIndex();
+        constexpr auto VkIndex = BuildHashIndex(&FormatInfo::vk);
+        constexpr auto GlIndex = BuildHashIndex(&FormatInfo::gl);
+
+        template <typename T>
+        constexpr const FormatInfo* LookupHashIndex(const std::array<uint8_t, HashIndexSize>& index,
+                                                    T FormatInfo::*field,
+                                                    uint32_t value) {
+            if (!value) {
+                return nullptr;
+            }
+            for (size_t slot = HashFormat(value);; slot = (slot + 1) & (HashIndexSize - 1)) {
+                if (!index[slot]) {
+                    return nullptr;
+                }
+                if ((uint32_t)(Formats[index[slot] - 1].*field) == value) {
+                    return &Formats[index[slot] - 1];
+                }
+            }
+        }
+
+    } // namespace detail
+
+    // Lookup a format from its value in any of the graphics APIs. Returns nullptr for unknown formats.
+    constexpr const FormatInfo* GetFormatInfo(DXGI_FORMAT format) {
+        if ((size_t)format >= detail::DxgiIndexSize || !detail::DxgiIndex[format]) {
+            return nullptr;
+        }
+        return &Formats[detail::DxgiIndex[format] - 1];
+    }
+
+    constexpr const FormatInfo* GetFormatInfoFromVk(VkFormat format) {
+        return detail::LookupHashIndex(detail::VkIndex, &FormatInfo::vk, (uint32_t)format);
+    }
+
+    constexpr const FormatInfo* GetFormatInfoFromGl(GLint format) {
+        return detail::LookupHashIndex(detail::GlIndex, &FormatInfo::gl, (uint32_t)format);
+    }
+
+    // Whether two formats may alias each other in views and copies.
+    constexpr bool AreFormatsViewCompatible(const FormatInfo& a, const FormatInfo& b) {
+        return a.dxgi == b.dxgi || (a.typeless != DXGI_FORMAT_UNKNOWN && a.typeless == b.typeless);
+    }
+
+    // The size in memory of a region of a single subresource.
+    constexpr uint64_t GetRegionSize(const FormatInfo& format, uint32_t width, uint32_t height) {
+        return (uint64_t)((width + format.blockWidth - 1) / format.blockWidth) *
+               ((height + format.blockHeight - 1) / format.blockHeight) * format.bytesPerBlock;
+    }
+
+    namespace detail {
+
+        constexpr bool IsRegistryConsistent() {
+            for (size_t i = 0; i < std::size(Formats); i++) {
+                const FormatInfo& format = Formats[i];
+                if ((size_t)format.dxgi >= DxgiIndexSize || GetFormatInfo(format.dxgi) != &format) {
+                    return false;
+                }
+                if (!format.blockWidth || !format.blockHeight || !format.bytesPerBlock || !format.aspects) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        constexpr bool HaveSameLayout(const FormatInfo& a, const FormatInfo& b) {
+            return a.blockWidth == b.blockWidth && a.blockHeight == b.blockHeight && a.bytesPerBlock == b.bytesPerBlock;
+        }
+
+        // DXGI -> API -> DXGI must give back the same format, or the first format of the table translating to the
+        // same value, which must then have the same memory layout (eg: B8G8R8X8_UNORM comes back as B8G8R8A8_UNORM).
+        template <typename T>
+        constexpr bool IsRoundTripConsistent(const FormatInfo* (*lookup)(T), T FormatInfo::*field) {
+            for (size_t i = 0; i < std::size(Formats); i++) {
+                const FormatInfo& format = Formats[i];
+                if (!(uint32_t)(format.*field)) {
+                    continue;
+                }
+                const FormatInfo* const reverse = lookup(format.*field);
+                if (!reverse || reverse->*field != format.*field) {
+                    return false;
+                }
+                if (reverse != &format && (reverse > &format || !HaveSameLayout(*reverse, format))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // sRGB pairs must be symmetric, within the same typeless family, and distinct in every API that has both.
+        constexpr bool AreSrgbPairsConsistent() {
+            for (size_t i = 0; i < std::size(Formats); i++) {
+                const FormatInfo& format = Formats[i];
+                if (format.srgbPair == DXGI_FORMAT_UNKNOWN) {
+                    continue;
+                }
+                const FormatInfo* const pair = GetFormatInfo(format.srgbPair);
+                if (!pair || pair->srgbPair != format.dxgi || !AreFormatsViewCompatible(format, *pair) ||
+                    !HaveSameLayout(format, *pair)) {
+                    return false;
+                }
+                if (format.vk != VK_FORMAT_UNDEFINED && pair->vk == format.vk) {
+                    return false;
+                }
+                if (format.gl && pair->gl == format.gl) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        constexpr bool IsBlockCompressed(DXGI_FORMAT format) {
+            return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+                   (format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+        }
+
+        // BC formats use 4x4 blocks of 8 bytes (BC1, BC4) or 16 bytes (others), and they are the only 4x4 formats.
+        constexpr bool AreBlockSizesConsistent() {
+            for (size_t i = 0; i < std::size(Formats); i++) {
+                const FormatInfo& format = Formats[i];
+                const bool is4x4 = format.blockWidth == 4 && format.blockHeight == 4;
+                if (IsBlockCompressed(format.dxgi) != is4x4) {
+                    return false;
+                }
+                if (!is4x4) {
+                    continue;
+                }
+                const bool is8Bytes =
+                    (format.dxgi >= DXGI_FORMAT_BC1_TYPELESS && format.dxgi <= DXGI_FORMAT_BC1_UNORM_SRGB) ||
+                    (format.dxgi >= DXGI_FORMAT_BC4_TYPELESS && format.dxgi <= DXGI_FORMAT_BC4_SNORM);
+                if (format.bytesPerBlock != (is8Bytes ? 8u : 16u)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    } // namespace detail
+
+    static_assert(std::size(Formats) < 255, "Format indices must fit in uint8_t");
+    static_assert(detail::IsRegistryConsistent(), "Format registry is inconsistent");
+    static_assert(detail::IsRoundTripConsistent(&GetFormatInfoFromVk, &FormatInfo::vk),
+                  "DXGI -> Vulkan -> DXGI translation is inconsistent");
+    static_assert(detail::IsRoundTripConsistent(&GetFormatInfoFromGl, &FormatInfo::gl),
+                  "DXGI -> OpenGL -> DXGI translation is inconsistent");
+    static_assert(detail::AreSrgbPairsConsistent(), "sRGB pairs are inconsistent");
+    static_assert(detail::AreBlockSizesConsistent(), "BC block sizes are inconsistent");
+    static_assert(GetFormatInfoFromVk(VK_FORMAT_R8_UNORM)->dxgi == DXGI_FORMAT_R8_UNORM);
+    static_assert(GetFormatInfoFromVk(VK_FORMAT_B8G8R8A8_SRGB)->dxgi == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB);
+    static_assert(GetFormatInfoFromGl(GL_DEPTH_COMPONENT16)->dxgi == DXGI_FORMAT_R16_TYPELESS);
+    static_assert(GetFormatInfo(DXGI_FORMAT_D24_UNORM_S8_UINT)->aspects ==
+                  (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT));
+    static_assert(GetRegionSize(*GetFormatInfo(DXGI_FORMAT_BC1_UNORM), 6, 6) == 4 * 8);
+    static_assert(!GetFormatInfo(DXGI_FORMAT_UNKNOWN) && !GetFormatInfoFromVk(VK_FORMAT_UNDEFINED));
+
+} // namespace vulkan_d3d12_interop::util
@@ -38,6 +38,125 @@ namespace LAYER_NAMESPACE {
     std::mutex g_bypassLock;
     std::map<XrInstance, PFN_xrGetInstanceProcAddr> g_bypass;
 
+    namespace {
+
+        // The discovery cache remembers the extensions reported upstream of the layer, so that we do not need to
+        // create a dummy instance on every start. It is keyed by the active runtime manifest (path and modification
+        // time), the layers downstream of ours, and our own version. Any change to these invalidates the cache.
+        constexpr const char* DiscoveryCacheVersion = "1";
+
+        std::optional<std::filesystem::path> getDiscoveryCachePath() {
+            const char* const localAppData = getenv("LOCALAPPDATA");
+            if (!localAppData || !*localAppData) {
+                return {};
+            }
+            return std::filesystem::path(localAppData) / (LayerName + ".cache");
+        }
+
+        std::optional<std::filesystem::path> getActiveRuntimeManifest() {
+            // The loader lets this environment variable override the registry.
+            const char* const overridePath = getenv("XR_RUNTIME_JSON");
+            if (overridePath && *overridePath) {
+                return overridePath;
+            }
+
+            char path[MAX_PATH]{};
+            DWORD pathSize = sizeof(path);
+            if (::RegGetValueA(HKEY_LOCAL_MACHINE,
+                               "SOFTWARE\\Khronos\\OpenXR\\1",
+                               "ActiveRuntime",
+                               RRF_RT_REG_SZ,
+                               nullptr,
+                               path,
+                               &pathSize) != ERROR_SUCCESS) {
+                return {};
+            }
+            return path;
+        }
+
+        // Returns nothing when the cache cannot be used, in which case we fall back to the dummy instance.
+        std::optional<std::string> getDiscoveryCacheKey(const XrApiLayerNextInfo* downstream) {
+            const auto manifest = getActiveRuntimeManifest();
+            if (!manifest || !getDiscoveryCachePath()) {
+                return {};
+            }
+
+            std::error_code ec;
+            const auto lastWriteTime = std::filesystem::last_write_time(*manifest, ec);
+            if (ec) {
+                return {};
+            }
+
+            std::stringstream key;
+            key << VersionString << "|" << manifest->string() << "|" << lastWriteTime.time_since_epoch().count();
+            for (auto info = downstream; info; info = info->next) {
+                key << "|" << info->layerName;
+            }
+            return key.str();
+        }
+
+        std::optional<std::vector<std::string>> readDiscoveryCache(const std::string& key) {
+            const auto path = getDiscoveryCachePath();
+            if (!path) {
+                return {};
+            }
+
+            std::ifstream file(*path);
+            if (!file.is_open()) {
+                return {};
+            }
+
+            std::string line;
+            if (!std::getline(file, line) || line != DiscoveryCacheVersion || !std::getline(file, line) ||
+                line != key) {
+                return {};
+            }
+
+            std::vector<std::string> extensions;
+            while (std::getline(file, line)) {
+                if (!line.empty()) {
+                    extensions.push_back(line);
+                }
+            }
+            return extensions;
+        }
+
+        void writeDiscoveryCache(const std::string& key, const std::vector<std::string>& extensions) {
+            // Write to a temporary file first, so that a concurrent process never reads a partial cache.
+            const auto path = getDiscoveryCachePath();
+            if (!path) {
+                return;
+            }
+            auto tempPath = *path;
+            tempPath += fmt::format(".{}", GetCurrentProcessId());
+            {
+                std::ofstream file(tempPath, std::ios_base::trunc);
+                if (!file.is_open()) {
+                    return;
+                }
+                file << DiscoveryCacheVersion << "\n" << key << "\n";
+                for (const auto& extension : extensions) {
+                    file << extension << "\n";
+                }
+
+                // Close the file before checking for errors, since writing the buffered content may still fail.
+                file.close();
+                if (file.fail()) {
+                    std::error_code ec;
+                    std::filesystem::remove(tempPath, ec);
+                    return;
+                }
+            }
+
+            std::error_code ec;
+            std::filesystem::rename(tempPath, *path, ec);
+            if (ec) {
+                std::filesystem::remove(tempPath, ec);
+            }
+        }
+
+    } // namespace
+
     // Entry point for creating the layer.
     XrResult XRAPI_CALL xrCreateApiLayerInstance(const XrInstanceCreateInfo* const instanceCreateInfo,
                                                  const struct XrApiLayerCreateInfo* const apiLayerInfo,
@@ -71,41 +190,73 @@ namespace LAYER_NAMESPACE {
         // While the OpenXR standard states that xrEnumerateInstanceExtensionProperties() can be queried without an
         // instance, this does not stand for API layers, since API layers implementation might rely on the next
         // xrGetInstanceProcAddr() pointer, which is not (yet) populated if no instance is created.
-        // We create a dummy instance in order to do these checks.
+        // We create a dummy instance in order to do these checks, unless the result is in the discovery cache.
         bool need_XR_KHR_vulkan_enable = true;
         bool need_XR_KHR_vulkan_enable2 = true;
         bool need_XR_KHR_opengl_enable = true;
         {
-            XrInstance dummyInstance = XR_NULL_HANDLE;
+            const auto cacheKey = getDiscoveryCacheKey(apiLayerInfo->nextInfo->next);
+            std::optional<std::vector<std::string>> extensions;
+            if (cacheKey) {
+                extensions = readDiscoveryCache(*cacheKey);
+                TraceLoggingWrite(g_traceProvider,
+                                  "xrCreateApiLayerInstance_DiscoveryCache",
+                                  TLArg(cacheKey->c_str(), "Key"),
+                                  TLArg(!!extensions, "Hit"));
+                if (extensions) {
+                    Log("Using cached upstream extensions\n");
+                }
+            }
 
-            // Call the chain to create a dummy instance. Request no extensions in order to speed things up.
-            XrInstanceCreateInfo dummyCreateInfo = *instanceCreateInfo;
-            dummyCreateInfo.enabledExtensionCount = 0;
+            if (!extensions) {
+                XrInstance dummyInstance = XR_NULL_HANDLE;
+
+                // Call the chain to create a dummy instance. Request no extensions in order to speed things up.
+                XrInstanceCreateInfo dummyCreateInfo = *instanceCreateInfo;
+                dummyCreateInfo.enabledExtensionCount = 0;
+
+                XrApiLayerCreateInfo chainApiLayerInfo = *apiLayerInfo;
+                chainApiLayerInfo.nextInfo = apiLayerInfo->nextInfo->next;
+
+                if (XR_SUCCEEDED(apiLayerInfo->nextInfo->nextCreateApiLayerInstance(
+                        &dummyCreateInfo, &chainApiLayerInfo, &dummyInstance))) {
+                    // Check the available extensions.
+                    PFN_xrEnumerateInstanceExtensionProperties xrEnumerateInstanceExtensionProperties;
+                    CHECK_XRCMD(apiLayerInfo->nextInfo->nextGetInstanceProcAddr(
+                        dummyInstance,
+                        "xrEnumerateInstanceExtensionProperties",
+                        reinterpret_cast<PFN_xrVoidFunction*>(&xrEnumerateInstanceExtensionProperties)));
+
+                    uint32_t extensionsCount = 0;
+                    CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extensionsCount, nullptr));
+                    std::vector<XrExtensionProperties> properties(extensionsCount, {XR_TYPE_EXTENSION_PROPERTIES});
+                    CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(
+                        nullptr, extensionsCount, &extensionsCount, properties.data()));
+
+                    extensions.emplace();
+                    for (uint32_t i = 0; i < extensionsCount; i++) {
+                        extensions->push_back(properties[i].extensionName);
+                    }
 
-            XrApiLayerCreateInfo chainApiLayerInfo = *apiLayerInfo;
-            chainApiLayerInfo.nextInfo = apiLayerInfo->nextInfo->next;
+                    PFN_xrDestroyInstance xrDestroyInstance;
+                    CHECK_XRCMD(apiLayerInfo->nextInfo->nextGetInstanceProcAddr(
+                        dummyInstance, "xrDestroyInstance", reinterpret_cast<PFN_xrVoidFunction*>(&xrDestroyInstance)));
 
-            if (XR_SUCCEEDED(apiLayerInfo->nextInfo->nextCreateApiLayerInstance(
-                    &dummyCreateInfo, &chainApiLayerInfo, &dummyInstance))) {
-                // Check the available extensions.
-                PFN_xrEnumerateInstanceExtensionProperties xrEnumerateInstanceExtensionProperties;
-                CHECK_XRCMD(apiLayerInfo->nextInfo->nextGetInstanceProcAddr(
-                    dummyInstance,
-                    "xrEnumerateInstanceExtensionProperties",
-                    reinterpret_cast<PFN_xrVoidFunction*>(&xrEnumerateInstanceExtensionProperties)));
+                    CHECK_XRCMD(xrDestroyInstance(dummyInstance));
 
-                uint32_t extensionsCount = 0;
-                CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(nullptr, 0, &extensionsCount, nullptr));
-                std::vector<XrExtensionProperties> extensions(extensionsCount, {XR_TYPE_EXTENSION_PROPERTIES});
-                CHECK_XRCMD(xrEnumerateInstanceExtensionProperties(
-                    nullptr, extensionsCount, &extensionsCount, extensions.data()));
+                    if (cacheKey) {
+                        writeDiscoveryCache(*cacheKey, *extensions);
+                    }
+                }
+            }
 
-                for (uint32_t i = 0; i < extensionsCount; i++) {
+            if (extensions) {
+                for (const auto& extension : *extensions) {
                     TraceLoggingWrite(g_traceProvider,
                                       "xrCreateApiLayerInstance",
-                                      TLArg(extensions[i].extensionName, "AvailableExtension"));
-                    Log("Available extension: %s\n", extensions[i].extensionName);
-                    const std::string_view ext(extensions[i].extensionName);
+                                      TLArg(extension.c_str(), "AvailableExtension"));
+                    Log("Available extension: %s\n", extension.c_str());
+                    const std::string_view ext(extension);
 
                     if (ext == XR_KHR_VULKAN_ENABLE_EXTENSION_NAME) {
                         need_XR_KHR_vulkan_enable = false;
@@ -115,12 +266,6 @@ namespace LAYER_NAMESPACE {
                         need_XR_KHR_opengl_enable = false;
                     }
                 }
-
-                PFN_xrDestroyInstance xrDestroyInstance;
-                CHECK_XRCMD(apiLayerInfo->nextInfo->nextGetInstanceProcAddr(
-                    dummyInstance, "xrDestroyInstance", reinterpret_cast<PFN_xrVoidFunction*>(&xrDestroyInstance)));
-
-                CHECK_XRCMD(xrDestroyInstance(dummyInstance));
             }
         }
 
@@ -171,6 +171,14 @@ namespace LAYER_NAMESPACE
 	private:
 		PFN_xrAcquireSwapchainImage m_xrAcquireSwapchainImage{ nullptr };
 
+	public:
+		virtual XrResult xrWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo)
+		{
+			return m_xrWaitSwapchainImage(swapchain, waitInfo);
+		}
+	private:
+		PFN_xrWaitSwapchainImage m_xrWaitSwapchainImage{ nullptr };
+
 	public:
 		virtual XrResult xrReleaseSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageReleaseInfo* releaseInfo)
 		{
@@ -54,15 +54,9 @@ if 'xrGetInstanceProcAddr' in layer_apis.override_functions:
 if 'xrGetInstanceProcAddr' in layer_apis.requested_functions:
     raise Exception("xrGetInstanceProcAddr() cannot be specified in requested_functions. Use the m_xrGetInstanceProcAddr() class member.")
 
+generated_header_warning = '''// *********** THIS FILE IS GENERATED - DO NOT EDIT ***********'''
 
-class DispatchGenOutputGenerator(AutomaticSourceOutputGenerator):
-    '''Common generator utilities and formatting.'''
-    def outputGeneratedHeaderWarning(self):
-        warning = '''// *********** THIS FILE IS GENERATED - DO NOT EDIT ***********'''
-        write(warning, file=self.outFile)
-
-    def outputCopywriteHeader(self):
-        copyright = '''// MIT License
+copyright_header = '''// MIT License
 //
 // Copyright(c) 2021-2022 Matthieu Bucchianeri
 //
@@ -84,7 +78,15 @@ class DispatchGenOutputGenerator(AutomaticSourceOutputGenerator):
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 '''
-        write(copyright, file=self.outFile)
+
+
+class DispatchGenOutputGenerator(AutomaticSourceOutputGenerator):
+    '''Common generator utilities and formatting.'''
+    def outputGeneratedHeaderWarning(self):
+        write(generated_header_warning, file=self.outFile)
+
+    def outputCopywriteHeader(self):
+        write(copyright_header, file=self.outFile)
 
     def outputGeneratedAuthorNote(self):
         pass
@@ -388,6 +390,81 @@ namespace LAYER_NAMESPACE
                 
         return generated
 
+def genGraphicsDispatch(filename):
+    '''Generator for dispatch_gfx.gen.h: the Vulkan and OpenGL function tables.'''
+    def checkResolved(name, api):
+        return f'''			CHECK_MSG({name}, "{api} does not support {name}");
+'''
+
+    vulkan_members = ''
+    vulkan_resolve = ''
+    for name in ['vkGetDeviceProcAddr'] + layer_apis.vulkan_instance_functions:
+        vulkan_members += f'''		PFN_{name} {name}{{ nullptr }};
+'''
+        vulkan_resolve += f'''			{name} = reinterpret_cast<PFN_{name}>(getInstanceProcAddr(instance, "{name}"));
+'''
+        vulkan_resolve += checkResolved(name, 'Vulkan')
+    for name, extension_name in layer_apis.vulkan_device_promoted_functions.items():
+        vulkan_members += f'''		PFN_{name} {name}{{ nullptr }};
+'''
+        vulkan_resolve += f'''			{name} = reinterpret_cast<PFN_{name}>(vkGetDeviceProcAddr(device, "{name}"));
+			if (!{name}) {{
+				{name} = reinterpret_cast<PFN_{name}>(vkGetDeviceProcAddr(device, "{extension_name}"));
+			}}
+'''
+        vulkan_resolve += checkResolved(name, 'Vulkan')
+    for name in layer_apis.vulkan_device_functions:
+        vulkan_members += f'''		PFN_{name} {name}{{ nullptr }};
+'''
+        vulkan_resolve += f'''			{name} = reinterpret_cast<PFN_{name}>(vkGetDeviceProcAddr(device, "{name}"));
+'''
+        vulkan_resolve += checkResolved(name, 'Vulkan')
+
+    opengl_members = ''
+    opengl_resolve = ''
+    for name in layer_apis.opengl_functions:
+        opengl_members += f'''		PFN{name.upper()}PROC {name}{{ nullptr }};
+'''
+        opengl_resolve += f'''			{name} = reinterpret_cast<PFN{name.upper()}PROC>(wglGetProcAddress("{name}"));
+'''
+        opengl_resolve += checkResolved(name, 'OpenGL driver')
+
+    contents = f'''{generated_header_warning}
+{copyright_header}
+#pragma once
+
+#ifndef LAYER_NAMESPACE
+#error Must define LAYER_NAMESPACE
+#endif
+
+namespace LAYER_NAMESPACE
+{{
+
+	// Auto-generated Vulkan function table. Device functions are resolved for the device, bypassing the loader's
+	// trampoline.
+	struct VulkanDispatch
+	{{
+{vulkan_members}
+		void initialize(PFN_vkGetInstanceProcAddr getInstanceProcAddr, VkInstance instance, VkDevice device)
+		{{
+{vulkan_resolve}		}}
+	}};
+
+	// Auto-generated OpenGL function table. Must be initialized with the application's context current.
+	struct OpenGLDispatch
+	{{
+{opengl_members}
+		void initialize()
+		{{
+{opengl_resolve}		}}
+	}};
+
+}} // namespace LAYER_NAMESPACE
+'''
+
+    with open(filename, 'w') as outFile:
+        outFile.write(contents)
+
 def makeREstring(strings, default=None):
     """Turn a list of strings into a regexp string matching exactly those strings."""
     if strings or default is None:
@@ -415,6 +492,8 @@ if __name__ == '__main__':
             removeExtensions  = None,
             emitExtensions    = extensionsPat))
 
+    genGraphicsDispatch(os.path.join(cur_dir, 'dispatch_gfx.gen.h'))
+
     registry.setGenerator(DispatchGenHOutputGenerator(diagFile=None))
     registry.apiGen(AutomaticSourceGeneratorOptions(conventions       = conventions,
             filename          = 'dispatch.gen.h',
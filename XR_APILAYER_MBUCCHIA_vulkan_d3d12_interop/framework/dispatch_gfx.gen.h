@@ -0,0 +1,175 @@
+// *********** THIS FILE IS GENERATED - DO NOT EDIT ***********
+// MIT License
+//
+// Copyright(c) 2021-2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#ifndef LAYER_NAMESPACE
+#error Must define LAYER_NAMESPACE
+#endif
+
+namespace LAYER_NAMESPACE
+{
+
+	// Auto-generated Vulkan function table. Device functions are resolved for the device, bypassing the loader's
+	// trampoline.
+	struct VulkanDispatch
+	{
+		PFN_vkGetDeviceProcAddr vkGetDeviceProcAddr{ nullptr };
+		PFN_vkGetPhysicalDeviceProperties2 vkGetPhysicalDeviceProperties2{ nullptr };
+		PFN_vkGetPhysicalDeviceMemoryProperties vkGetPhysicalDeviceMemoryProperties{ nullptr };
+		PFN_vkGetImageMemoryRequirements2 vkGetImageMemoryRequirements2{ nullptr };
+		PFN_vkGetDeviceQueue vkGetDeviceQueue{ nullptr };
+		PFN_vkQueueSubmit vkQueueSubmit{ nullptr };
+		PFN_vkCreateImage vkCreateImage{ nullptr };
+		PFN_vkDestroyImage vkDestroyImage{ nullptr };
+		PFN_vkAllocateMemory vkAllocateMemory{ nullptr };
+		PFN_vkFreeMemory vkFreeMemory{ nullptr };
+		PFN_vkCreateCommandPool vkCreateCommandPool{ nullptr };
+		PFN_vkDestroyCommandPool vkDestroyCommandPool{ nullptr };
+		PFN_vkAllocateCommandBuffers vkAllocateCommandBuffers{ nullptr };
+		PFN_vkFreeCommandBuffers vkFreeCommandBuffers{ nullptr };
+		PFN_vkBeginCommandBuffer vkBeginCommandBuffer{ nullptr };
+		PFN_vkCmdPipelineBarrier vkCmdPipelineBarrier{ nullptr };
+		PFN_vkEndCommandBuffer vkEndCommandBuffer{ nullptr };
+		PFN_vkGetMemoryWin32HandlePropertiesKHR vkGetMemoryWin32HandlePropertiesKHR{ nullptr };
+		PFN_vkBindImageMemory vkBindImageMemory{ nullptr };
+		PFN_vkCreateSemaphore vkCreateSemaphore{ nullptr };
+		PFN_vkDestroySemaphore vkDestroySemaphore{ nullptr };
+		PFN_vkImportSemaphoreWin32HandleKHR vkImportSemaphoreWin32HandleKHR{ nullptr };
+		PFN_vkDeviceWaitIdle vkDeviceWaitIdle{ nullptr };
+		PFN_vkCreateFence vkCreateFence{ nullptr };
+		PFN_vkDestroyFence vkDestroyFence{ nullptr };
+		PFN_vkGetFenceStatus vkGetFenceStatus{ nullptr };
+
+		void initialize(PFN_vkGetInstanceProcAddr getInstanceProcAddr, VkInstance instance, VkDevice device)
+		{
+			vkGetDeviceProcAddr = reinterpret_cast<PFN_vkGetDeviceProcAddr>(getInstanceProcAddr(instance, "vkGetDeviceProcAddr"));
+			CHECK_MSG(vkGetDeviceProcAddr, "Vulkan does not support vkGetDeviceProcAddr");
+			vkGetPhysicalDeviceProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(getInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2"));
+			CHECK_MSG(vkGetPhysicalDeviceProperties2, "Vulkan does not support vkGetPhysicalDeviceProperties2");
+			vkGetPhysicalDeviceMemoryProperties = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties>(getInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties"));
+			CHECK_MSG(vkGetPhysicalDeviceMemoryProperties, "Vulkan does not support vkGetPhysicalDeviceMemoryProperties");
+			vkGetImageMemoryRequirements2 = reinterpret_cast<PFN_vkGetImageMemoryRequirements2>(vkGetDeviceProcAddr(device, "vkGetImageMemoryRequirements2"));
+			if (!vkGetImageMemoryRequirements2) {
+				vkGetImageMemoryRequirements2 = reinterpret_cast<PFN_vkGetImageMemoryRequirements2>(vkGetDeviceProcAddr(device, "vkGetImageMemoryRequirements2KHR"));
+			}
+			CHECK_MSG(vkGetImageMemoryRequirements2, "Vulkan does not support vkGetImageMemoryRequirements2");
+			vkGetDeviceQueue = reinterpret_cast<PFN_vkGetDeviceQueue>(vkGetDeviceProcAddr(device, "vkGetDeviceQueue"));
+			CHECK_MSG(vkGetDeviceQueue, "Vulkan does not support vkGetDeviceQueue");
+			vkQueueSubmit = reinterpret_cast<PFN_vkQueueSubmit>(vkGetDeviceProcAddr(device, "vkQueueSubmit"));
+			CHECK_MSG(vkQueueSubmit, "Vulkan does not support vkQueueSubmit");
+			vkCreateImage = reinterpret_cast<PFN_vkCreateImage>(vkGetDeviceProcAddr(device, "vkCreateImage"));
+			CHECK_MSG(vkCreateImage, "Vulkan does not support vkCreateImage");
+			vkDestroyImage = reinterpret_cast<PFN_vkDestroyImage>(vkGetDeviceProcAddr(device, "vkDestroyImage"));
+			CHECK_MSG(vkDestroyImage, "Vulkan does not support vkDestroyImage");
+			vkAllocateMemory = reinterpret_cast<PFN_vkAllocateMemory>(vkGetDeviceProcAddr(device, "vkAllocateMemory"));
+			CHECK_MSG(vkAllocateMemory, "Vulkan does not support vkAllocateMemory");
+			vkFreeMemory = reinterpret_cast<PFN_vkFreeMemory>(vkGetDeviceProcAddr(device, "vkFreeMemory"));
+			CHECK_MSG(vkFreeMemory, "Vulkan does not support vkFreeMemory");
+			vkCreateCommandPool = reinterpret_cast<PFN_vkCreateCommandPool>(vkGetDeviceProcAddr(device, "vkCreateCommandPool"));
+			CHECK_MSG(vkCreateCommandPool, "Vulkan does not support vkCreateCommandPool");
+			vkDestroyCommandPool = reinterpret_cast<PFN_vkDestroyCommandPool>(vkGetDeviceProcAddr(device, "vkDestroyCommandPool"));
+			CHECK_MSG(vkDestroyCommandPool, "Vulkan does not support vkDestroyCommandPool");
+			vkAllocateCommandBuffers = reinterpret_cast<PFN_vkAllocateCommandBuffers>(vkGetDeviceProcAddr(device, "vkAllocateCommandBuffers"));
+			CHECK_MSG(vkAllocateCommandBuffers, "Vulkan does not support vkAllocateCommandBuffers");
+			vkFreeCommandBuffers = reinterpret_cast<PFN_vkFreeCommandBuffers>(vkGetDeviceProcAddr(device, "vkFreeCommandBuffers"));
+			CHECK_MSG(vkFreeCommandBuffers, "Vulkan does not support vkFreeCommandBuffers");
+			vkBeginCommandBuffer = reinterpret_cast<PFN_vkBeginCommandBuffer>(vkGetDeviceProcAddr(device, "vkBeginCommandBuffer"));
+			CHECK_MSG(vkBeginCommandBuffer, "Vulkan does not support vkBeginCommandBuffer");
+			vkCmdPipelineBarrier = reinterpret_cast<PFN_vkCmdPipelineBarrier>(vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier"));
+			CHECK_MSG(vkCmdPipelineBarrier, "Vulkan does not support vkCmdPipelineBarrier");
+			vkEndCommandBuffer = reinterpret_cast<PFN_vkEndCommandBuffer>(vkGetDeviceProcAddr(device, "vkEndCommandBuffer"));
+			CHECK_MSG(vkEndCommandBuffer, "Vulkan does not support vkEndCommandBuffer");
+			vkGetMemoryWin32HandlePropertiesKHR = reinterpret_cast<PFN_vkGetMemoryWin32HandlePropertiesKHR>(vkGetDeviceProcAddr(device, "vkGetMemoryWin32HandlePropertiesKHR"));
+			CHECK_MSG(vkGetMemoryWin32HandlePropertiesKHR, "Vulkan does not support vkGetMemoryWin32HandlePropertiesKHR");
+			vkBindImageMemory = reinterpret_cast<PFN_vkBindImageMemory>(vkGetDeviceProcAddr(device, "vkBindImageMemory"));
+			CHECK_MSG(vkBindImageMemory, "Vulkan does not support vkBindImageMemory");
+			vkCreateSemaphore = reinterpret_cast<PFN_vkCreateSemaphore>(vkGetDeviceProcAddr(device, "vkCreateSemaphore"));
+			CHECK_MSG(vkCreateSemaphore, "Vulkan does not support vkCreateSemaphore");
+			vkDestroySemaphore = reinterpret_cast<PFN_vkDestroySemaphore>(vkGetDeviceProcAddr(device, "vkDestroySemaphore"));
+			CHECK_MSG(vkDestroySemaphore, "Vulkan does not support vkDestroySemaphore");
+			vkImportSemaphoreWin32HandleKHR = reinterpret_cast<PFN_vkImportSemaphoreWin32HandleKHR>(vkGetDeviceProcAddr(device, "vkImportSemaphoreWin32HandleKHR"));
+			CHECK_MSG(vkImportSemaphoreWin32HandleKHR, "Vulkan does not support vkImportSemaphoreWin32HandleKHR");
+			vkDeviceWaitIdle = reinterpret_cast<PFN_vkDeviceWaitIdle>(vkGetDeviceProcAddr(device, "vkDeviceWaitIdle"));
+			CHECK_MSG(vkDeviceWaitIdle, "Vulkan does not support vkDeviceWaitIdle");
+			vkCreateFence = reinterpret_cast<PFN_vkCreateFence>(vkGetDeviceProcAddr(device, "vkCreateFence"));
+			CHECK_MSG(vkCreateFence, "Vulkan does not support vkCreateFence");
+			vkDestroyFence = reinterpret_cast<PFN_vkDestroyFence>(vkGetDeviceProcAddr(device, "vkDestroyFence"));
+			CHECK_MSG(vkDestroyFence, "Vulkan does not support vkDestroyFence");
+			vkGetFenceStatus = reinterpret_cast<PFN_vkGetFenceStatus>(vkGetDeviceProcAddr(device, "vkGetFenceStatus"));
+			CHECK_MSG(vkGetFenceStatus, "Vulkan does not support vkGetFenceStatus");
+		}
+	};
+
+	// Auto-generated OpenGL function table. Must be initialized with the application's context current.
+	struct OpenGLDispatch
+	{
+		PFNGLGETUNSIGNEDBYTEVEXTPROC glGetUnsignedBytevEXT{ nullptr };
+		PFNGLCREATETEXTURESPROC glCreateTextures{ nullptr };
+		PFNGLCREATEMEMORYOBJECTSEXTPROC glCreateMemoryObjectsEXT{ nullptr };
+		PFNGLDELETEMEMORYOBJECTSEXTPROC glDeleteMemoryObjectsEXT{ nullptr };
+		PFNGLTEXTURESTORAGEMEM2DEXTPROC glTextureStorageMem2DEXT{ nullptr };
+		PFNGLTEXTURESTORAGEMEM2DMULTISAMPLEEXTPROC glTextureStorageMem2DMultisampleEXT{ nullptr };
+		PFNGLTEXTURESTORAGEMEM3DEXTPROC glTextureStorageMem3DEXT{ nullptr };
+		PFNGLTEXTURESTORAGEMEM3DMULTISAMPLEEXTPROC glTextureStorageMem3DMultisampleEXT{ nullptr };
+		PFNGLGENSEMAPHORESEXTPROC glGenSemaphoresEXT{ nullptr };
+		PFNGLDELETESEMAPHORESEXTPROC glDeleteSemaphoresEXT{ nullptr };
+		PFNGLSEMAPHOREPARAMETERUI64VEXTPROC glSemaphoreParameterui64vEXT{ nullptr };
+		PFNGLSIGNALSEMAPHOREEXTPROC glSignalSemaphoreEXT{ nullptr };
+		PFNGLIMPORTMEMORYWIN32HANDLEEXTPROC glImportMemoryWin32HandleEXT{ nullptr };
+		PFNGLIMPORTSEMAPHOREWIN32HANDLEEXTPROC glImportSemaphoreWin32HandleEXT{ nullptr };
+
+		void initialize()
+		{
+			glGetUnsignedBytevEXT = reinterpret_cast<PFNGLGETUNSIGNEDBYTEVEXTPROC>(wglGetProcAddress("glGetUnsignedBytevEXT"));
+			CHECK_MSG(glGetUnsignedBytevEXT, "OpenGL driver does not support glGetUnsignedBytevEXT");
+			glCreateTextures = reinterpret_cast<PFNGLCREATETEXTURESPROC>(wglGetProcAddress("glCreateTextures"));
+			CHECK_MSG(glCreateTextures, "OpenGL driver does not support glCreateTextures");
+			glCreateMemoryObjectsEXT = reinterpret_cast<PFNGLCREATEMEMORYOBJECTSEXTPROC>(wglGetProcAddress("glCreateMemoryObjectsEXT"));
+			CHECK_MSG(glCreateMemoryObjectsEXT, "OpenGL driver does not support glCreateMemoryObjectsEXT");
+			glDeleteMemoryObjectsEXT = reinterpret_cast<PFNGLDELETEMEMORYOBJECTSEXTPROC>(wglGetProcAddress("glDeleteMemoryObjectsEXT"));
+			CHECK_MSG(glDeleteMemoryObjectsEXT, "OpenGL driver does not support glDeleteMemoryObjectsEXT");
+			glTextureStorageMem2DEXT = reinterpret_cast<PFNGLTEXTURESTORAGEMEM2DEXTPROC>(wglGetProcAddress("glTextureStorageMem2DEXT"));
+			CHECK_MSG(glTextureStorageMem2DEXT, "OpenGL driver does not support glTextureStorageMem2DEXT");
+			glTextureStorageMem2DMultisampleEXT = reinterpret_cast<PFNGLTEXTURESTORAGEMEM2DMULTISAMPLEEXTPROC>(wglGetProcAddress("glTextureStorageMem2DMultisampleEXT"));
+			CHECK_MSG(glTextureStorageMem2DMultisampleEXT, "OpenGL driver does not support glTextureStorageMem2DMultisampleEXT");
+			glTextureStorageMem3DEXT = reinterpret_cast<PFNGLTEXTURESTORAGEMEM3DEXTPROC>(wglGetProcAddress("glTextureStorageMem3DEXT"));
+			CHECK_MSG(glTextureStorageMem3DEXT, "OpenGL driver does not support glTextureStorageMem3DEXT");
+			glTextureStorageMem3DMultisampleEXT = reinterpret_cast<PFNGLTEXTURESTORAGEMEM3DMULTISAMPLEEXTPROC>(wglGetProcAddress("glTextureStorageMem3DMultisampleEXT"));
+			CHECK_MSG(glTextureStorageMem3DMultisampleEXT, "OpenGL driver does not support glTextureStorageMem3DMultisampleEXT");
+			glGenSemaphoresEXT = reinterpret_cast<PFNGLGENSEMAPHORESEXTPROC>(wglGetProcAddress("glGenSemaphoresEXT"));
+			CHECK_MSG(glGenSemaphoresEXT, "OpenGL driver does not support glGenSemaphoresEXT");
+			glDeleteSemaphoresEXT = reinterpret_cast<PFNGLDELETESEMAPHORESEXTPROC>(wglGetProcAddress("glDeleteSemaphoresEXT"));
+			CHECK_MSG(glDeleteSemaphoresEXT, "OpenGL driver does not support glDeleteSemaphoresEXT");
+			glSemaphoreParameterui64vEXT = reinterpret_cast<PFNGLSEMAPHOREPARAMETERUI64VEXTPROC>(wglGetProcAddress("glSemaphoreParameterui64vEXT"));
+			CHECK_MSG(glSemaphoreParameterui64vEXT, "OpenGL driver does not support glSemaphoreParameterui64vEXT");
+			glSignalSemaphoreEXT = reinterpret_cast<PFNGLSIGNALSEMAPHOREEXTPROC>(wglGetProcAddress("glSignalSemaphoreEXT"));
+			CHECK_MSG(glSignalSemaphoreEXT, "OpenGL driver does not support glSignalSemaphoreEXT");
+			glImportMemoryWin32HandleEXT = reinterpret_cast<PFNGLIMPORTMEMORYWIN32HANDLEEXTPROC>(wglGetProcAddress("glImportMemoryWin32HandleEXT"));
+			CHECK_MSG(glImportMemoryWin32HandleEXT, "OpenGL driver does not support glImportMemoryWin32HandleEXT");
+			glImportSemaphoreWin32HandleEXT = reinterpret_cast<PFNGLIMPORTSEMAPHOREWIN32HANDLEEXTPROC>(wglGetProcAddress("glImportSemaphoreWin32HandleEXT"));
+			CHECK_MSG(glImportSemaphoreWin32HandleEXT, "OpenGL driver does not support glImportSemaphoreWin32HandleEXT");
+		}
+	};
+
+} // namespace LAYER_NAMESPACE
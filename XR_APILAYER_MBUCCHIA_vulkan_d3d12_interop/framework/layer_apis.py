@@ -9,6 +9,7 @@ override_functions = [
     "xrDestroySwapchain",
     "xrEnumerateSwapchainImages",
     "xrAcquireSwapchainImage",
+    "xrWaitSwapchainImage",
     "xrReleaseSwapchainImage",
     "xrEndFrame",
     "xrGetVulkanInstanceExtensionsKHR",
@@ -34,3 +35,61 @@ requested_functions = [
 supported_extensions = ['XR_KHR_vulkan_enable', 'XR_KHR_vulkan_enable2', 'XR_KHR_opengl_enable', 'XR_KHR_D3D12_enable',
                         'XR_KHR_composition_layer_depth', 'XR_KHR_composition_layer_cylinder', 'XR_KHR_composition_layer_equirect',
                         'XR_KHR_composition_layer_equirect2']
+
+# The list of Vulkan functions our layer will use from the application's instance (resolved with
+# vkGetInstanceProcAddr()).
+vulkan_instance_functions = [
+    "vkGetPhysicalDeviceProperties2",
+    "vkGetPhysicalDeviceMemoryProperties",
+]
+
+# The Vulkan device functions that were promoted to core, with the name of the extension function they come from. They
+# are resolved by their core name, or by their extension name for a device created with an older API version.
+vulkan_device_promoted_functions = {
+    "vkGetImageMemoryRequirements2": "vkGetImageMemoryRequirements2KHR",
+}
+
+# The list of Vulkan functions our layer will use from the application's device (resolved with vkGetDeviceProcAddr(),
+# bypassing the loader's trampoline).
+vulkan_device_functions = [
+    "vkGetDeviceQueue",
+    "vkQueueSubmit",
+    "vkCreateImage",
+    "vkDestroyImage",
+    "vkAllocateMemory",
+    "vkFreeMemory",
+    "vkCreateCommandPool",
+    "vkDestroyCommandPool",
+    "vkAllocateCommandBuffers",
+    "vkFreeCommandBuffers",
+    "vkBeginCommandBuffer",
+    "vkCmdPipelineBarrier",
+    "vkEndCommandBuffer",
+    "vkGetMemoryWin32HandlePropertiesKHR",
+    "vkBindImageMemory",
+    "vkCreateSemaphore",
+    "vkDestroySemaphore",
+    "vkImportSemaphoreWin32HandleKHR",
+    "vkDeviceWaitIdle",
+    "vkCreateFence",
+    "vkDestroyFence",
+    "vkGetFenceStatus",
+]
+
+# The list of OpenGL functions our layer will use from the application's context (resolved with wglGetProcAddress()).
+opengl_functions = [
+    "glGetUnsignedBytevEXT",
+    "glCreateTextures",
+    "glCreateMemoryObjectsEXT",
+    "glDeleteMemoryObjectsEXT",
+    "glTextureStorageMem2DEXT",
+    "glTextureStorageMem2DMultisampleEXT",
+    "glTextureStorageMem3DEXT",
+    "glTextureStorageMem3DMultisampleEXT",
+    "glGenSemaphoresEXT",
+    "glDeleteSemaphoresEXT",
+    "glSemaphoreParameterui64vEXT",
+    "glSignalSemaphoreEXT",
+    "glImportMemoryWin32HandleEXT",
+    "glImportSemaphoreWin32HandleEXT",
+]
@@ -0,0 +1,253 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// The histograms and timers behind the measure_call_overhead and frame_profiler_period settings.
+
+namespace vulkan_d3d12_interop::util {
+
+    // A histogram of durations in nanoseconds, with 4 logarithmic buckets per power of 2 (so a percentile is off by
+    // at most 25%). Recording is lock-free and can happen from any thread.
+    class LatencyHistogram {
+      public:
+        void record(uint64_t nanoseconds) {
+            m_buckets[getBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void reset() {
+            for (auto& bucket : m_buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        uint64_t getCount() const {
+            uint64_t count = 0;
+            for (const auto& bucket : m_buckets) {
+                count += bucket.load(std::memory_order_relaxed);
+            }
+            return count;
+        }
+
+        // Returns the upper bound of the bucket containing the given quantile (between 0 and 1).
+        uint64_t getPercentile(double quantile) const {
+            const uint64_t count = getCount();
+            if (!count) {
+                return 0;
+            }
+            const uint64_t rank = std::max<uint64_t>((uint64_t)std::ceil(quantile * count), 1);
+            uint64_t seen = 0;
+            for (size_t i = 0; i < m_buckets.size(); i++) {
+                seen += m_buckets[i].load(std::memory_order_relaxed);
+                if (seen >= rank) {
+                    return getBucketUpperBound(i);
+                }
+            }
+            return getBucketUpperBound(m_buckets.size() - 1);
+        }
+
+      private:
+        static constexpr size_t SubBucketBits = 2;
+
+        static size_t getBucket(uint64_t value) {
+            if (value < (1ull << SubBucketBits)) {
+                return (size_t)value;
+            }
+            const size_t msb = getMostSignificantBit(value);
+            const size_t subBucket = (size_t)(value >> (msb - SubBucketBits)) & ((1 << SubBucketBits) - 1);
+            return (msb << SubBucketBits) + subBucket;
+        }
+
+        static size_t getMostSignificantBit(uint64_t value) {
+#ifdef _MSC_VER
+            unsigned long msb;
+            _BitScanReverse64(&msb, value);
+            return msb;
+#else
+            return 63 - __builtin_clzll(value);
+#endif
+        }
+
+        static uint64_t getBucketUpperBound(size_t bucket) {
+            if (bucket < (1ull << SubBucketBits)) {
+                return bucket;
+            }
+            const size_t msb = bucket >> SubBucketBits;
+            const uint64_t subBucket = bucket & ((1 << SubBucketBits) - 1);
+            return (((1ull << SubBucketBits) + subBucket + 1) << (msb - SubBucketBits)) - 1;
+        }
+
+        std::array<std::atomic<uint64_t>, 64 << SubBucketBits> m_buckets{};
+    };
+
+    // Measures the time spent in a layer entry point, minus the time spent down the chain (see Exclusion). The
+    // duration is recorded upon destruction, if a histogram was set.
+    class CallTimer {
+      public:
+        using Clock = std::chrono::steady_clock;
+
+        // Excludes the time until it goes out of scope.
+        class Exclusion {
+          public:
+            Exclusion(CallTimer& timer) : m_timer(timer) {
+                if (m_timer.m_enabled) {
+                    m_start = Clock::now();
+                }
+            }
+
+            ~Exclusion() {
+                if (m_timer.m_enabled) {
+                    m_timer.m_excluded += Clock::now() - m_start;
+                }
+            }
+
+          private:
+            CallTimer& m_timer;
+            Clock::time_point m_start;
+        };
+
+        CallTimer(bool enabled) : m_enabled(enabled) {
+            if (m_enabled) {
+                m_start = Clock::now();
+            }
+        }
+
+        ~CallTimer() {
+            if (m_histogram) {
+                m_histogram->record(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_start - m_excluded).count());
+            }
+        }
+
+        void setHistogram(LatencyHistogram& histogram) {
+            if (m_enabled) {
+                m_histogram = &histogram;
+            }
+        }
+
+      private:
+        const bool m_enabled;
+        Clock::time_point m_start;
+        Clock::duration m_excluded{0};
+        LatencyHistogram* m_histogram{nullptr};
+    };
+
+    // Times the consecutive phases of a recurring operation, such as a frame. The duration of each phase is recorded
+    // into a histogram for the current period and one for the whole lifetime. Phases that are not reached by an
+    // operation are not recorded for it. Not thread-safe: the operation must be serialized by the caller. Does nothing
+    // until enabled.
+    template <size_t PhaseCount>
+    class PhaseProfiler {
+      public:
+        using Clock = std::chrono::steady_clock;
+
+        void setEnabled(bool enabled) {
+            m_enabled = enabled;
+            m_periodStart = Clock::now();
+        }
+
+        bool isEnabled() const {
+            return m_enabled;
+        }
+
+        // Begin a new operation.
+        void start() {
+            if (m_enabled) {
+                m_current = {};
+                m_reached = {};
+                m_last = Clock::now();
+            }
+        }
+
+        // Attribute the time since the previous mark (or start()) to the phase.
+        void mark(size_t phase) {
+            if (m_enabled) {
+                mark(phase, Clock::now());
+            }
+        }
+
+        // Same as above, with the end of the phase taken by the caller (eg: before waiting for a lock).
+        void mark(size_t phase, Clock::time_point now) {
+            if (m_enabled) {
+                m_current[phase] += now - m_last;
+                m_reached[phase] = true;
+                m_last = now;
+            }
+        }
+
+        // Record the phases of the operation.
+        void finish() {
+            if (m_enabled) {
+                for (size_t i = 0; i < PhaseCount; i++) {
+                    if (!m_reached[i]) {
+                        continue;
+                    }
+                    const uint64_t duration =
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(m_current[i]).count();
+                    m_period[i].record(duration);
+                    m_total[i].record(duration);
+                }
+            }
+        }
+
+        Clock::duration getPeriodDuration() const {
+            return Clock::now() - m_periodStart;
+        }
+
+        void resetPeriod() {
+            for (auto& histogram : m_period) {
+                histogram.reset();
+            }
+            m_periodStart = Clock::now();
+        }
+
+        const LatencyHistogram& getPeriod(size_t phase) const {
+            return m_period[phase];
+        }
+
+        const LatencyHistogram& getTotal(size_t phase) const {
+            return m_total[phase];
+        }
+
+      private:
+        bool m_enabled{false};
+        Clock::time_point m_last;
+        std::array<Clock::duration, PhaseCount> m_current{};
+        std::array<bool, PhaseCount> m_reached{};
+
+        Clock::time_point m_periodStart;
+        std::array<LatencyHistogram, PhaseCount> m_period;
+        std::array<LatencyHistogram, PhaseCount> m_total;
+    };
+
+} // namespace vulkan_d3d12_interop::util
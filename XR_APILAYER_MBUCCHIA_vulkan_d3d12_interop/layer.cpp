@@ -27,6 +27,8 @@
 #include "layer.h"
 #include "log.h"
 #include "util.h"
+#include "capture.h"
+#include "framework/dispatch_gfx.gen.h"
 
 namespace xr {
 
@@ -59,143 +61,314 @@ namespace {
 
     class OpenXrLayer : public vulkan_d3d12_interop::OpenXrApi {
       private:
-        enum GfxApi { Vulkan, OpenGL };
+        struct Swapchain;
+        struct AppImages;
+        class AppBackend;
+
+        // The entry points whose overhead is measured (see m_measureCallOverhead).
+        enum class Call { EnumerateSwapchainFormats, AcquireSwapchainImage, ReleaseSwapchainImage, EndFrame, Count };
+        static constexpr const char* CallNames[] = {
+            "xrEnumerateSwapchainFormats", "xrAcquireSwapchainImage", "xrReleaseSwapchainImage", "xrEndFrame"};
+
+        // The locks of a session whose contention is measured (see m_measureLockContention).
+        using Mutex = util::InstrumentedMutex<std::mutex>;
+        enum class Lock { Session, Swapchain, AppQueue, Copy, Formats, Count };
+        static constexpr const char* LockNames[] = {"Session", "Swapchain", "AppQueue", "Copy", "Formats"};
+
+        // The phases of xrEndFrame() timed by the frame profiler (see m_frameProfilerPeriod).
+        enum class FramePhase {
+            Signal,
+            Gather,
+            Wait,
+            RecordCopies,
+            ExecuteCopies,
+            Release,
+            Housekeeping,
+            RewriteLayers,
+            Runtime,
+            Count
+        };
+        static constexpr const char* FramePhaseNames[] = {"Signal",
+                                                          "Gather",
+                                                          "Wait",
+                                                          "RecordCopies",
+                                                          "ExecuteCopies",
+                                                          "Release",
+                                                          "Housekeeping",
+                                                          "RewriteLayers",
+                                                          "Runtime"};
+        using FrameProfiler = util::PhaseProfiler<(size_t)FramePhase::Count>;
+
+        // The percentiles of each phase, taken from the frame profiler under the session lock and logged after
+        // releasing it (see logFramePhases()).
+        struct FramePhasePercentiles {
+            uint64_t count;
+            uint64_t p50;
+            uint64_t p95;
+            uint64_t p99;
+        };
+        using FramePhasesSnapshot = std::array<FramePhasePercentiles, (size_t)FramePhase::Count>;
+
+        // The video memory used by a swapchain. The runtime and bounce images are allocations, while the images
+        // imported by the application alias either of them.
+        struct SwapchainMemory {
+            UINT64 runtimeBytes{0};
+            UINT64 bounceBytes{0};
+            UINT64 importedBytes{0};
+        };
+
+        // A copy from a shareable application texture to a non-shareable runtime texture. A subresource of
+        // D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES copies the entire texture (and ignores the box), and
+        // wholeSubresource copies the entire subresource.
+        struct CopyRequest {
+            ID3D12Resource* source;
+            ID3D12Resource* destination;
+            UINT subresource;
+            D3D12_BOX box;
+            bool wholeSubresource;
+
+            // The state of the runtime texture, as expected by the runtime.
+            D3D12_RESOURCE_STATES destinationState;
+
+            // For statistics.
+            const util::FormatInfo* format;
+            UINT64 imageBytes;
+        };
 
         // State associated with an OpenXR session.
         struct Session {
-            XrSession xrSession{XR_NULL_HANDLE};
-            XrInstance xrInstance{XR_NULL_HANDLE};
+            // Serializes the frame submission with the other uses of the session's queues.
+            Mutex mutex;
 
-            // We create a D3D12 device that the runtime will be using.
-            ComPtr<ID3D12Device> runtimeDevice;
-            ComPtr<ID3D12CommandQueue> runtimeQueue;
+            // Serializes the signaling of the fence from the app's Vulkan queue or OpenGL context. This lock may be
+            // taken while holding the session or a swapchain lock, but no other lock may be taken while holding it.
+            Mutex appQueueMutex;
+
+            // Protects the submissions of copies (copy command lists, barriers and lastWaitedFenceValue), which may
+            // happen from xrEndFrame() or from xrReleaseSwapchainImage(). Same rules as appQueueMutex.
+            Mutex copyMutex;
+
+            // The state accessed on every frame comes first. The backend is only null until the session is registered.
+            std::unique_ptr<AppBackend> app;
+
+            // When using OpenGL, the Y-axis is inverted (see xrEndFrame()).
+            bool flipProjectionFov{false};
 
             // For synchronization between the app and the runtime, we use a fence (which corresponds to a timeline
-            // semaphore in Vulkan or just semaphore in OpenGL).
-            ComPtr<ID3D12Fence> runtimeFence;
+            // semaphore in Vulkan or just semaphore in OpenGL). fenceValue is protected by appQueueMutex.
             UINT64 fenceValue{0};
+            UINT64 lastWaitedFenceValue{0};
+            ComPtr<ID3D12Fence> runtimeFence;
+
+            // We create a D3D12 device that the runtime will be using (or borrow one from m_runtimeContexts).
+            ComPtr<ID3D12CommandQueue> runtimeQueue;
+            ComPtr<ID3D12Device> runtimeDevice;
+            LUID adapterLuid{};
 
-            // Command lists for copying textures if needed.
-            ComPtr<ID3D12CommandAllocator> commandAllocator[3];
-            ComPtr<ID3D12GraphicsCommandList> commandList[3];
-            uint32_t currentContext{0};
+            // Command lists for copying textures if needed. When using a copy queue, the copies are submitted to the
+            // copy queue, and the transitions of the runtime textures are submitted to the runtime queue.
+            ComPtr<ID3D12CommandQueue> copyQueue;
+            util::CommandListPool copyCommandLists;
+            util::CommandListPool transitionCommandLists;
+            std::vector<D3D12_RESOURCE_BARRIER> copyBarriers;
+            uint64_t copiedBytes{0};
+
+            // Storage used by xrEndFrame(), reset at the beginning of each frame but never freed, so that the steady
+            // state of the frame loop does not perform any heap allocation.
+            struct FrameArena {
+                std::vector<CopyRequest> copies;
+                std::vector<Swapchain*> swapchainsToRelease;
+                std::vector<const XrCompositionLayerBaseHeader*> correctedLayers;
+                std::vector<XrCompositionLayerProjection> layerProjections;
+                std::vector<std::array<XrCompositionLayerProjectionView, 2>> layerProjectionViews;
+
+                // Whether the storage kept outside of the arena had to grow during the frame: the copy barriers and
+                // command list pools, the regions of the runtime images, and the pageables of the swapchains.
+                bool grew{false};
+
+                // Statistics: number of frames, number of frames where the storage had to grow, and number of copies
+                // skipped because the runtime image was up-to-date.
+                uint64_t frameCount{0};
+                uint64_t growthCount{0};
+                uint64_t skippedCopyCount{0};
+
+                void clear() {
+                    copies.clear();
+                    swapchainsToRelease.clear();
+                    correctedLayers.clear();
+                    layerProjections.clear();
+                    layerProjectionViews.clear();
+                    grew = false;
+                }
 
-            GfxApi api;
-            struct {
-                // We store information about the Vulkan device/queue that the app is using.
-                VkInstance instance{VK_NULL_HANDLE};
-                VkDevice device{VK_NULL_HANDLE};
-                VkPhysicalDevice physicalDevice{VK_NULL_HANDLE};
-                VkPhysicalDeviceMemoryProperties memoryProperties;
-                VkQueue queue{VK_NULL_HANDLE};
-
-                // For synchronization between the app and the runtime.
-                VkSemaphore timelineSemaphore{VK_NULL_HANDLE};
-
-                // For layout transitions.
-                VkCommandPool cmdPool{VK_NULL_HANDLE};
-                VkCommandBuffer cmdBuffer{VK_NULL_HANDLE};
-
-                struct {
-                    PFN_vkGetPhysicalDeviceProperties2 vkGetPhysicalDeviceProperties2{nullptr};
-                    PFN_vkGetPhysicalDeviceMemoryProperties vkGetPhysicalDeviceMemoryProperties{nullptr};
-                    PFN_vkGetImageMemoryRequirements2KHR vkGetImageMemoryRequirements2KHR{nullptr};
-                    PFN_vkGetDeviceQueue vkGetDeviceQueue{nullptr};
-                    PFN_vkQueueSubmit vkQueueSubmit{nullptr};
-                    PFN_vkCreateImage vkCreateImage{nullptr};
-                    PFN_vkDestroyImage vkDestroyImage{nullptr};
-                    PFN_vkAllocateMemory vkAllocateMemory{nullptr};
-                    PFN_vkFreeMemory vkFreeMemory{nullptr};
-                    PFN_vkCreateCommandPool vkCreateCommandPool{nullptr};
-                    PFN_vkDestroyCommandPool vkDestroyCommandPool{nullptr};
-                    PFN_vkAllocateCommandBuffers vkAllocateCommandBuffers{nullptr};
-                    PFN_vkFreeCommandBuffers vkFreeCommandBuffers{nullptr};
-                    PFN_vkBeginCommandBuffer vkBeginCommandBuffer{nullptr};
-                    PFN_vkCmdPipelineBarrier vkCmdPipelineBarrier{nullptr};
-                    PFN_vkEndCommandBuffer vkEndCommandBuffer{nullptr};
-                    PFN_vkGetMemoryWin32HandlePropertiesKHR vkGetMemoryWin32HandlePropertiesKHR{nullptr};
-                    PFN_vkBindImageMemory vkBindImageMemory{nullptr};
-                    PFN_vkCreateSemaphore vkCreateSemaphore{nullptr};
-                    PFN_vkDestroySemaphore vkDestroySemaphore{nullptr};
-                    PFN_vkImportSemaphoreWin32HandleKHR vkImportSemaphoreWin32HandleKHR{nullptr};
-                    PFN_vkQueueWaitIdle vkQueueWaitIdle{nullptr};
-                    PFN_vkDeviceWaitIdle vkDeviceWaitIdle{nullptr};
-                } dispatch;
-            } vk;
+                size_t capacity() const {
+                    return copies.capacity() + swapchainsToRelease.capacity() + correctedLayers.capacity() +
+                           layerProjections.capacity() + layerProjectionViews.capacity();
+                }
+            } frameArena;
+
+            // Swapchains destroyed by the application. Their resources are released once the GPU work referencing
+            // them has completed: the application's work (interop fence) and our copies (copy command lists' fence).
+            struct RetiredSwapchain {
+                std::unique_ptr<Swapchain> swapchain;
+                UINT64 interopFenceValue;
+                UINT64 copyFenceValue;
+            };
+            std::vector<RetiredSwapchain> retiredSwapchains;
+
+            // Destroyed swapchains using bounce textures, whose application images may be reused by a new swapchain
+            // with the same creation parameters. Ordered from least to most recently retired.
+            std::vector<RetiredSwapchain> swapchainCache;
+            UINT64 swapchainCacheBytes{0};
+            uint64_t swapchainCacheHits{0};
+            uint64_t swapchainCacheMisses{0};
+
+            // For evicting the bounce textures of idle swapchains when over the video memory budget. The bounce
+            // textures are imported by the application's device, which keeps them resident: the eviction only releases
+            // the runtime device's reference, and the memory is not reclaimed (nor removed from the VRAM ledger).
+            ComPtr<IDXGIAdapter3> dxgiAdapter;
+            std::atomic<uint64_t> evictionCount{0};
+            std::atomic<uint64_t> makeResidentCount{0};
+            std::atomic<UINT64> evictedBytes{0};
+
+            // The time spent in the layer for each entry point of Call, excluding the runtime.
+            util::LatencyHistogram callOverhead[(size_t)Call::Count];
+
+            // The contention on the locks of the session and its swapchains, for each entry of Lock.
+            util::LockStatistics lockStatistics[(size_t)Lock::Count];
+
+            // The timing of the phases of xrEndFrame(). Protected by the session lock.
+            FrameProfiler frameProfiler;
+
+            // The sum of the SwapchainMemory of the swapchains of the session. Updated without the session lock.
             struct {
-                // We store information about the OpenGL context that the app is using.
-                HDC DC{0};
-                HGLRC GLRC{0};
-
-                // For synchronization between the app and the runtime.
-                GLuint semaphore{0};
-
-                // Workaround: the AMD driver does not seem to like closing the handle for the shared fence when
-                // using OpenGL. We keep it alive for the whole session.
-                wil::unique_handle fenceHandleForAMDWorkaround;
-
-                struct {
-                    PFNGLGETUNSIGNEDBYTEVEXTPROC glGetUnsignedBytevEXT{nullptr};
-                    PFNGLCREATETEXTURESPROC glCreateTextures{nullptr};
-                    PFNGLCREATEMEMORYOBJECTSEXTPROC glCreateMemoryObjectsEXT{nullptr};
-                    PFNGLDELETEMEMORYOBJECTSEXTPROC glDeleteMemoryObjectsEXT{nullptr};
-                    PFNGLTEXTURESTORAGEMEM2DEXTPROC glTextureStorageMem2DEXT{nullptr};
-                    PFNGLTEXTURESTORAGEMEM2DMULTISAMPLEEXTPROC glTextureStorageMem2DMultisampleEXT{nullptr};
-                    PFNGLTEXTURESTORAGEMEM3DEXTPROC glTextureStorageMem3DEXT{nullptr};
-                    PFNGLTEXTURESTORAGEMEM3DMULTISAMPLEEXTPROC glTextureStorageMem3DMultisampleEXT{nullptr};
-                    PFNGLGENSEMAPHORESEXTPROC glGenSemaphoresEXT{nullptr};
-                    PFNGLDELETESEMAPHORESEXTPROC glDeleteSemaphoresEXT{nullptr};
-                    PFNGLSEMAPHOREPARAMETERUI64VEXTPROC glSemaphoreParameterui64vEXT{nullptr};
-                    PFNGLSIGNALSEMAPHOREEXTPROC glSignalSemaphoreEXT{nullptr};
-                    PFNGLIMPORTMEMORYWIN32HANDLEEXTPROC glImportMemoryWin32HandleEXT{nullptr};
-                    PFNGLIMPORTSEMAPHOREWIN32HANDLEEXTPROC glImportSemaphoreWin32HandleEXT{nullptr};
-                } dispatch;
-
-            } gl;
+                std::atomic<UINT64> runtimeBytes{0};
+                std::atomic<UINT64> bounceBytes{0};
+                std::atomic<UINT64> importedBytes{0};
+                std::atomic<UINT64> peakBytes{0};
+
+                SwapchainMemory getTotals() const {
+                    SwapchainMemory totals;
+                    totals.runtimeBytes = runtimeBytes;
+                    totals.bounceBytes = bounceBytes;
+                    totals.importedBytes = importedBytes;
+                    return totals;
+                }
+            } vram;
+
+            // The swapchain formats of the runtime with their translation, queried once per session, and the list
+            // returned to the application. The latter is re-ordered when m_bounceFormatsGeneration changes. Protected
+            // by formatsMutex.
+            Mutex formatsMutex;
+            bool hasFormats{false};
+            std::vector<std::pair<DXGI_FORMAT, int64_t>> formats;
+            std::vector<int64_t> orderedFormats;
+            uint64_t orderedFormatsGeneration{0};
+
+            XrSession xrSession{XR_NULL_HANDLE};
+            XrInstance xrInstance{XR_NULL_HANDLE};
+
+            // Unique for the lifetime of the instance, like Swapchain::epoch (see findSession()).
+            uint64_t epoch{0};
         };
 
         // State associated with an OpenXR swapchain.
         struct Swapchain {
-            XrSwapchain xrSwapchain{XR_NULL_HANDLE};
-            XrSwapchainCreateInfo createInfo;
-
-            // The parent session.
-            XrSession xrSession{XR_NULL_HANDLE};
+            // The content copied to a runtime image: the generation of the application's content, and the regions
+            // (array index and rectangle) that were copied, unless the whole image was copied.
+            struct RuntimeImageContent {
+                uint64_t generation{0};
+                bool wholeImage{false};
+                std::vector<std::pair<uint32_t, XrRect2Di>> regions;
+            };
 
-            // The runtime images.
-            std::vector<ID3D12Resource*> runtimeImages;
+            // Protects the frame state below.
+            Mutex mutex;
 
-            // We import the memory corresponding to the D3D12 textures that the runtime exposes.
+            // The state accessed on every frame. Keep it together at the top of the structure.
             struct {
-                std::vector<VkDeviceMemory> deviceMemory;
-                std::vector<VkImage> images;
-            } vk;
-            struct {
-                std::vector<GLuint> memory;
-                std::vector<GLuint> images;
+                // The parent session.
+                Session* session{nullptr};
+
+                // Whether the runtime images are not shareable and we must copy from the shareableImages.
+                bool needCopy{false};
+                D3D12_RESOURCE_STATES runtimeImageState{D3D12_RESOURCE_STATE_COMMON};
+                const util::FormatInfo* format{nullptr};
+                UINT64 imageBytes{0};
+                bool deferredRelease{false};
+
+                uint32_t lastReleasedIndex{0};
+
+                // Ring of acquired image indices, in acquisition order (sized to the number of images).
+                uint32_t acquiredHead{0};
+                uint32_t acquiredCount{0};
+                uint32_t waitedCount{0};
+                std::vector<uint32_t> acquiredIndex;
+
+                // With virtual images, the application acquires our shareableImages in a round-robin fashion, and
+                // the runtime image is only acquired (runtimeAcquiredIndex) for the copy in xrEndFrame(). Before the
+                // application can write to an image again, the copy from it (copyFenceValue) must be completed.
+                bool virtualImages{false};
+                uint32_t nextVirtualIndex{0};
+                uint32_t runtimeAcquiredIndex{0};
+                bool runtimeImageAcquired{false};
+                bool runtimeImageWaited{false};
+                uint32_t copySourceIndex{0};
+                std::vector<UINT64> copyFenceValue;
+                wil::unique_handle copyEvent;
+
+                // The generation of the application's content, incremented upon each release, and what was last
+                // copied to each runtime image. This lets us skip copies of unchanged (eg: static) content.
+                uint64_t generation{0};
+                std::vector<RuntimeImageContent> runtimeImageContent;
+
+                // The runtime images, and the interop fence value that each one depends on (when signaling upon
+                // release).
+                std::vector<ID3D12Resource*> runtimeImages;
+                std::vector<UINT64> readyFenceValue;
+
+                // Residency of the shareableImages (see manageResidency()): whether the swapchain was used since the
+                // last poll, the frame it was last seen in use, and the fence values to wait for before evicting.
+                bool usedSinceLastPoll{false};
+                uint64_t lastUsedFrame{0};
+                bool evictionPending{false};
+                UINT64 evictionInteropFenceValue{0};
+                UINT64 evictionCopyFenceValue{0};
+                bool evicted{false};
+            } frame;
 
-                // Workaround: the AMD driver does not seem to like closing the handle for the shared textures when
-                // using OpenGL. We keep them alive for the whole session.
-                std::vector<wil::unique_handle> textureHandlesForAMDWorkaround;
-            } gl;
+            XrSwapchain xrSwapchain{XR_NULL_HANDLE};
+            XrSwapchainCreateInfo createInfo;
+
+            // Unique for the lifetime of the instance, unlike the handle, so that the state can be looked up again
+            // after releasing the registry lock (see findSwapchain()).
+            uint64_t epoch{0};
+
+            // The images exposed to the application, owned by the session's AppBackend.
+            std::unique_ptr<AppImages> app;
 
             // Application images in case the runtime images are not shareable.
             std::vector<ComPtr<ID3D12Resource>> shareableImages;
 
-            std::deque<uint32_t> acquiredIndex;
-            uint32_t lastReleasedIndex{0};
-            bool deferredRelease{false};
+            // The shareableImages, as passed to Evict() and MakeResident(). Built upon first use, under the swapchain
+            // lock.
+            std::vector<ID3D12Pageable*> pageables;
+
+            // The size of the allocation of each runtime (and bounce) texture, and the memory accounted for this
+            // swapchain in the session's VRAM ledger.
+            UINT64 imageAllocationBytes{0};
+            SwapchainMemory memory;
         };
 
         // A utility class to switch OpenGL context.
         class GlContextSwitch {
           public:
-            GlContextSwitch(const Session& sessionState) : m_valid(sessionState.gl.DC != 0) {
+            GlContextSwitch(HDC DC, HGLRC GLRC) : m_valid(DC != 0) {
                 if (m_valid) {
                     m_glDC = wglGetCurrentDC();
                     m_glRC = wglGetCurrentContext();
 
-                    wglMakeCurrent(sessionState.gl.DC, sessionState.gl.GLRC);
+                    wglMakeCurrent(DC, GLRC);
 
                     // Reset error codes.
                     while (glGetError() != GL_NO_ERROR)
@@ -219,13 +392,627 @@ namespace {
             HGLRC m_glRC;
         };
 
+        // The images of a swapchain exposed to the application, created by the session's AppBackend.
+        struct AppImages {
+            virtual ~AppImages() = default;
+        };
+
+        // The application side of the interop: the formats and images exposed to the application, the signaling of
+        // the interop fence from the application's queue/context, and the teardown. The implementation is selected
+        // once at session creation, so the frame loop does not branch on the graphics API. The backend owns all the
+        // state of the application's graphics API, for the session and for its swapchains (Swapchain::app).
+        class AppBackend {
+          public:
+            virtual ~AppBackend() = default;
+
+            // Translate between the application's formats and the format registry. getFormat() returns 0 when the
+            // format cannot be used by the application.
+            virtual const util::FormatInfo* getFormatInfo(int64_t format) const = 0;
+            virtual int64_t getFormat(const util::FormatInfo& format) const = 0;
+
+            // Create the application images of the swapchain from the shareable textures.
+            virtual void initializeSwapchain(Session& sessionState, Swapchain& swapchain) = 0;
+
+            virtual uint32_t getImageCount(const Swapchain& swapchain) const = 0;
+            virtual void getImages(const Swapchain& swapchain, XrSwapchainImageBaseHeader* images) const = 0;
+
+            // Signal the interop fence to the given value. Must be called with appQueueMutex held.
+            virtual void signal(Session& sessionState, UINT64 value) = 0;
+
+            virtual void waitIdle(Session& sessionState) = 0;
+
+            // The resources must no longer be in use by the GPU.
+            virtual void destroySwapchain(Session& sessionState, Swapchain& swapchain) = 0;
+            virtual void destroy(Session& sessionState) = 0;
+        };
+
+        class VulkanBackend final : public AppBackend {
+          public:
+            VulkanBackend(OpenXrLayer& layer) : m_layer(layer) {
+            }
+
+            // Import the interop fence into the application's device.
+            XrResult initialize(Session& sessionState, const XrGraphicsBindingVulkanKHR& vkBindings) {
+                m_instance = vkBindings.instance;
+                m_device = vkBindings.device;
+                m_physicalDevice = vkBindings.physicalDevice;
+                m_allocator = m_layer.m_vkAllocator;
+
+                // Initialize the function pointers for the Vulkan device. The table is generated from
+                // framework/layer_apis.py.
+                m_dispatch.initialize(
+                    m_layer.m_vkGetInstanceProcAddr ? m_layer.m_vkGetInstanceProcAddr : vkGetInstanceProcAddr,
+                    m_instance,
+                    m_device);
+
+                // Check that the app is using the correct adapter.
+                VkPhysicalDeviceIDProperties deviceId{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
+                VkPhysicalDeviceProperties2 properties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, &deviceId};
+                m_dispatch.vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties);
+                if (!deviceId.deviceLUIDValid ||
+                    memcmp(&sessionState.adapterLuid, deviceId.deviceLUID, sizeof(LUID))) {
+                    Log("Application did not initialize the correct adapter\n");
+                    return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+                }
+
+                m_dispatch.vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+
+                m_dispatch.vkGetDeviceQueue(m_device, vkBindings.queueFamilyIndex, vkBindings.queueIndex, &m_queue);
+                m_queueFamilyIndex = vkBindings.queueFamilyIndex;
+
+                // Create the timeline semaphore that we will use to synchronize between the Vulkan
+                // queue and the D3D queue.
+                VkSemaphoreTypeCreateInfo timelineCreateInfo{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+                timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+                VkSemaphoreCreateInfo createInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, &timelineCreateInfo};
+                CHECK_VKCMD(m_dispatch.vkCreateSemaphore(m_device, &createInfo, m_allocator, &m_timelineSemaphore));
+
+                // Import the D3D fence into the semaphore.
+                wil::unique_handle fenceHandle = nullptr;
+                CHECK_HRCMD(sessionState.runtimeDevice->CreateSharedHandle(
+                    sessionState.runtimeFence.Get(), nullptr, GENERIC_ALL, nullptr, fenceHandle.put()));
+
+                VkImportSemaphoreWin32HandleInfoKHR semaphoreImportInfo{
+                    VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_WIN32_HANDLE_INFO_KHR};
+                semaphoreImportInfo.semaphore = m_timelineSemaphore;
+                semaphoreImportInfo.handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_D3D12_FENCE_BIT;
+                semaphoreImportInfo.handle = fenceHandle.get();
+                CHECK_VKCMD(m_dispatch.vkImportSemaphoreWin32HandleKHR(m_device, &semaphoreImportInfo));
+
+                return XR_SUCCESS;
+            }
+
+            const util::FormatInfo* getFormatInfo(int64_t format) const override {
+                return util::GetFormatInfoFromVk((VkFormat)format);
+            }
+
+            int64_t getFormat(const util::FormatInfo& format) const override {
+                return (int64_t)format.vk;
+            }
+
+            void initializeSwapchain(Session& sessionState, Swapchain& swapchain) override {
+                const auto& swapchainInfo = swapchain.createInfo;
+                auto images = std::make_unique<VulkanImages>();
+
+                const bool needTransition =
+                    swapchainInfo.usageFlags &
+                    (XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT | XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+                // Helper to select the memory type.
+                auto findMemoryType = [this](uint32_t memoryTypeBitsRequirement, VkFlags requirementsMask) {
+                    for (uint32_t memoryIndex = 0; memoryIndex < VK_MAX_MEMORY_TYPES; ++memoryIndex) {
+                        const uint32_t memoryTypeBits = (1 << memoryIndex);
+                        const bool isRequiredMemoryType = memoryTypeBitsRequirement & memoryTypeBits;
+                        const bool satisfiesFlags =
+                            (m_memoryProperties.memoryTypes[memoryIndex].propertyFlags & requirementsMask) ==
+                            requirementsMask;
+
+                        if (isRequiredMemoryType && satisfiesFlags) {
+                            return memoryIndex;
+                        }
+                    }
+
+                    CHECK_VKCMD(VK_ERROR_UNKNOWN);
+                    return 0u;
+                };
+
+                // Start a command list to transition images. We use a transient command pool, so that we do not need
+                // to wait for any previous use of it.
+                TransientCommands commands;
+                if (needTransition) {
+                    VkCommandPoolCreateInfo poolCreateInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+                    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+                    poolCreateInfo.queueFamilyIndex = m_queueFamilyIndex;
+                    CHECK_VKCMD(m_dispatch.vkCreateCommandPool(m_device, &poolCreateInfo, m_allocator, &commands.pool));
+
+                    VkCommandBufferAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+                    allocateInfo.commandPool = commands.pool;
+                    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+                    allocateInfo.commandBufferCount = 1;
+                    CHECK_VKCMD(m_dispatch.vkAllocateCommandBuffers(m_device, &allocateInfo, &commands.buffer));
+
+                    VkFenceCreateInfo fenceCreateInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+                    CHECK_VKCMD(m_dispatch.vkCreateFence(m_device, &fenceCreateInfo, m_allocator, &commands.fence));
+
+                    VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+                    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+                    CHECK_VKCMD(m_dispatch.vkBeginCommandBuffer(commands.buffer, &beginInfo));
+                }
+
+                std::vector<wil::unique_handle> runtimeTextureHandles;
+                m_layer.getRuntimeSwapchainImages(sessionState, swapchain, runtimeTextureHandles);
+
+                for (uint32_t i = 0; i < runtimeTextureHandles.size(); i++) {
+                    // Prepare the Vulkan image that the app will use.
+                    VkImage image;
+
+                    VkExternalMemoryImageCreateInfo externalCreateInfo{
+                        VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO};
+                    externalCreateInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_D3D12_RESOURCE_BIT;
+
+                    VkImageCreateInfo createInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO, &externalCreateInfo};
+                    createInfo.imageType = VK_IMAGE_TYPE_2D;
+                    createInfo.format = (VkFormat)swapchainInfo.format;
+                    createInfo.extent.width = swapchainInfo.width;
+                    createInfo.extent.height = swapchainInfo.height;
+                    createInfo.extent.depth = 1;
+                    createInfo.mipLevels = swapchainInfo.mipCount;
+                    createInfo.arrayLayers = swapchainInfo.arraySize;
+                    createInfo.samples = (VkSampleCountFlagBits)swapchainInfo.sampleCount;
+                    createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+                    createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                    if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) {
+                        createInfo.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+                    }
+                    if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+                        createInfo.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+                    }
+                    if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_SAMPLED_BIT) {
+                        createInfo.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+                    }
+                    if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT) {
+                        createInfo.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+                    }
+                    if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_TRANSFER_SRC_BIT) {
+                        createInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+                    }
+                    if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT) {
+                        createInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+                    }
+                    if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_MUTABLE_FORMAT_BIT) {
+                        createInfo.usage |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
+                    }
+                    createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+                    CHECK_VKCMD(m_dispatch.vkCreateImage(m_device, &createInfo, m_allocator, &image));
+
+                    images->images.push_back(image);
+
+                    // Import the device memory from D3D.
+                    VkDeviceMemory memory;
+
+                    VkImageMemoryRequirementsInfo2 requirementInfo{VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2};
+                    requirementInfo.image = image;
+                    VkMemoryRequirements2 requirements{VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+                    m_dispatch.vkGetImageMemoryRequirements2(m_device, &requirementInfo, &requirements);
+
+                    VkMemoryWin32HandlePropertiesKHR handleProperties{
+                        VK_STRUCTURE_TYPE_MEMORY_WIN32_HANDLE_PROPERTIES_KHR};
+                    CHECK_VKCMD(m_dispatch.vkGetMemoryWin32HandlePropertiesKHR(
+                        m_device,
+                        VK_EXTERNAL_MEMORY_HANDLE_TYPE_D3D12_RESOURCE_BIT,
+                        runtimeTextureHandles[i].get(),
+                        &handleProperties));
+
+                    VkImportMemoryWin32HandleInfoKHR importInfo{VK_STRUCTURE_TYPE_IMPORT_MEMORY_WIN32_HANDLE_INFO_KHR};
+                    importInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_D3D12_RESOURCE_BIT;
+                    importInfo.handle = runtimeTextureHandles[i].get();
+
+                    VkMemoryDedicatedAllocateInfo memoryAllocateInfo{VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
+                                                                     &importInfo};
+                    memoryAllocateInfo.image = image;
+
+                    VkMemoryAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, &memoryAllocateInfo};
+                    allocateInfo.allocationSize =
+                        std::max(requirements.memoryRequirements.size, swapchain.imageAllocationBytes);
+                    allocateInfo.memoryTypeIndex =
+                        findMemoryType(handleProperties.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+
+                    CHECK_VKCMD(m_dispatch.vkAllocateMemory(m_device, &allocateInfo, m_allocator, &memory));
+
+                    images->deviceMemory.push_back(memory);
+
+                    CHECK_VKCMD(m_dispatch.vkBindImageMemory(m_device, image, memory, 0));
+
+                    // Transition the image to the layout expected by the application.
+                    if (needTransition) {
+                        VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+                        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                        if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) {
+                            barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+                        }
+                        if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+                            barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+                            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+                        }
+                        // Depth/stencil formats must transition both aspects.
+                        if (const util::FormatInfo* format = getFormatInfo(swapchainInfo.format)) {
+                            barrier.subresourceRange.aspectMask = format->aspects;
+                        }
+                        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                        barrier.image = image;
+                        barrier.subresourceRange.baseMipLevel = 0;
+                        barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+                        barrier.subresourceRange.baseArrayLayer = 0;
+                        barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+                        m_dispatch.vkCmdPipelineBarrier(commands.buffer,
+                                                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                                        VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
+                                                        0,
+                                                        0,
+                                                        (VkMemoryBarrier*)nullptr,
+                                                        0,
+                                                        (VkBufferMemoryBarrier*)nullptr,
+                                                        1,
+                                                        &barrier);
+                    }
+                }
+                swapchain.app = std::move(images);
+
+                // Execute the command list to transition images. The application's subsequent work on the queue is
+                // ordered after it, so there is no need to wait for completion: the command pool is destroyed later.
+                if (needTransition) {
+                    m_dispatch.vkEndCommandBuffer(commands.buffer);
+
+                    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+                    submitInfo.commandBufferCount = 1;
+                    submitInfo.pCommandBuffers = &commands.buffer;
+
+                    std::unique_lock lock(sessionState.appQueueMutex);
+                    CHECK_VKCMD(m_dispatch.vkQueueSubmit(m_queue, 1, &submitInfo, commands.fence));
+
+                    // Reclaim the transitions from previous swapchain creations that have completed.
+                    for (auto it = m_pendingTransitions.begin(); it != m_pendingTransitions.end();) {
+                        if (m_dispatch.vkGetFenceStatus(m_device, it->fence) == VK_SUCCESS) {
+                            destroyTransientCommands(*it);
+                            it = m_pendingTransitions.erase(it);
+                        } else {
+                            ++it;
+                        }
+                    }
+                    m_pendingTransitions.push_back(commands);
+                }
+            }
+
+            uint32_t getImageCount(const Swapchain& swapchain) const override {
+                return (uint32_t)getSwapchainImages(swapchain).images.size();
+            }
+
+            void getImages(const Swapchain& swapchain, XrSwapchainImageBaseHeader* images) const override {
+                XrSwapchainImageVulkanKHR* vkImages = reinterpret_cast<XrSwapchainImageVulkanKHR*>(images);
+                const auto& swapchainImages = getSwapchainImages(swapchain).images;
+                for (size_t i = 0; i < swapchainImages.size(); i++) {
+                    vkImages[i].image = swapchainImages[i];
+
+                    TraceLoggingWrite(g_traceProvider,
+                                      "xrEnumerateSwapchainImages",
+                                      TLArg("Vulkan", "Api"),
+                                      TLXArg(vkImages[i].image, "Texture"));
+                }
+            }
+
+            void signal(Session& sessionState, UINT64 value) override {
+                VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+                timelineInfo.signalSemaphoreValueCount = 1;
+                timelineInfo.pSignalSemaphoreValues = &value;
+                VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO, &timelineInfo};
+                submitInfo.signalSemaphoreCount = 1;
+                submitInfo.pSignalSemaphores = &m_timelineSemaphore;
+                CHECK_VKCMD(m_dispatch.vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+            }
+
+            void waitIdle(Session& sessionState) override {
+                if (m_device != VK_NULL_HANDLE) {
+                    m_dispatch.vkDeviceWaitIdle(m_device);
+                }
+            }
+
+            void destroySwapchain(Session& sessionState, Swapchain& swapchain) override {
+                if (!swapchain.app) {
+                    return;
+                }
+                const auto& images = getSwapchainImages(swapchain);
+                for (auto& image : images.images) {
+                    m_dispatch.vkDestroyImage(m_device, image, m_allocator);
+                }
+                for (auto& memory : images.deviceMemory) {
+                    m_dispatch.vkFreeMemory(m_device, memory, m_allocator);
+                }
+                swapchain.app.reset();
+            }
+
+            void destroy(Session& sessionState) override {
+                for (auto& commands : m_pendingTransitions) {
+                    destroyTransientCommands(commands);
+                }
+                m_pendingTransitions.clear();
+                if (m_timelineSemaphore != VK_NULL_HANDLE) {
+                    m_dispatch.vkDestroySemaphore(m_device, m_timelineSemaphore, m_allocator);
+                    m_timelineSemaphore = VK_NULL_HANDLE;
+                }
+            }
+
+          private:
+            // We import the memory corresponding to the D3D12 textures that the runtime exposes.
+            struct VulkanImages : AppImages {
+                std::vector<VkDeviceMemory> deviceMemory;
+                std::vector<VkImage> images;
+            };
+
+            // For layout transitions in xrCreateSwapchain(). Each creation uses its own command pool, which is
+            // destroyed once its fence is signaled.
+            struct TransientCommands {
+                VkCommandPool pool{VK_NULL_HANDLE};
+                VkCommandBuffer buffer{VK_NULL_HANDLE};
+                VkFence fence{VK_NULL_HANDLE};
+            };
+
+            static const VulkanImages& getSwapchainImages(const Swapchain& swapchain) {
+                return static_cast<const VulkanImages&>(*swapchain.app);
+            }
+
+            void destroyTransientCommands(const TransientCommands& commands) {
+                m_dispatch.vkDestroyFence(m_device, commands.fence, m_allocator);
+                m_dispatch.vkFreeCommandBuffers(m_device, commands.pool, 1, &commands.buffer);
+                m_dispatch.vkDestroyCommandPool(m_device, commands.pool, m_allocator);
+            }
+
+            OpenXrLayer& m_layer;
+
+            // We store information about the Vulkan device/queue that the app is using.
+            VkInstance m_instance{VK_NULL_HANDLE};
+            VkDevice m_device{VK_NULL_HANDLE};
+            VkPhysicalDevice m_physicalDevice{VK_NULL_HANDLE};
+            VkPhysicalDeviceMemoryProperties m_memoryProperties;
+            VkQueue m_queue{VK_NULL_HANDLE};
+            uint32_t m_queueFamilyIndex{0};
+            const VkAllocationCallbacks* m_allocator{nullptr};
+
+            // For synchronization between the app and the runtime.
+            VkSemaphore m_timelineSemaphore{VK_NULL_HANDLE};
+
+            // Protected by appQueueMutex.
+            std::vector<TransientCommands> m_pendingTransitions;
+
+            VulkanDispatch m_dispatch;
+        };
+
+        class OpenGLBackend final : public AppBackend {
+          public:
+            OpenGLBackend(OpenXrLayer& layer) : m_layer(layer) {
+            }
+
+            // Import the interop fence into the application's context.
+            XrResult initialize(Session& sessionState, const XrGraphicsBindingOpenGLWin32KHR& glBindings) {
+                m_DC = glBindings.hDC;
+                m_GLRC = glBindings.hGLRC;
+
+                GlContextSwitch context(m_DC, m_GLRC);
+
+                // Initialize the function pointers for the OpenGL context. The table is generated from
+                // framework/layer_apis.py.
+                m_dispatch.initialize();
+
+                // Check that the app is using the correct adapter.
+                LUID adapterLuid{};
+                m_dispatch.glGetUnsignedBytevEXT(GL_DEVICE_LUID_EXT, (GLubyte*)&adapterLuid);
+                if (memcmp(&adapterLuid, &sessionState.adapterLuid, sizeof(LUID))) {
+                    Log("Application did not initialize the correct adapter\n");
+                    return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+                }
+
+                // Create the semaphore that we will use to synchronize between the OpenGL context
+                // and the D3D queue.
+                m_dispatch.glGenSemaphoresEXT(1, &m_semaphore);
+
+                // Import the D3D fence into the semaphore.
+                CHECK_HRCMD(sessionState.runtimeDevice->CreateSharedHandle(sessionState.runtimeFence.Get(),
+                                                                           nullptr,
+                                                                           GENERIC_ALL,
+                                                                           nullptr,
+                                                                           m_fenceHandleForAMDWorkaround.put()));
+
+                m_dispatch.glImportSemaphoreWin32HandleEXT(
+                    m_semaphore, GL_HANDLE_TYPE_D3D12_FENCE_EXT, m_fenceHandleForAMDWorkaround.get());
+
+                return XR_SUCCESS;
+            }
+
+            const util::FormatInfo* getFormatInfo(int64_t format) const override {
+                return util::GetFormatInfoFromGl((GLint)format);
+            }
+
+            int64_t getFormat(const util::FormatInfo& format) const override {
+                return (int64_t)format.gl;
+            }
+
+            void initializeSwapchain(Session& sessionState, Swapchain& swapchain) override {
+                auto images = std::make_unique<OpenGLImages>();
+
+                // The OpenGL context can only be current on one thread at a time.
+                std::unique_lock lock(sessionState.appQueueMutex);
+                GlContextSwitch context(m_DC, m_GLRC);
+
+                m_layer.getRuntimeSwapchainImages(sessionState, swapchain, images->textureHandlesForAMDWorkaround);
+
+                const auto& swapchainInfo = swapchain.createInfo;
+
+                for (uint32_t i = 0; i < images->textureHandlesForAMDWorkaround.size(); i++) {
+                    // Import the device memory from D3D.
+                    GLuint memory;
+                    m_dispatch.glCreateMemoryObjectsEXT(1, &memory);
+                    images->memory.push_back(memory);
+
+                    // The size must cover the whole allocation of the texture, including all mips and layers and the
+                    // alignment.
+                    m_dispatch.glImportMemoryWin32HandleEXT(memory,
+                                                            swapchain.imageAllocationBytes,
+                                                            GL_HANDLE_TYPE_D3D12_RESOURCE_EXT,
+                                                            images->textureHandlesForAMDWorkaround[i].get());
+
+                    // Create the texture that the app will use.
+                    GLuint image;
+
+                    if (swapchainInfo.arraySize == 1) {
+                        if (swapchainInfo.sampleCount == 1) {
+                            m_dispatch.glCreateTextures(GL_TEXTURE_2D, 1, &image);
+                            m_dispatch.glTextureStorageMem2DEXT(image,
+                                                                swapchainInfo.mipCount,
+                                                                (GLenum)swapchainInfo.format,
+                                                                swapchainInfo.width,
+                                                                swapchainInfo.height,
+                                                                memory,
+                                                                0);
+                        } else {
+                            m_dispatch.glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &image);
+                            m_dispatch.glTextureStorageMem2DMultisampleEXT(image,
+                                                                           swapchainInfo.sampleCount,
+                                                                           (GLenum)swapchainInfo.format,
+                                                                           swapchainInfo.width,
+                                                                           swapchainInfo.height,
+                                                                           GL_TRUE,
+                                                                           memory,
+                                                                           0);
+                        }
+                    } else {
+                        if (swapchainInfo.sampleCount == 1) {
+                            m_dispatch.glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &image);
+                            m_dispatch.glTextureStorageMem3DEXT(image,
+                                                                swapchainInfo.mipCount,
+                                                                (GLenum)swapchainInfo.format,
+                                                                swapchainInfo.width,
+                                                                swapchainInfo.height,
+                                                                swapchainInfo.arraySize,
+                                                                memory,
+                                                                0);
+                        } else {
+                            m_dispatch.glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, 1, &image);
+                            m_dispatch.glTextureStorageMem3DMultisampleEXT(image,
+                                                                           swapchainInfo.sampleCount,
+                                                                           (GLenum)swapchainInfo.format,
+                                                                           swapchainInfo.width,
+                                                                           swapchainInfo.height,
+                                                                           swapchainInfo.arraySize,
+                                                                           GL_TRUE,
+                                                                           memory,
+                                                                           0);
+                        }
+                    }
+                    images->images.push_back(image);
+                }
+                swapchain.app = std::move(images);
+            }
+
+            uint32_t getImageCount(const Swapchain& swapchain) const override {
+                return (uint32_t)getSwapchainImages(swapchain).images.size();
+            }
+
+            void getImages(const Swapchain& swapchain, XrSwapchainImageBaseHeader* images) const override {
+                XrSwapchainImageOpenGLKHR* glImages = reinterpret_cast<XrSwapchainImageOpenGLKHR*>(images);
+                const auto& swapchainImages = getSwapchainImages(swapchain).images;
+                for (size_t i = 0; i < swapchainImages.size(); i++) {
+                    glImages[i].image = swapchainImages[i];
+
+                    TraceLoggingWrite(g_traceProvider,
+                                      "xrEnumerateSwapchainImages",
+                                      TLArg("OpenGL", "Api"),
+                                      TLArg(glImages[i].image, "Texture"));
+                }
+            }
+
+            void signal(Session& sessionState, UINT64 value) override {
+                GlContextSwitch context(m_DC, m_GLRC);
+
+                m_dispatch.glSemaphoreParameterui64vEXT(m_semaphore, GL_D3D12_FENCE_VALUE_EXT, &value);
+
+                m_dispatch.glSignalSemaphoreEXT(m_semaphore, 0, nullptr, 0, nullptr, nullptr);
+
+                glFlush();
+            }
+
+            void waitIdle(Session& sessionState) override {
+                GlContextSwitch context(m_DC, m_GLRC);
+                glFinish();
+            }
+
+            void destroySwapchain(Session& sessionState, Swapchain& swapchain) override {
+                if (!swapchain.app) {
+                    return;
+                }
+
+                std::unique_lock lock(sessionState.appQueueMutex);
+                GlContextSwitch context(m_DC, m_GLRC);
+
+                auto& images = getSwapchainImages(swapchain);
+                for (auto& image : images.images) {
+                    glDeleteTextures(1, &image);
+                }
+                for (auto& memory : images.memory) {
+                    m_dispatch.glDeleteMemoryObjectsEXT(1, &memory);
+                }
+                swapchain.app.reset();
+            }
+
+            void destroy(Session& sessionState) override {
+                GlContextSwitch context(m_DC, m_GLRC);
+                if (m_semaphore) {
+                    m_dispatch.glDeleteSemaphoresEXT(1, &m_semaphore);
+                    m_semaphore = 0;
+                }
+            }
+
+          private:
+            // We import the memory corresponding to the D3D12 textures that the runtime exposes.
+            struct OpenGLImages : AppImages {
+                std::vector<GLuint> memory;
+                std::vector<GLuint> images;
+
+                // Workaround: the AMD driver does not seem to like closing the handle for the shared textures when
+                // using OpenGL. We keep them alive for the whole session.
+                std::vector<wil::unique_handle> textureHandlesForAMDWorkaround;
+            };
+
+            static const OpenGLImages& getSwapchainImages(const Swapchain& swapchain) {
+                return static_cast<const OpenGLImages&>(*swapchain.app);
+            }
+
+            OpenXrLayer& m_layer;
+
+            // We store information about the OpenGL context that the app is using.
+            HDC m_DC{0};
+            HGLRC m_GLRC{0};
+
+            // For synchronization between the app and the runtime.
+            GLuint m_semaphore{0};
+
+            // Workaround: the AMD driver does not seem to like closing the handle for the shared fence when
+            // using OpenGL. We keep it alive for the whole session.
+            wil::unique_handle m_fenceHandleForAMDWorkaround;
+
+            OpenGLDispatch m_dispatch;
+        };
+
       public:
         OpenXrLayer() = default;
 
         ~OpenXrLayer() override {
-            while (m_sessions.size()) {
-                cleanupSession(m_sessions.begin()->second);
-                m_sessions.erase(m_sessions.begin());
+            std::unique_lock registryLock(m_registryLock);
+            for (XrSession session : m_sessions.collect([](const Session&) { return true; })) {
+                cleanupSession(*m_sessions.find(session));
+                m_sessions.erase(session);
             }
         }
 
@@ -287,16 +1074,44 @@ namespace {
             Log("Application: %s\n", GetApplicationName().c_str());
             Log("Using OpenXR runtime: %s\n", runtimeName.c_str());
 
+            loadSettings();
+
+            if (m_measureLockContention) {
+                m_registryLock.setStatistics(&m_registryLockStatistics);
+            }
+            if (m_captureCalls && !m_capture.isOpen()) {
+                const char* const localAppData = getenv("LOCALAPPDATA");
+                if (localAppData) {
+                    m_capture.open(std::filesystem::path(localAppData) /
+                                   fmt::format("{}.{}.capture", LayerName, std::time(nullptr)));
+                } else {
+                    Log("LOCALAPPDATA is not set, not capturing calls\n");
+                }
+            }
+
             return XR_SUCCESS;
         }
 
+        // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrDestroyInstance
+        XrResult xrDestroyInstance(XrInstance instance) override {
+            // Stop the capture here, since the destructor of the layer might run under the loader lock.
+            m_capture.close();
+
+            // The registry is shared by all the sessions of the instance.
+            if (m_measureLockContention) {
+                logLockStatistics("Registry", m_registryLockStatistics);
+            }
+
+            return OpenXrApi::xrDestroyInstance(instance);
+        }
+
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrGetSystem
         XrResult xrGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId) override {
             if (getInfo->type != XR_TYPE_SYSTEM_GET_INFO) {
                 return XR_ERROR_VALIDATION_FAILURE;
             }
 
-            std::unique_lock lock(m_globalLock);
+            std::unique_lock lock(m_instanceLock);
 
             TraceLoggingWrite(g_traceProvider,
                               "xrGetSystem",
@@ -454,9 +1269,20 @@ namespace {
             std::vector<VkPhysicalDevice> devices(deviceCount);
             CHECK_VKCMD(vkEnumeratePhysicalDevices(vkInstance, &deviceCount, devices.data()));
 
-            // Match the Vulkan physical device to the adapter LUID returned by the runtime.
+            // Match the Vulkan physical device to the adapter LUID returned by the runtime. Try the device that matched
+            // last time first, so we only query the properties of a single device in the common case.
+            std::vector<uint32_t> order(deviceCount);
+            std::iota(order.begin(), order.end(), 0);
+            {
+                std::unique_lock lock(m_adapterIndexLock);
+                if (m_vkPhysicalDeviceIndex && *m_vkPhysicalDeviceIndex < deviceCount) {
+                    std::swap(order[0], order[*m_vkPhysicalDeviceIndex]);
+                }
+            }
+
             bool found = false;
-            for (const VkPhysicalDevice& device : devices) {
+            for (const uint32_t index : order) {
+                const VkPhysicalDevice device = devices[index];
                 VkPhysicalDeviceIDProperties deviceId{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
                 VkPhysicalDeviceProperties2 properties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, &deviceId};
                 vkGetPhysicalDeviceProperties2(device, &properties);
@@ -477,6 +1303,9 @@ namespace {
                         g_traceProvider, "xrGetVulkanDeviceExtensionsKHR", TLPArg(device, "VkPhysicalDevice"));
                     *vkPhysicalDevice = device;
                     found = true;
+
+                    std::unique_lock lock(m_adapterIndexLock);
+                    m_vkPhysicalDeviceIndex = index;
                     break;
                 }
             }
@@ -495,7 +1324,7 @@ namespace {
                 return XR_ERROR_VALIDATION_FAILURE;
             }
 
-            std::unique_lock lock(m_globalLock);
+            std::unique_lock lock(m_instanceLock);
 
             TraceLoggingWrite(g_traceProvider,
                               "xrCreateVulkanInstanceKHR",
@@ -561,7 +1390,7 @@ namespace {
                 return XR_ERROR_VALIDATION_FAILURE;
             }
 
-            std::unique_lock lock(m_globalLock);
+            std::unique_lock lock(m_instanceLock);
 
             TraceLoggingWrite(g_traceProvider,
                               "XrVulkanDeviceCreateInfoKHR",
@@ -638,7 +1467,7 @@ namespace {
                 return XR_ERROR_VALIDATION_FAILURE;
             }
 
-            std::unique_lock lock(m_globalLock);
+            std::unique_lock lock(m_instanceLock);
 
             TraceLoggingWrite(g_traceProvider,
                               "xrGetVulkanGraphicsDevice2KHR",
@@ -674,7 +1503,7 @@ namespace {
                 return XR_ERROR_VALIDATION_FAILURE;
             }
 
-            std::unique_lock lock(m_globalLock);
+            std::unique_lock lock(m_instanceLock);
 
             TraceLoggingWrite(g_traceProvider,
                               "xrGetVulkanGraphicsRequirementsKHR",
@@ -714,7 +1543,7 @@ namespace {
                 return XR_ERROR_VALIDATION_FAILURE;
             }
 
-            std::unique_lock lock(m_globalLock);
+            std::unique_lock lock(m_instanceLock);
 
             TraceLoggingWrite(g_traceProvider,
                               "xrGetVulkanGraphicsRequirements2KHR",
@@ -754,7 +1583,7 @@ namespace {
                 return XR_ERROR_VALIDATION_FAILURE;
             }
 
-            std::unique_lock lock(m_globalLock);
+            std::unique_lock lock(m_instanceLock);
 
             TraceLoggingWrite(g_traceProvider,
                               "xrGetOpenGLGraphicsRequirementsKHR",
@@ -789,58 +1618,82 @@ namespace {
                                              uint32_t formatCapacityInput,
                                              uint32_t* formatCountOutput,
                                              int64_t* formats) override {
-            std::unique_lock lock(m_globalLock);
+            std::shared_lock registryLock(m_registryLock);
 
             TraceLoggingWrite(g_traceProvider,
                               "xrEnumerateSwapchainFormats",
                               TLXArg(session, "Session"),
                               TLArg(formatCapacityInput, "FormatCapacityInput"));
 
-            XrResult result = XR_ERROR_RUNTIME_FAILURE;
-            if (isSessionHandled(session)) {
-                // Because we alter the number of formats, we must always perform a first call to get the real number
-                // of formats.
-                result = OpenXrApi::xrEnumerateSwapchainFormats(session, 0, formatCountOutput, nullptr);
-                if (XR_SUCCEEDED(result)) {
-                    // Query the real list of formats.
-                    std::vector<int64_t> runtimeFormats(*formatCountOutput);
-                    result = OpenXrApi::xrEnumerateSwapchainFormats(
-                        session, (uint32_t)runtimeFormats.size(), formatCountOutput, runtimeFormats.data());
+            util::CallTimer timer(m_measureCallOverhead);
+            XrResult result = XR_SUCCESS;
+            Session* sessionState = m_sessions.find(session);
+            if (sessionState) {
+                timer.setHistogram(sessionState->callOverhead[(size_t)Call::EnumerateSwapchainFormats]);
+                std::unique_lock lock(sessionState->formatsMutex);
+
+                if (!sessionState->hasFormats) {
+                    // Because we alter the number of formats, we must always perform a first call to get the real
+                    // number of formats.
+                    uint32_t runtimeFormatCount = 0;
+                    {
+                        util::CallTimer::Exclusion downstream(timer);
+                        result = OpenXrApi::xrEnumerateSwapchainFormats(session, 0, &runtimeFormatCount, nullptr);
+                    }
                     if (XR_SUCCEEDED(result)) {
-                        const auto& sessionState = m_sessions[session];
-
-                        // Translate supported formats.
-                        std::vector<int64_t> translatedFormats;
-
-#define TRANSLATE_FORMAT(table, type)                                                                                  \
-    {                                                                                                                  \
-        for (uint32_t i = 0; i < *formatCountOutput; i++) {                                                            \
-            for (size_t j = 0; j < ARRAYSIZE(table); j++) {                                                            \
-                if ((int64_t)table[j].dxgi == runtimeFormats[i]) {                                                     \
-                    translatedFormats.push_back((int64_t)table[j].type);                                               \
-                    break;                                                                                             \
-                }                                                                                                      \
-            }                                                                                                          \
-        }                                                                                                              \
-    }
-
-                        if (sessionState.api == GfxApi::Vulkan) {
-                            TRANSLATE_FORMAT(util::DxgiToVkFormat, vk);
-                        } else {
-                            TRANSLATE_FORMAT(util::DxgiToGlFormat, gl);
+                        // Query the real list of formats.
+                        std::vector<int64_t> runtimeFormats(runtimeFormatCount);
+                        {
+                            util::CallTimer::Exclusion downstream(timer);
+                            result = OpenXrApi::xrEnumerateSwapchainFormats(
+                                session, (uint32_t)runtimeFormats.size(), &runtimeFormatCount, runtimeFormats.data());
                         }
-#undef TRANSLATE_FORMAT
-
-                        // Always return the adjusted count.
-                        *formatCountOutput = (uint32_t)translatedFormats.size();
-                        if (formatCapacityInput && formatCapacityInput < *formatCountOutput) {
-                            result = XR_ERROR_SIZE_INSUFFICIENT;
+                        if (XR_SUCCEEDED(result)) {
+                            // Translate supported formats.
+                            for (uint32_t i = 0; i < runtimeFormatCount; i++) {
+                                const util::FormatInfo* format = util::GetFormatInfo((DXGI_FORMAT)runtimeFormats[i]);
+                                if (!format) {
+                                    continue;
+                                }
+                                const int64_t appFormat = sessionState->app->getFormat(*format);
+                                if (appFormat) {
+                                    sessionState->formats.push_back({format->dxgi, appFormat});
+                                }
+                            }
+                            sessionState->hasFormats = true;
+                            sessionState->orderedFormatsGeneration = ~0ull;
                         }
-
-                        // Output the edited list if needed.
-                        if (XR_SUCCEEDED(result) && formatCapacityInput && formats) {
-                            memcpy(formats, translatedFormats.data(), translatedFormats.size() * sizeof(int64_t));
+                    }
+                }
+
+                if (sessionState->hasFormats) {
+                    // Keep the runtime's order of preference, but list the formats that we know need a bounce copy
+                    // last.
+                    std::unique_lock bounceLock(m_bounceFormatsLock);
+                    if (sessionState->orderedFormatsGeneration != m_bounceFormatsGeneration) {
+                        auto& ordered = sessionState->orderedFormats;
+                        ordered.clear();
+                        for (const bool bounce : {false, true}) {
+                            for (const auto& [dxgi, translated] : sessionState->formats) {
+                                if ((m_bounceFormats.count(dxgi) != 0) == bounce) {
+                                    ordered.push_back(translated);
+                                }
+                            }
                         }
+                        sessionState->orderedFormatsGeneration = m_bounceFormatsGeneration;
+                    }
+                    bounceLock.unlock();
+
+                    // Always return the adjusted count.
+                    const auto& translatedFormats = sessionState->orderedFormats;
+                    *formatCountOutput = (uint32_t)translatedFormats.size();
+                    if (formatCapacityInput && formatCapacityInput < *formatCountOutput) {
+                        result = XR_ERROR_SIZE_INSUFFICIENT;
+                    }
+
+                    // Output the edited list if needed.
+                    if (XR_SUCCEEDED(result) && formatCapacityInput && formats) {
+                        memcpy(formats, translatedFormats.data(), translatedFormats.size() * sizeof(int64_t));
                     }
                 }
             } else {
@@ -916,7 +1769,8 @@ namespace {
                 return XR_ERROR_VALIDATION_FAILURE;
             }
 
-            std::unique_lock lock(m_globalLock);
+            std::unique_lock lock(m_instanceLock);
+            const auto startTime = std::chrono::steady_clock::now();
 
             TraceLoggingWrite(g_traceProvider,
                               "xrCreateSession",
@@ -925,9 +1779,17 @@ namespace {
                               TLArg(createInfo->createFlags, "CreateFlags"));
 
             XrGraphicsBindingD3D12KHR d3dBindings{XR_TYPE_GRAPHICS_BINDING_D3D12_KHR};
-            Session newSession;
-            newSession.xrInstance = instance;
+            auto newSession = std::make_unique<Session>();
+            newSession->xrInstance = instance;
+            if (m_measureLockContention) {
+                newSession->mutex.setStatistics(&newSession->lockStatistics[(size_t)Lock::Session]);
+                newSession->appQueueMutex.setStatistics(&newSession->lockStatistics[(size_t)Lock::AppQueue]);
+                newSession->copyMutex.setStatistics(&newSession->lockStatistics[(size_t)Lock::Copy]);
+                newSession->formatsMutex.setStatistics(&newSession->lockStatistics[(size_t)Lock::Formats]);
+            }
+            newSession->frameProfiler.setEnabled(m_frameProfilerPeriod != 0);
             bool handled = false;
+            capture::Api captureApi = capture::Api::Passthrough;
 
             // We will patch the pointer and restore it later.
             const XrBaseInStructure* const* patchedNext =
@@ -948,7 +1810,7 @@ namespace {
                         }
 
                         // Create D3D12 resources.
-                        initializeRuntimeResources(newSession);
+                        initializeRuntimeResources(*newSession);
 
                         // Create interop resources.
                         if (isVulkan) {
@@ -960,16 +1822,18 @@ namespace {
 
                             if (vkBindings->instance == VK_NULL_HANDLE || vkBindings->device == VK_NULL_HANDLE ||
                                 vkBindings->physicalDevice == VK_NULL_HANDLE) {
-                                return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+                                return abandonSession(*newSession, XR_ERROR_GRAPHICS_DEVICE_INVALID);
                             }
 
                             // Create the Vulkan resources.
-                            newSession.api = GfxApi::Vulkan;
+                            auto backend = std::make_unique<VulkanBackend>(*this);
+                            captureApi = capture::Api::Vulkan;
 
-                            const XrResult result = initializeVulkanResources(newSession, *vkBindings);
+                            const XrResult result = backend->initialize(*newSession, *vkBindings);
                             if (XR_FAILED(result)) {
-                                return result;
+                                return abandonSession(*newSession, result);
                             }
+                            newSession->app = std::move(backend);
                         } else {
                             const XrGraphicsBindingOpenGLWin32KHR* glBindings =
                                 reinterpret_cast<const XrGraphicsBindingOpenGLWin32KHR*>(entry);
@@ -978,15 +1842,18 @@ namespace {
                             Log("Using OpenGL interop\n");
 
                             if (!glBindings->hDC || !glBindings->hGLRC) {
-                                return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+                                return abandonSession(*newSession, XR_ERROR_GRAPHICS_DEVICE_INVALID);
                             }
 
                             // Create the OpenGL resources.
-                            newSession.api = GfxApi::OpenGL;
-                            const XrResult result = initializeOpenGLResources(newSession, *glBindings);
+                            auto backend = std::make_unique<OpenGLBackend>(*this);
+                            newSession->flipProjectionFov = true;
+                            captureApi = capture::Api::OpenGL;
+                            const XrResult result = backend->initialize(*newSession, *glBindings);
                             if (XR_FAILED(result)) {
-                                return result;
+                                return abandonSession(*newSession, result);
                             }
+                            newSession->app = std::move(backend);
 
                             // Check that the runtime supports mutable FOV.
                             XrViewConfigurationProperties properties{XR_TYPE_VIEW_CONFIGURATION_PROPERTIES};
@@ -1004,8 +1871,8 @@ namespace {
                         *const_cast<XrBaseInStructure**>(patchedNext) =
                             reinterpret_cast<XrBaseInStructure*>(&d3dBindings);
                         d3dBindings.next = entry->next;
-                        d3dBindings.device = newSession.runtimeDevice.Get();
-                        d3dBindings.queue = newSession.runtimeQueue.Get();
+                        d3dBindings.device = newSession->runtimeDevice.Get();
+                        d3dBindings.queue = newSession->runtimeQueue.Get();
 
                         handled = true;
 
@@ -1020,19 +1887,35 @@ namespace {
             const XrResult result = OpenXrApi::xrCreateSession(instance, createInfo, session);
             if (handled) {
                 if (XR_SUCCEEDED(result)) {
-                    newSession.xrSession = *session;
+                    newSession->xrSession = *session;
 
                     // On success, record the state.
-                    m_sessions.insert_or_assign(*session, std::move(newSession));
+                    std::unique_lock registryLock(m_registryLock);
+                    newSession->epoch = ++m_sessionEpoch;
+                    m_sessions.insert(*session, std::move(newSession));
                 } else {
-                    cleanupSession(newSession);
+                    abandonSession(*newSession, result);
                 }
 
                 *const_cast<const XrBaseInStructure**>(patchedNext) = oldNext;
             }
 
             if (XR_SUCCEEDED(result)) {
-                TraceLoggingWrite(g_traceProvider, "xrCreateSession", TLXArg(*session, "Session"));
+                const auto durationUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                            std::chrono::steady_clock::now() - startTime)
+                                            .count();
+                Log("Session created in %.3f ms\n", durationUs / 1000.0);
+                TraceLoggingWrite(g_traceProvider,
+                                  "xrCreateSession",
+                                  TLXArg(*session, "Session"),
+                                  TLArg(durationUs, "DurationUs"));
+
+                if (m_capture.isOpen()) {
+                    m_capture.write(capture::RecordType::CreateSession,
+                                    startTime,
+                                    result,
+                                    capture::SessionRecord{(uint64_t)*session, captureApi});
+                }
             }
 
             return result;
@@ -1040,16 +1923,26 @@ namespace {
 
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrDestroySession
         XrResult xrDestroySession(XrSession session) override {
-            std::unique_lock lock(m_globalLock);
+            // Exclusive access to the registry guarantees that no other thread is using the session or its swapchains.
+            std::unique_lock registryLock(m_registryLock);
 
             TraceLoggingWrite(g_traceProvider, "xrDestroySession", TLXArg(session, "Session"));
 
+            const auto startTime = std::chrono::steady_clock::now();
             const XrResult result = OpenXrApi::xrDestroySession(session);
-            if (XR_SUCCEEDED(result) && isSessionHandled(session)) {
-                auto& sessionState = m_sessions[session];
+            if (XR_SUCCEEDED(result)) {
+                Session* sessionState = m_sessions.find(session);
+                if (sessionState) {
+                    cleanupSession(*sessionState);
+                    m_sessions.erase(session);
+                }
+            }
 
-                cleanupSession(sessionState);
-                m_sessions.erase(session);
+            if (m_capture.isOpen()) {
+                m_capture.write(capture::RecordType::DestroySession,
+                                startTime,
+                                result,
+                                capture::SessionRecord{(uint64_t)session, capture::Api::Passthrough});
             }
 
             return result;
@@ -1063,7 +1956,7 @@ namespace {
                 return XR_ERROR_VALIDATION_FAILURE;
             }
 
-            std::unique_lock lock(m_globalLock);
+            std::shared_lock registryLock(m_registryLock);
 
             TraceLoggingWrite(g_traceProvider,
                               "xrCreateSwapchain",
@@ -1079,11 +1972,13 @@ namespace {
                               TLArg(createInfo->usageFlags, "UsageFlags"));
 
             XrSwapchainCreateInfo chainCreateInfo = *createInfo;
-            Swapchain newSwapchain;
-            bool handled = false;
+            auto newSwapchain = std::make_unique<Swapchain>();
 
-            if (isSessionHandled(session)) {
-                const auto& sessionState = m_sessions[session];
+            Session* sessionState = m_sessions.find(session);
+            if (sessionState) {
+                if (m_measureLockContention) {
+                    newSwapchain->mutex.setStatistics(&sessionState->lockStatistics[(size_t)Lock::Swapchain]);
+                }
 
                 Log("Creating swapchain with dimensions=%ux%u, arraySize=%u, mipCount=%u, sampleCount=%u, "
                     "format=%d, "
@@ -1097,61 +1992,141 @@ namespace {
                     createInfo->usageFlags);
 
                 // Translate the format.
-#define TRANSLATE_FORMAT(table, type)                                                                                  \
-    for (size_t i = 0; i < ARRAYSIZE(table); i++) {                                                                    \
-        if (table[i].type == createInfo->format) {                                                                     \
-            chainCreateInfo.format = table[i].dxgi;                                                                    \
-            break;                                                                                                     \
-        }                                                                                                              \
-    }
-
-                if (sessionState.api == GfxApi::Vulkan) {
-                    TRANSLATE_FORMAT(util::DxgiToVkFormat, vk);
-                } else {
-                    TRANSLATE_FORMAT(util::DxgiToGlFormat, gl);
+                const util::FormatInfo* format = sessionState->app->getFormatInfo(createInfo->format);
+                if (format) {
+                    chainCreateInfo.format = format->dxgi;
                 }
 
                 Log("Translated format: %d\n", chainCreateInfo.format);
 
-                newSwapchain.xrSession = session;
-                newSwapchain.createInfo = *createInfo;
-
-                handled = true;
+                newSwapchain->frame.session = sessionState;
+                newSwapchain->createInfo = *createInfo;
             }
+            const uint64_t sessionEpoch = sessionState ? sessionState->epoch : 0;
+
+            // Do not hold the registry lock across the runtime call and the import: a pending exclusive request would
+            // block the other threads (and the frame loop) for their whole duration. The application may not destroy
+            // the session while creating one of its swapchains (external synchronization), and the new swapchain is
+            // not visible to other threads yet. We only use the immutable part of the session state (or the
+            // queue/context under appQueueMutex), and we do not hold the session lock either.
+            registryLock.unlock();
+
+            const auto startTime = std::chrono::steady_clock::now();
+            XrResult result = OpenXrApi::xrCreateSwapchain(session, &chainCreateInfo, swapchain);
+            if (XR_SUCCEEDED(result) && sessionState) {
+                newSwapchain->xrSwapchain = *swapchain;
+
+                const auto importTime = std::chrono::steady_clock::now();
+                if (!m_swapchainCacheMaxBytes || !reuseCachedSwapchain(*sessionState, *newSwapchain)) {
+                    sessionState->app->initializeSwapchain(*sessionState, *newSwapchain);
+                }
+                const auto endTime = std::chrono::steady_clock::now();
+
+                // Account for the memory of the new swapchain. The application images of a reused swapchain are
+                // already accounted for.
+                {
+                    SwapchainMemory& memory = newSwapchain->memory;
+                    const UINT64 imageBytes = newSwapchain->imageAllocationBytes;
+                    const size_t appImageCount = sessionState->app->getImageCount(*newSwapchain);
+                    SwapchainMemory added;
+                    added.runtimeBytes = imageBytes * newSwapchain->frame.runtimeImages.size();
+                    if (!memory.importedBytes) {
+                        added.bounceBytes = imageBytes * newSwapchain->shareableImages.size();
+                        added.importedBytes = imageBytes * appImageCount;
+                    }
+                    memory.runtimeBytes += added.runtimeBytes;
+                    memory.bounceBytes += added.bounceBytes;
+                    memory.importedBytes += added.importedBytes;
+                    updateVramLedger(*sessionState, added, false);
+
+                    Log("Swapchain memory: runtime %.1f MB, bounce %.1f MB, imported %.1f MB\n",
+                        memory.runtimeBytes / (1024.0 * 1024.0),
+                        memory.bounceBytes / (1024.0 * 1024.0),
+                        memory.importedBytes / (1024.0 * 1024.0));
+                    TraceLoggingWrite(g_traceProvider,
+                                      "xrCreateSwapchain_Memory",
+                                      TLArg(imageBytes, "ImageAllocationBytes"),
+                                      TLArg(memory.runtimeBytes, "RuntimeBytes"),
+                                      TLArg(memory.bounceBytes, "BounceBytes"),
+                                      TLArg(memory.importedBytes, "ImportedBytes"));
+                }
 
-            const XrResult result = OpenXrApi::xrCreateSwapchain(session, &chainCreateInfo, swapchain);
-            if (XR_SUCCEEDED(result) && handled) {
-                const auto& sessionState = m_sessions[session];
-
-                newSwapchain.xrSwapchain = *swapchain;
-
-                if (sessionState.api == GfxApi::Vulkan) {
-                    initializeVulkanSwapchain(sessionState, newSwapchain);
+                const auto runtimeUs =
+                    std::chrono::duration_cast<std::chrono::microseconds>(importTime - startTime).count();
+                const auto importUs =
+                    std::chrono::duration_cast<std::chrono::microseconds>(endTime - importTime).count();
+                Log("Swapchain created in %.3f ms (runtime: %.3f ms, import: %.3f ms)\n",
+                    (runtimeUs + importUs) / 1000.0,
+                    runtimeUs / 1000.0,
+                    importUs / 1000.0);
+                TraceLoggingWrite(g_traceProvider,
+                                  "xrCreateSwapchain_Latency",
+                                  TLArg(runtimeUs, "RuntimeUs"),
+                                  TLArg(importUs, "ImportUs"));
+
+                // On success, record the state, unless the session was destroyed in the meantime (along with its
+                // swapchains and the resources of its backend).
+                std::unique_lock exclusiveRegistryLock(m_registryLock);
+                if (findSession(session, sessionEpoch)) {
+                    newSwapchain->epoch = ++m_swapchainEpoch;
+                    m_swapchains.insert(*swapchain, std::move(newSwapchain));
                 } else {
-                    initializeOpenGLSwapchain(sessionState, newSwapchain);
+                    // The application images belonged to the destroyed backend, only drop our references.
+                    ErrorLog("Session was destroyed while creating swapchain\n");
+                    result = XR_ERROR_SESSION_LOST;
                 }
-
-                // On success, record the state.
-                m_swapchains.insert_or_assign(*swapchain, std::move(newSwapchain));
             }
 
             TraceLoggingWrite(g_traceProvider, "xrCreateSwapchain", TLXArg(*swapchain, "Swapchain"));
 
+            if (m_capture.isOpen() && XR_SUCCEEDED(result)) {
+                capture::CreateSwapchainRecord record{};
+                record.session = (uint64_t)session;
+                record.swapchain = (uint64_t)*swapchain;
+                record.format = createInfo->format;
+                record.usageFlags = createInfo->usageFlags;
+                record.createFlags = createInfo->createFlags;
+                record.sampleCount = createInfo->sampleCount;
+                record.width = createInfo->width;
+                record.height = createInfo->height;
+                record.faceCount = createInfo->faceCount;
+                record.arraySize = createInfo->arraySize;
+                record.mipCount = createInfo->mipCount;
+                m_capture.write(capture::RecordType::CreateSwapchain, startTime, result, record);
+            }
+
             return result;
         }
 
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrDestroySwapchain
         XrResult xrDestroySwapchain(XrSwapchain swapchain) override {
-            std::unique_lock lock(m_globalLock);
-
             TraceLoggingWrite(g_traceProvider, "xrDestroySwapchain", TLXArg(swapchain, "Swapchain"));
 
+            const auto startTime = std::chrono::steady_clock::now();
             const XrResult result = OpenXrApi::xrDestroySwapchain(swapchain);
-            if (XR_SUCCEEDED(result) && isSwapchainHandled(swapchain)) {
-                auto& swapchainState = m_swapchains[swapchain];
+            if (XR_SUCCEEDED(result)) {
+                // Only hold exclusive access to the registry for the removal, not for the cleanup.
+                std::unique_ptr<Swapchain> swapchainState;
+                {
+                    std::unique_lock registryLock(m_registryLock);
+                    swapchainState = m_swapchains.erase(swapchain);
+                }
+                if (swapchainState) {
+                    std::shared_lock registryLock(m_registryLock);
+                    Session& sessionState = *swapchainState->frame.session;
+                    std::unique_lock sessionLock(sessionState.mutex);
+
+                    // Do not drain the devices: the resources are released once they are no longer in use.
+                    retireSwapchain(sessionState, std::move(swapchainState));
+                    collectRetiredSwapchains(sessionState);
+                }
+            }
 
-                cleanupSwapchain(swapchainState);
-                m_swapchains.erase(swapchain);
+            if (m_capture.isOpen()) {
+                m_capture.write(capture::RecordType::DestroySwapchain,
+                                startTime,
+                                result,
+                                capture::SwapchainRecord{(uint64_t)swapchain});
             }
 
             return result;
@@ -1162,7 +2137,7 @@ namespace {
                                             uint32_t imageCapacityInput,
                                             uint32_t* imageCountOutput,
                                             XrSwapchainImageBaseHeader* images) override {
-            std::unique_lock lock(m_globalLock);
+            std::shared_lock registryLock(m_registryLock);
 
             TraceLoggingWrite(g_traceProvider,
                               "xrEnumerateSwapchainImages",
@@ -1170,20 +2145,18 @@ namespace {
                               TLArg(imageCapacityInput, "ImageCapacityInput"));
 
             XrResult result = XR_ERROR_RUNTIME_FAILURE;
-            if (isSwapchainHandled(swapchain) && imageCapacityInput) {
-                const auto& swapchainState = m_swapchains[swapchain];
-                const auto& sessionState = m_sessions[swapchainState.xrSession];
+            const Swapchain* swapchainStatePtr = m_swapchains.find(swapchain);
+            if (swapchainStatePtr) {
+                const auto& swapchainState = *swapchainStatePtr;
+                const auto& sessionState = *swapchainState.frame.session;
 
                 // Return the Vulkan or OpenGL images instead of the runtime ones.
 
-                if (sessionState.api == GfxApi::Vulkan) {
-                    *imageCountOutput = (uint32_t)swapchainState.vk.images.size();
-                } else {
-                    *imageCountOutput = (uint32_t)swapchainState.gl.images.size();
-                }
+                *imageCountOutput = sessionState.app->getImageCount(swapchainState);
 
+                // The number of images might differ from the runtime's (see virtual images).
                 result = XR_SUCCESS;
-                if (imageCapacityInput < *imageCountOutput) {
+                if (imageCapacityInput && imageCapacityInput < *imageCountOutput) {
                     result = XR_ERROR_SIZE_INSUFFICIENT;
                 }
 
@@ -1192,27 +2165,7 @@ namespace {
                         g_traceProvider, "xrEnumerateSwapchainImages", TLArg(*imageCountOutput, "ImageCountOutput"));
 
                     if (imageCapacityInput && images) {
-                        if (sessionState.api == GfxApi::Vulkan) {
-                            XrSwapchainImageVulkanKHR* vkImages = reinterpret_cast<XrSwapchainImageVulkanKHR*>(images);
-                            for (uint32_t i = 0; i < *imageCountOutput; i++) {
-                                vkImages[i].image = swapchainState.vk.images[i];
-
-                                TraceLoggingWrite(g_traceProvider,
-                                                  "xrEnumerateSwapchainImages",
-                                                  TLArg("Vulkan", "Api"),
-                                                  TLXArg(vkImages[i].image, "Texture"));
-                            }
-                        } else {
-                            XrSwapchainImageOpenGLKHR* glImages = reinterpret_cast<XrSwapchainImageOpenGLKHR*>(images);
-                            for (uint32_t i = 0; i < *imageCountOutput; i++) {
-                                glImages[i].image = swapchainState.gl.images[i];
-
-                                TraceLoggingWrite(g_traceProvider,
-                                                  "xrEnumerateSwapchainImages",
-                                                  TLArg("OpenGL", "Api"),
-                                                  TLArg(glImages[i].image, "Texture"));
-                            }
-                        }
+                        sessionState.app->getImages(swapchainState, images);
                     }
                 }
             } else {
@@ -1231,88 +2184,406 @@ namespace {
         XrResult xrAcquireSwapchainImage(XrSwapchain swapchain,
                                          const XrSwapchainImageAcquireInfo* acquireInfo,
                                          uint32_t* index) override {
-            std::unique_lock lock(m_globalLock);
+            if (!m_capture.isOpen()) {
+                return acquireSwapchainImage(swapchain, acquireInfo, index);
+            }
+
+            const auto startTime = std::chrono::steady_clock::now();
+            const XrResult result = acquireSwapchainImage(swapchain, acquireInfo, index);
+            m_capture.write(capture::RecordType::AcquireSwapchainImage,
+                            startTime,
+                            result,
+                            capture::SwapchainRecord{(uint64_t)swapchain, XR_SUCCEEDED(result) ? (int64_t)*index : -1});
+            return result;
+        }
 
+        XrResult acquireSwapchainImage(XrSwapchain swapchain,
+                                       const XrSwapchainImageAcquireInfo* acquireInfo,
+                                       uint32_t* index) {
             TraceLoggingWrite(g_traceProvider, "xrAcquireSwapchainImage", TLXArg(swapchain, "Swapchain"));
 
+            util::CallTimer timer(m_measureCallOverhead);
+            uint64_t epoch = 0;
             {
-                auto it = m_swapchains.find(swapchain);
-                if (it != m_swapchains.end()) {
-                    if (it->second.deferredRelease) {
+                std::shared_lock registryLock(m_registryLock);
+
+                Swapchain* swapchainState = m_swapchains.find(swapchain);
+                if (swapchainState) {
+                    epoch = swapchainState->epoch;
+                    timer.setHistogram(
+                        swapchainState->frame.session->callOverhead[(size_t)Call::AcquireSwapchainImage]);
+                    std::unique_lock lock(swapchainState->mutex);
+
+                    // The application is going to write to the image.
+                    auto& frame = swapchainState->frame;
+                    frame.usedSinceLastPoll = true;
+                    if (frame.evicted) {
+                        makeSwapchainResident(*frame.session, *swapchainState);
+                    }
+
+                    // With virtual images, the runtime is not involved.
+                    if (frame.virtualImages) {
+                        if (frame.acquiredCount == frame.acquiredIndex.size()) {
+                            return XR_ERROR_CALL_ORDER_INVALID;
+                        }
+
+                        *index = frame.nextVirtualIndex;
+                        frame.nextVirtualIndex = (frame.nextVirtualIndex + 1) % frame.acquiredIndex.size();
+                        frame.acquiredIndex[(frame.acquiredHead + frame.acquiredCount++) %
+                                            frame.acquiredIndex.size()] = *index;
+
+                        TraceLoggingWrite(g_traceProvider, "xrAcquireSwapchainImage", TLArg(*index, "VirtualIndex"));
+
+                        return XR_SUCCESS;
+                    }
+
+                    if (frame.deferredRelease) {
                         // If we already deferred release this frame, and the application now wants to acquire a new
                         // image, then release the previous image before acquiring a new one.
                         TraceLoggingWrite(g_traceProvider,
                                           "xrAcquireSwapchainImage_DeferredSwapchainRelease",
                                           TLXArg(swapchain, "Swapchain"));
+                        util::CallTimer::Exclusion downstream(timer);
                         CHECK_XRCMD(OpenXrApi::xrReleaseSwapchainImage(swapchain, nullptr));
-                        it->second.deferredRelease = false;
+                        frame.deferredRelease = false;
                     }
                 }
             }
 
-            lock.unlock();
-            const XrResult result = OpenXrApi::xrAcquireSwapchainImage(swapchain, acquireInfo, index);
-            lock.lock();
+            // Do not hold the registry nor the swapchain lock while the runtime might be waiting. A writer waiting for
+            // the registry lock would otherwise block all the other lookups, including the ones of xrEndFrame().
+            XrResult result;
+            {
+                util::CallTimer::Exclusion downstream(timer);
+                result = OpenXrApi::xrAcquireSwapchainImage(swapchain, acquireInfo, index);
+            }
 
             if (XR_SUCCEEDED(result)) {
                 TraceLoggingWrite(g_traceProvider, "xrAcquireSwapchainImage", TLArg(*index, "Index"));
 
-                auto it = m_swapchains.find(swapchain);
-                if (it != m_swapchains.end()) {
-                    Swapchain& entry = it->second;
-                    entry.acquiredIndex.push_back(*index);
+                if (epoch) {
+                    std::shared_lock registryLock(m_registryLock);
+                    Swapchain* swapchainState = findSwapchain(swapchain, epoch);
+                    if (swapchainState) {
+                        std::unique_lock lock(swapchainState->mutex);
+                        auto& frame = swapchainState->frame;
+                        CHECK_MSG(frame.acquiredCount < frame.acquiredIndex.size(), "Too many acquired images");
+                        frame.acquiredIndex[(frame.acquiredHead + frame.acquiredCount++) %
+                                            frame.acquiredIndex.size()] = *index;
+                    }
                 }
             }
 
             return result;
         }
 
+        // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrWaitSwapchainImage
+        XrResult xrWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo) override {
+            if (!m_capture.isOpen()) {
+                return waitSwapchainImage(swapchain, waitInfo);
+            }
+
+            const auto startTime = std::chrono::steady_clock::now();
+            const XrResult result = waitSwapchainImage(swapchain, waitInfo);
+            m_capture.write(capture::RecordType::WaitSwapchainImage,
+                            startTime,
+                            result,
+                            capture::SwapchainRecord{(uint64_t)swapchain, waitInfo->timeout});
+            return result;
+        }
+
+        XrResult waitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo) {
+            if (waitInfo->type != XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            TraceLoggingWrite(g_traceProvider,
+                              "xrWaitSwapchainImage",
+                              TLXArg(swapchain, "Swapchain"),
+                              TLArg(waitInfo->timeout, "Timeout"));
+
+            // With virtual images, we only need to wait for our last copy from the image to complete.
+            uint64_t epoch = 0;
+            ID3D12Fence* fence = nullptr;
+            UINT64 copyFenceValue = 0;
+            HANDLE copyEvent = nullptr;
+            {
+                std::shared_lock registryLock(m_registryLock);
+
+                Swapchain* swapchainState = m_swapchains.find(swapchain);
+                if (swapchainState) {
+                    std::unique_lock lock(swapchainState->mutex);
+
+                    auto& frame = swapchainState->frame;
+                    if (frame.virtualImages) {
+                        if (frame.waitedCount == frame.acquiredCount) {
+                            return XR_ERROR_CALL_ORDER_INVALID;
+                        }
+
+                        const uint32_t index =
+                            frame.acquiredIndex[(frame.acquiredHead + frame.waitedCount) % frame.acquiredIndex.size()];
+                        epoch = swapchainState->epoch;
+                        fence = frame.session->copyCommandLists.getFence();
+                        copyFenceValue = frame.copyFenceValue[index];
+                        copyEvent = frame.copyEvent.get();
+
+                        TraceLoggingWrite(g_traceProvider,
+                                          "xrWaitSwapchainImage_Sync",
+                                          TLArg(index, "VirtualIndex"),
+                                          TLArg(copyFenceValue, "FenceValue"));
+                    }
+                }
+            }
+
+            if (!epoch) {
+                // Do not hold the registry lock while the runtime might be waiting.
+                return OpenXrApi::xrWaitSwapchainImage(swapchain, waitInfo);
+            }
+
+            // Do not hold the registry nor the swapchain lock while waiting for the copy. The event is auto-reset, but
+            // it may have been signaled by the completion armed during an earlier wait that timed out: reset it before
+            // arming, and only trust the fence value.
+            const bool infinite = waitInfo->timeout == XR_INFINITE_DURATION;
+            const auto deadline =
+                std::chrono::steady_clock::now() + std::chrono::nanoseconds(infinite ? 0 : waitInfo->timeout);
+            while (fence->GetCompletedValue() < copyFenceValue) {
+                DWORD timeout = INFINITE;
+                if (!infinite) {
+                    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now());
+                    timeout = (DWORD)std::clamp<int64_t>(remaining.count(), 0, INFINITE - 1);
+                }
+
+                ResetEvent(copyEvent);
+                CHECK_HRCMD(fence->SetEventOnCompletion(copyFenceValue, copyEvent));
+                if (WaitForSingleObject(copyEvent, timeout) != WAIT_OBJECT_0 &&
+                    fence->GetCompletedValue() < copyFenceValue) {
+                    return XR_TIMEOUT_EXPIRED;
+                }
+            }
+
+            std::shared_lock registryLock(m_registryLock);
+            Swapchain* swapchainState = findSwapchain(swapchain, epoch);
+            if (swapchainState) {
+                std::unique_lock lock(swapchainState->mutex);
+                swapchainState->frame.waitedCount++;
+            }
+
+            return XR_SUCCESS;
+        }
+
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrReleaseSwapchainImage
         XrResult xrReleaseSwapchainImage(XrSwapchain swapchain,
                                          const XrSwapchainImageReleaseInfo* releaseInfo) override {
-            std::unique_lock lock(m_globalLock);
+            if (!m_capture.isOpen()) {
+                return releaseSwapchainImage(swapchain, releaseInfo);
+            }
+
+            const auto startTime = std::chrono::steady_clock::now();
+            const XrResult result = releaseSwapchainImage(swapchain, releaseInfo);
+            m_capture.write(capture::RecordType::ReleaseSwapchainImage,
+                            startTime,
+                            result,
+                            capture::SwapchainRecord{(uint64_t)swapchain});
+            return result;
+        }
 
+        XrResult releaseSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageReleaseInfo* releaseInfo) {
             TraceLoggingWrite(g_traceProvider, "xrReleaseSwapchainImage", TLXArg(swapchain, "Swapchain"));
 
-            bool deferRelease = false;
+            util::CallTimer timer(m_measureCallOverhead);
+            uint64_t epoch = 0;
             {
-                auto it = m_swapchains.find(swapchain);
-                if (it != m_swapchains.end()) {
-                    // If we must perform a copy (due to the runtime images not being shareable), defer release to
-                    // ensure that xrEndFrame() can copy the image written by the application to the runtime swapchain.
-                    deferRelease = it->second.deferredRelease = !it->second.shareableImages.empty();
+                std::shared_lock registryLock(m_registryLock);
+
+                Swapchain* swapchainState = m_swapchains.find(swapchain);
+                if (swapchainState) {
+                    epoch = swapchainState->epoch;
+                    timer.setHistogram(
+                        swapchainState->frame.session->callOverhead[(size_t)Call::ReleaseSwapchainImage]);
+                    std::unique_lock lock(swapchainState->mutex);
+
+                    // Signal the interop fence now, so that the D3D12 side only needs to wait for the work that was
+                    // submitted for this image.
+                    auto& frame = swapchainState->frame;
+                    if (m_signalOnRelease && frame.acquiredCount) {
+                        const uint32_t index = frame.acquiredIndex[frame.acquiredHead];
+                        frame.readyFenceValue[index] = signalInteropFence(*frame.session);
+                        TraceLoggingWrite(g_traceProvider,
+                                          "xrReleaseSwapchainImage_Sync",
+                                          TLArg(index, "Index"),
+                                          TLArg(frame.readyFenceValue[index], "FenceValue"));
+                    }
+
+                    bool deferRelease = false;
+                    if (frame.virtualImages) {
+                        // The runtime image is acquired, copied to and released during xrEndFrame().
+                        deferRelease = true;
+                    } else if (m_copyOnRelease && frame.needCopy && frame.acquiredCount) {
+                        // Copy the entire image written by the application to the runtime swapchain now, so that the
+                        // runtime image can be released right away.
+                        const uint32_t index = frame.acquiredIndex[frame.acquiredHead];
+                        CopyRequest copy{};
+                        copy.source = swapchainState->shareableImages[index].Get();
+                        copy.destination = frame.runtimeImages[index];
+                        copy.subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+                        copy.destinationState = frame.runtimeImageState;
+                        copy.format = frame.format;
+                        copy.imageBytes = frame.imageBytes;
+
+                        Session& session = *frame.session;
+                        std::unique_lock copyLock(session.copyMutex);
+                        waitInteropFence(session, frame.readyFenceValue[index]);
+                        submitCopies(session, &copy, 1, frame.readyFenceValue[index]);
+                    } else {
+                        // If we must perform a copy (due to the runtime images not being shareable), defer release
+                        // to ensure that xrEndFrame() can copy the image written by the application to the runtime
+                        // swapchain.
+                        deferRelease = frame.deferredRelease = frame.needCopy;
+                    }
+
+                    if (deferRelease) {
+                        TraceLoggingWrite(g_traceProvider, "xrReleaseSwapchainImage_Defer");
+                        advanceReleasedImage(*swapchainState);
+                        return XR_SUCCESS;
+                    }
                 }
             }
 
-            XrResult result = XR_ERROR_RUNTIME_FAILURE;
-            if (!deferRelease) {
-                lock.unlock();
+            // Do not hold the registry nor the swapchain lock while calling the runtime.
+            XrResult result;
+            {
+                util::CallTimer::Exclusion downstream(timer);
                 result = OpenXrApi::xrReleaseSwapchainImage(swapchain, releaseInfo);
-                lock.lock();
-            } else {
-                TraceLoggingWrite(g_traceProvider, "xrReleaseSwapchainImage_Defer");
-                result = XR_SUCCESS;
             }
 
-            if (XR_SUCCEEDED(result)) {
-                auto it = m_swapchains.find(swapchain);
-                if (it != m_swapchains.end()) {
-                    Swapchain& entry = it->second;
-                    entry.lastReleasedIndex = entry.acquiredIndex.front();
-                    entry.acquiredIndex.pop_front();
+            if (XR_SUCCEEDED(result) && epoch) {
+                std::shared_lock registryLock(m_registryLock);
+                Swapchain* swapchainState = findSwapchain(swapchain, epoch);
+                if (swapchainState) {
+                    std::unique_lock lock(swapchainState->mutex);
+                    advanceReleasedImage(*swapchainState);
                 }
             }
 
             return result;
         }
 
+        // Retire the oldest acquired image of a swapchain upon its release. Must be called with the swapchain lock
+        // held.
+        static void advanceReleasedImage(Swapchain& swapchain) {
+            auto& frame = swapchain.frame;
+            if (frame.acquiredCount) {
+                frame.lastReleasedIndex = frame.acquiredIndex[frame.acquiredHead];
+                frame.acquiredHead = (frame.acquiredHead + 1) % frame.acquiredIndex.size();
+                frame.acquiredCount--;
+                frame.waitedCount = frame.waitedCount ? frame.waitedCount - 1 : 0;
+                frame.generation++;
+            }
+        }
+
+        // Acquire and wait for the runtime image that the copy from a virtual image will write to, unless the runtime
+        // image already holds the latest content. This is done before xrEndFrame() takes the session lock, and without
+        // holding the registry nor the swapchain lock while the runtime is waiting. The wait is bounded: when it times
+        // out, the image remains acquired and is waited for again on the next frame. The runtime calls are excluded
+        // from the timer of xrEndFrame().
+        void prepareRuntimeImage(XrSwapchain swapchain, util::CallTimer& timer) {
+            uint64_t epoch = 0;
+            bool acquired = false;
+            {
+                std::shared_lock registryLock(m_registryLock);
+
+                Swapchain* swapchainState = m_swapchains.find(swapchain);
+                if (!swapchainState) {
+                    return;
+                }
+
+                std::unique_lock lock(swapchainState->mutex);
+                const auto& frame = swapchainState->frame;
+                if (!frame.virtualImages || !frame.needCopy || frame.runtimeImageWaited) {
+                    return;
+                }
+                const auto& content = frame.runtimeImageContent[frame.runtimeAcquiredIndex];
+                if (!frame.runtimeImageAcquired && content.generation == frame.generation && content.wholeImage) {
+                    return;
+                }
+                epoch = swapchainState->epoch;
+                acquired = frame.runtimeImageAcquired;
+            }
+
+            uint32_t index = 0;
+            XrResult waitResult;
+            {
+                util::CallTimer::Exclusion downstream(timer);
+                if (!acquired) {
+                    CHECK_XRCMD(OpenXrApi::xrAcquireSwapchainImage(swapchain, nullptr, &index));
+                }
+                XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                waitInfo.timeout = RuntimeImageWaitTimeout;
+                waitResult = OpenXrApi::xrWaitSwapchainImage(swapchain, &waitInfo);
+                CHECK_XRCMD(waitResult);
+            }
+
+            TraceLoggingWrite(g_traceProvider,
+                              "xrEndFrame_PrepareRuntimeImage",
+                              TLXArg(swapchain, "Swapchain"),
+                              TLArg(acquired, "AlreadyAcquired"),
+                              TLArg(xr::ToCString(waitResult), "WaitResult"));
+
+            std::shared_lock registryLock(m_registryLock);
+            Swapchain* swapchainState = findSwapchain(swapchain, epoch);
+            if (swapchainState) {
+                std::unique_lock lock(swapchainState->mutex);
+                auto& frame = swapchainState->frame;
+                if (!acquired) {
+                    frame.runtimeAcquiredIndex = index;
+                    frame.runtimeImageAcquired = true;
+                }
+                frame.runtimeImageWaited = waitResult == XR_SUCCESS;
+            }
+        }
+
+        // Look up the state of a swapchain again, after a call to the runtime made without holding the registry lock.
+        // Returns nullptr if the swapchain was destroyed in the meantime, even if its handle was since reused. Must be
+        // called with the registry lock held.
+        Swapchain* findSwapchain(XrSwapchain swapchain, uint64_t epoch) const {
+            Swapchain* swapchainState = m_swapchains.find(swapchain);
+            return swapchainState && swapchainState->epoch == epoch ? swapchainState : nullptr;
+        }
+
+        // Same as findSwapchain(), for a session.
+        Session* findSession(XrSession session, uint64_t epoch) const {
+            Session* sessionState = m_sessions.find(session);
+            return sessionState && sessionState->epoch == epoch ? sessionState : nullptr;
+        }
+
         // https://www.khronos.org/registry/OpenXR/specs/1.0/html/xrspec.html#xrEndFrame
         XrResult xrEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo) override {
+            if (!m_capture.isOpen()) {
+                return endFrame(session, frameEndInfo);
+            }
+
+            const auto startTime = std::chrono::steady_clock::now();
+            const XrResult result = endFrame(session, frameEndInfo);
+            m_capture.writeWith(
+                capture::RecordType::EndFrame, startTime, result, [&](capture::CaptureWriter::Payload& payload) {
+                    captureFrame(payload, session, *frameEndInfo);
+                });
+            return result;
+        }
+
+        XrResult endFrame(XrSession session, const XrFrameEndInfo* frameEndInfo) {
             if (frameEndInfo->type != XR_TYPE_FRAME_END_INFO) {
                 return XR_ERROR_VALIDATION_FAILURE;
             }
 
-            std::unique_lock lock(m_globalLock);
+            util::CallTimer timer(m_measureCallOverhead);
+
+            // Acquire the runtime images that the copies from virtual images write to before taking any lock.
+            forEachSubImage(*frameEndInfo,
+                            [&](const XrSwapchainSubImage& image) { prepareRuntimeImage(image.swapchain, timer); });
+
+            std::shared_lock registryLock(m_registryLock);
 
             TraceLoggingWrite(g_traceProvider,
                               "xrEndFrame",
@@ -1323,163 +2594,205 @@ namespace {
             // Because the frame info is passed const, we are going to need to reconstruct a writable version of
             // it to patch the FOV and invert the image with OpenGL.
             XrFrameEndInfo chainFrameEndInfo = *frameEndInfo;
-            std::vector<const XrCompositionLayerBaseHeader*> correctedLayers;
-
-            std::vector<XrCompositionLayerProjection> layerProjectionAllocator;
-            std::vector<std::array<XrCompositionLayerProjectionView, 2>> layerProjectionViewsAllocator;
-
-            if (isSessionHandled(session)) {
-                auto& sessionState = m_sessions[session];
-
-                // Signal the semaphore from the Vulkan queue/OpenGL context, and wait for it on the D3D12
-                // queue. This effectively serializes the app work between Vulkan/OpenGL and D3D12.
-                sessionState.fenceValue++;
-                TraceLoggingWrite(g_traceProvider, "xrEndFrame_Sync", TLArg(sessionState.fenceValue, "FenceValue"));
-                if (sessionState.api == GfxApi::Vulkan) {
-                    VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
-                    timelineInfo.signalSemaphoreValueCount = 1;
-                    timelineInfo.pSignalSemaphoreValues = &sessionState.fenceValue;
-                    VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO, &timelineInfo};
-                    submitInfo.signalSemaphoreCount = 1;
-                    submitInfo.pSignalSemaphores = &sessionState.vk.timelineSemaphore;
-                    CHECK_VKCMD(
-                        sessionState.vk.dispatch.vkQueueSubmit(sessionState.vk.queue, 1, &submitInfo, VK_NULL_HANDLE));
-                } else {
-                    GlContextSwitch context(sessionState);
-
-                    sessionState.gl.dispatch.glSemaphoreParameterui64vEXT(
-                        sessionState.gl.semaphore, GL_D3D12_FENCE_VALUE_EXT, &sessionState.fenceValue);
 
-                    sessionState.gl.dispatch.glSignalSemaphoreEXT(
-                        sessionState.gl.semaphore, 0, nullptr, 0, nullptr, nullptr);
-
-                    glFlush();
+            Session* sessionStatePtr = m_sessions.find(session);
+            if (sessionStatePtr) {
+                auto& sessionState = *sessionStatePtr;
+                timer.setHistogram(sessionState.callOverhead[(size_t)Call::EndFrame]);
+                std::unique_lock sessionLock(sessionState.mutex);
+                auto& profiler = sessionState.frameProfiler;
+                profiler.start();
+
+                // Reset the frame arena. The containers keep their storage from one frame to the next.
+                auto& arena = sessionState.frameArena;
+                const size_t arenaCapacity = arena.capacity();
+                arena.clear();
+
+                // Signal the semaphore from the Vulkan queue/OpenGL context, and wait for it on the D3D12 queue (see
+                // below). This effectively serializes the app work between Vulkan/OpenGL and D3D12. When signaling upon
+                // release of the swapchain images, we instead wait for the values associated with the images used
+                // in this frame.
+                UINT64 waitFenceValue = 0;
+                if (!m_signalOnRelease) {
+                    waitFenceValue = signalInteropFence(sessionState);
                 }
-                CHECK_HRCMD(sessionState.runtimeQueue->Wait(sessionState.runtimeFence.Get(), sessionState.fenceValue));
+                profiler.mark((size_t)FramePhase::Signal);
 
-                // Perform copy from shareable application textures to non-shareable runtime textures if needed.
-                std::unordered_set<XrSwapchain> swapchainsToRelease;
+                // Gather the copies from shareable application textures to non-shareable runtime textures if needed.
+                auto& swapchainsToRelease = arena.swapchainsToRelease;
                 const auto copySwapchainImageRect = [&](const XrSwapchainSubImage& image) {
-                    auto it = m_swapchains.find(image.swapchain);
-                    if (it != m_swapchains.end()) {
-                        auto& swapchain = it->second;
-                        if (!swapchain.shareableImages.empty()) {
-                            D3D12_TEXTURE_COPY_LOCATION src{};
-                            src.pResource = swapchain.shareableImages[swapchain.lastReleasedIndex].Get();
-                            src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-                            src.SubresourceIndex = image.imageArrayIndex;
-
-                            D3D12_TEXTURE_COPY_LOCATION dest{};
-                            dest.pResource = swapchain.runtimeImages[swapchain.lastReleasedIndex];
-                            dest.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-                            dest.SubresourceIndex = image.imageArrayIndex;
-
-                            D3D12_BOX box{};
-                            box.left = image.imageRect.offset.x;
-                            box.top = image.imageRect.offset.y;
-                            box.right = box.left + image.imageRect.extent.width;
-                            box.bottom = box.top + image.imageRect.extent.height;
-                            box.back = 1;
-                            sessionState.commandList[sessionState.currentContext]->CopyTextureRegion(
-                                &dest, image.imageRect.offset.x, image.imageRect.offset.y, 0, &src, &box);
-
-                            swapchainsToRelease.insert(image.swapchain);
-                            swapchain.deferredRelease = false;
+                    Swapchain* swapchainState = m_swapchains.find(image.swapchain);
+                    if (swapchainState) {
+                        auto& swapchain = *swapchainState;
+                        std::unique_lock swapchainLock(swapchain.mutex);
+                        if (m_signalOnRelease) {
+                            waitFenceValue = std::max(
+                                waitFenceValue, swapchain.frame.readyFenceValue[swapchain.frame.lastReleasedIndex]);
                         }
-                    }
-                };
-                for (uint32_t i = 0; i < chainFrameEndInfo.layerCount; i++) {
-                    if (chainFrameEndInfo.layers[i]->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
-                        const XrCompositionLayerProjection* proj =
-                            reinterpret_cast<const XrCompositionLayerProjection*>(chainFrameEndInfo.layers[i]);
-
-                        for (uint32_t viewIndex = 0; viewIndex < proj->viewCount; viewIndex++) {
-                            copySwapchainImageRect(proj->views[viewIndex].subImage);
-
-                            if (has_XR_KHR_composition_layer_depth) {
-                                const XrBaseInStructure* entry =
-                                    reinterpret_cast<const XrBaseInStructure*>(proj->views[viewIndex].next);
-                                while (entry) {
-                                    if (entry->type == XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR) {
-                                        const XrCompositionLayerDepthInfoKHR* depth =
-                                            reinterpret_cast<const XrCompositionLayerDepthInfoKHR*>(entry);
-                                        copySwapchainImageRect(depth->subImage);
-                                        break;
+                        // When copying upon release, the copy was already submitted and the runtime image released.
+                        auto& frame = swapchain.frame;
+                        frame.usedSinceLastPoll = true;
+                        if (frame.needCopy && (frame.virtualImages || !m_copyOnRelease)) {
+                            if (frame.evicted) {
+                                makeSwapchainResident(sessionState, swapchain);
+                            }
+
+                            // Skip the copy if the runtime image already holds this region of the latest content.
+                            const auto isCopied = [&](const Swapchain::RuntimeImageContent& content) {
+                                if (content.generation != frame.generation) {
+                                    return false;
+                                }
+                                if (content.wholeImage) {
+                                    return true;
+                                }
+                                for (const auto& region : content.regions) {
+                                    if (region.first == image.imageArrayIndex &&
+                                        isRectContained(image.imageRect, region.second)) {
+                                        return true;
                                     }
+                                }
+                                return false;
+                            };
+
+                            CopyRequest copy{};
+                            if (frame.virtualImages) {
+                                // The last runtime image we acquired is either still acquired or the one currently
+                                // displayed by the runtime.
+                                if (isCopied(frame.runtimeImageContent[frame.runtimeAcquiredIndex])) {
+                                    arena.skippedCopyCount++;
+                                    TraceLoggingWrite(g_traceProvider,
+                                                      "xrEndFrame_CopySkipped",
+                                                      TLXArg(swapchain.xrSwapchain, "Swapchain"),
+                                                      TLArg(frame.generation, "Generation"));
+                                    return;
+                                }
 
-                                    entry = entry->next;
+                                // The runtime image to copy to was acquired by prepareRuntimeImage(). It is released
+                                // after the copies below. If it is not available yet, the runtime keeps the previous
+                                // content for this frame. We copy the entire image, since it might hold older content.
+                                if (!frame.runtimeImageWaited) {
+                                    TraceLoggingWrite(g_traceProvider,
+                                                      "xrEndFrame_RuntimeImageNotReady",
+                                                      TLXArg(swapchain.xrSwapchain, "Swapchain"),
+                                                      TLArg(frame.generation, "Generation"));
+                                    return;
                                 }
+                                frame.deferredRelease = true;
+                                frame.copySourceIndex = frame.lastReleasedIndex;
+
+                                auto& content = frame.runtimeImageContent[frame.runtimeAcquiredIndex];
+                                content.generation = frame.generation;
+                                content.wholeImage = true;
+                                content.regions.clear();
+
+                                copy.destination = frame.runtimeImages[frame.runtimeAcquiredIndex];
+                                copy.subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+                            } else {
+                                auto& content = frame.runtimeImageContent[frame.lastReleasedIndex];
+                                if (isCopied(content)) {
+                                    arena.skippedCopyCount++;
+                                    TraceLoggingWrite(g_traceProvider,
+                                                      "xrEndFrame_CopySkipped",
+                                                      TLXArg(swapchain.xrSwapchain, "Swapchain"),
+                                                      TLArg(frame.generation, "Generation"));
+                                    return;
+                                }
+                                if (content.generation != frame.generation) {
+                                    content.generation = frame.generation;
+                                    content.wholeImage = false;
+                                    content.regions.clear();
+                                }
+                                const size_t regionsCapacity = content.regions.capacity();
+                                content.regions.push_back({image.imageArrayIndex, image.imageRect});
+                                arena.grew |= content.regions.capacity() != regionsCapacity;
+
+                                copy.destination = frame.runtimeImages[frame.lastReleasedIndex];
+                                copy.subresource = image.imageArrayIndex * swapchain.createInfo.mipCount;
+                                copy.box.left = image.imageRect.offset.x;
+                                copy.box.top = image.imageRect.offset.y;
+                                copy.box.front = 0;
+                                copy.box.right = copy.box.left + image.imageRect.extent.width;
+                                copy.box.bottom = copy.box.top + image.imageRect.extent.height;
+                                copy.box.back = 1;
+                            }
+                            copy.source = swapchain.shareableImages[frame.lastReleasedIndex].Get();
+                            copy.destinationState = frame.runtimeImageState;
+                            copy.format = frame.format;
+                            copy.imageBytes = frame.imageBytes;
+                            arena.copies.push_back(copy);
+
+                            if (std::find(swapchainsToRelease.cbegin(), swapchainsToRelease.cend(), &swapchain) ==
+                                swapchainsToRelease.cend()) {
+                                swapchainsToRelease.push_back(&swapchain);
                             }
                         }
+                    }
+                };
+                forEachSubImage(chainFrameEndInfo, copySwapchainImageRect);
+                profiler.mark((size_t)FramePhase::Gather);
+
+                // Wait for the app's work before any of our copies and the runtime's composition.
+                UINT64 copyFenceValue = 0;
+                {
+                    std::unique_lock copyLock(sessionState.copyMutex);
+                    waitInteropFence(sessionState, waitFenceValue);
+                    profiler.mark((size_t)FramePhase::Wait);
+                    if (!arena.copies.empty()) {
+                        const size_t copyStorageCapacity = getCopyStorageCapacity(sessionState);
+                        coalesceCopies(arena.copies);
+                        copyFenceValue = submitCopies(
+                            sessionState, arena.copies.data(), arena.copies.size(), waitFenceValue, &profiler);
+                        arena.grew |= getCopyStorageCapacity(sessionState) != copyStorageCapacity;
+                    }
+                }
 
-                    } else if (chainFrameEndInfo.layers[i]->type == XR_TYPE_COMPOSITION_LAYER_QUAD) {
-                        const XrCompositionLayerQuad* quad =
-                            reinterpret_cast<const XrCompositionLayerQuad*>(chainFrameEndInfo.layers[i]);
-
-                        copySwapchainImageRect(quad->subImage);
-
-                    } else if (has_XR_KHR_composition_layer_cylinder &&
-                               chainFrameEndInfo.layers[i]->type == XR_TYPE_COMPOSITION_LAYER_CYLINDER_KHR) {
-                        const XrCompositionLayerCylinderKHR* cylinder =
-                            reinterpret_cast<const XrCompositionLayerCylinderKHR*>(chainFrameEndInfo.layers[i]);
-
-                        copySwapchainImageRect(cylinder->subImage);
-
-                    } else if (has_XR_KHR_composition_layer_equirect &&
-                               chainFrameEndInfo.layers[i]->type == XR_TYPE_COMPOSITION_LAYER_EQUIRECT_KHR) {
-                        const XrCompositionLayerEquirectKHR* equirect =
-                            reinterpret_cast<const XrCompositionLayerEquirectKHR*>(chainFrameEndInfo.layers[i]);
-
-                        copySwapchainImageRect(equirect->subImage);
+                // Perform deferred swapchain release.
+                for (Swapchain* swapchainState : swapchainsToRelease) {
+                    TraceLoggingWrite(g_traceProvider,
+                                      "xrEndFrame_DeferredSwapchainRelease",
+                                      TLXArg(swapchainState->xrSwapchain, "Swapchain"));
 
-                    } else if (has_XR_KHR_composition_layer_equirect2 &&
-                               chainFrameEndInfo.layers[i]->type == XR_TYPE_COMPOSITION_LAYER_EQUIRECT2_KHR) {
-                        const XrCompositionLayerEquirect2KHR* equirect =
-                            reinterpret_cast<const XrCompositionLayerEquirect2KHR*>(chainFrameEndInfo.layers[i]);
+                    std::unique_lock swapchainLock(swapchainState->mutex);
 
-                        copySwapchainImageRect(equirect->subImage);
+                    // The application might have already acquired a new image (and therefore released this one).
+                    if (swapchainState->frame.deferredRelease) {
+                        util::CallTimer::Exclusion downstream(timer);
+                        CHECK_XRCMD(OpenXrApi::xrReleaseSwapchainImage(swapchainState->xrSwapchain, nullptr));
+                        swapchainState->frame.deferredRelease = false;
+                        swapchainState->frame.runtimeImageAcquired = swapchainState->frame.runtimeImageWaited = false;
                     }
-
-                    // TODO: Need to support all other composition layer types.
-                }
-                if (!swapchainsToRelease.empty()) {
-                    CHECK_HRCMD(sessionState.commandList[sessionState.currentContext]->Close());
-                    ID3D12CommandList* commandLists[] = {sessionState.commandList[sessionState.currentContext].Get()};
-                    sessionState.runtimeQueue->ExecuteCommandLists(1, commandLists);
-                    sessionState.currentContext++;
-                    if (sessionState.currentContext >= std::size(sessionState.commandList)) {
-                        sessionState.currentContext = 0;
+                    if (swapchainState->frame.virtualImages) {
+                        swapchainState->frame.copyFenceValue[swapchainState->frame.copySourceIndex] = copyFenceValue;
                     }
-
-                    // Prepare for the next xrEndFrame().
-                    CHECK_HRCMD(sessionState.commandAllocator[sessionState.currentContext]->Reset());
-                    CHECK_HRCMD(sessionState.commandList[sessionState.currentContext]->Reset(
-                        sessionState.commandAllocator[sessionState.currentContext].Get(), nullptr));
                 }
+                profiler.mark((size_t)FramePhase::Release);
 
-                // Perform deferred swapchain release.
-                for (auto swapchain : swapchainsToRelease) {
-                    TraceLoggingWrite(
-                        g_traceProvider, "xrEndFrame_DeferredSwapchainRelease", TLXArg(swapchain, "Swapchain"));
+                // Release the resources of the destroyed swapchains that are no longer in use.
+                if (!sessionState.retiredSwapchains.empty()) {
+                    collectRetiredSwapchains(sessionState);
+                }
 
-                    CHECK_XRCMD(OpenXrApi::xrReleaseSwapchainImage(swapchain, nullptr));
+                if (sessionState.dxgiAdapter && arena.frameCount % ResidencyPollFrames == 0) {
+                    manageResidency(sessionState);
                 }
+                profiler.mark((size_t)FramePhase::Housekeeping);
 
                 // When using OpenGL, the Y-axis is inverted, and we must tell the runtime to render the image
                 // upside-up. We use the FOV to do that.
-                if (sessionState.api == GfxApi::OpenGL) {
+                if (sessionState.flipProjectionFov) {
                     // We must reserve the underlying storage to keep our pointers stable.
-                    layerProjectionAllocator.reserve(chainFrameEndInfo.layerCount);
-                    layerProjectionViewsAllocator.reserve(chainFrameEndInfo.layerCount);
+                    arena.layerProjections.reserve(chainFrameEndInfo.layerCount);
+                    arena.layerProjectionViews.reserve(chainFrameEndInfo.layerCount);
+                    arena.correctedLayers.reserve(chainFrameEndInfo.layerCount);
 
                     for (uint32_t i = 0; i < chainFrameEndInfo.layerCount; i++) {
                         if (chainFrameEndInfo.layers[i]->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
                             const XrCompositionLayerProjection* proj =
                                 reinterpret_cast<const XrCompositionLayerProjection*>(chainFrameEndInfo.layers[i]);
 
-                            auto correctedProjectionLayer = &layerProjectionAllocator.emplace_back(*proj);
+                            auto correctedProjectionLayer = &arena.layerProjections.emplace_back(*proj);
                             auto correctedProjectionViews =
-                                layerProjectionViewsAllocator
+                                arena.layerProjectionViews
                                     .emplace_back(std::array<XrCompositionLayerProjectionView, 2>(
                                         {proj->views[0], proj->views[1]}))
                                     .data();
@@ -1492,238 +2805,702 @@ namespace {
                             }
 
                             correctedProjectionLayer->views = correctedProjectionViews;
-                            correctedLayers.push_back(
+                            arena.correctedLayers.push_back(
                                 reinterpret_cast<const XrCompositionLayerBaseHeader*>(correctedProjectionLayer));
                         } else {
-                            correctedLayers.push_back(chainFrameEndInfo.layers[i]);
+                            arena.correctedLayers.push_back(chainFrameEndInfo.layers[i]);
                         }
                     }
 
-                    chainFrameEndInfo.layers = correctedLayers.data();
-                    chainFrameEndInfo.layerCount = (uint32_t)correctedLayers.size();
+                    chainFrameEndInfo.layers = arena.correctedLayers.data();
+                    chainFrameEndInfo.layerCount = (uint32_t)arena.correctedLayers.size();
+                }
+
+                // Any growth of the arena is a heap allocation in the frame loop. This should only happen during the
+                // first frames (or when the application submits more layers or swapchains than before).
+                if (arena.capacity() != arenaCapacity || arena.grew) {
+                    arena.growthCount++;
+                    TraceLoggingWrite(g_traceProvider,
+                                      "xrEndFrame_ArenaGrowth",
+                                      TLArg(arena.capacity(), "Capacity"),
+                                      TLArg(arena.growthCount, "GrowthCount"));
+                }
+                arena.frameCount++;
+                profiler.mark((size_t)FramePhase::RewriteLayers);
+            }
+
+            // Do not hold the registry lock while calling the runtime. The session state remains valid, since the
+            // application may not destroy the session during this call.
+            registryLock.unlock();
+            XrResult result;
+            {
+                util::CallTimer::Exclusion downstream(timer);
+                result = OpenXrApi::xrEndFrame(session, &chainFrameEndInfo);
+            }
+
+            if (sessionStatePtr && sessionStatePtr->frameProfiler.isEnabled()) {
+                // The runtime phase ends here, not once the session lock is acquired.
+                const auto runtimeEndTime = FrameProfiler::Clock::now();
+
+                std::optional<FramePhasesSnapshot> period;
+                {
+                    std::unique_lock sessionLock(sessionStatePtr->mutex);
+                    auto& profiler = sessionStatePtr->frameProfiler;
+                    profiler.mark((size_t)FramePhase::Runtime, runtimeEndTime);
+                    profiler.finish();
+                    if (profiler.getPeriodDuration() >= std::chrono::seconds(m_frameProfilerPeriod)) {
+                        period = snapshotFramePhases(profiler, false);
+                        profiler.resetPeriod();
+                    }
+                }
+                if (period) {
+                    logFramePhases(*period, false);
                 }
             }
 
-            return OpenXrApi::xrEndFrame(session, &chainFrameEndInfo);
+            return result;
         }
 
       private:
-        // Initialize the function pointers for the Vulkan instance.
-        void initializeVulkanDispatch(Session& session, VkInstance instance) {
-            PFN_vkGetInstanceProcAddr getProcAddr =
-                m_vkGetInstanceProcAddr ? m_vkGetInstanceProcAddr : vkGetInstanceProcAddr;
-
-#define VK_GET_PTR(fun) session.vk.dispatch.fun = reinterpret_cast<PFN_##fun>(getProcAddr(instance, #fun));
-
-            VK_GET_PTR(vkGetPhysicalDeviceProperties2);
-            VK_GET_PTR(vkGetPhysicalDeviceMemoryProperties);
-            VK_GET_PTR(vkGetImageMemoryRequirements2KHR);
-            VK_GET_PTR(vkGetDeviceQueue);
-            VK_GET_PTR(vkQueueSubmit);
-            VK_GET_PTR(vkCreateImage);
-            VK_GET_PTR(vkDestroyImage);
-            VK_GET_PTR(vkAllocateMemory);
-            VK_GET_PTR(vkFreeMemory);
-            VK_GET_PTR(vkCreateCommandPool);
-            VK_GET_PTR(vkDestroyCommandPool);
-            VK_GET_PTR(vkAllocateCommandBuffers);
-            VK_GET_PTR(vkFreeCommandBuffers);
-            VK_GET_PTR(vkBeginCommandBuffer);
-            VK_GET_PTR(vkCmdPipelineBarrier);
-            VK_GET_PTR(vkEndCommandBuffer);
-            VK_GET_PTR(vkGetMemoryWin32HandlePropertiesKHR);
-            VK_GET_PTR(vkBindImageMemory);
-            VK_GET_PTR(vkCreateSemaphore);
-            VK_GET_PTR(vkDestroySemaphore);
-            VK_GET_PTR(vkImportSemaphoreWin32HandleKHR);
-            VK_GET_PTR(vkQueueWaitIdle);
-            VK_GET_PTR(vkDeviceWaitIdle);
-
-#undef VK_GET_PTR
-        }
-
-        void initializeOpenGLDispatch(Session& session) {
-#define GL_GET_PTR(fun)                                                                                                \
-    session.gl.dispatch.fun = reinterpret_cast<decltype(session.gl.dispatch.fun)>(wglGetProcAddress(#fun));            \
-    CHECK_MSG(session.gl.dispatch.fun, "OpenGL driver does not support " #fun);
-
-            GL_GET_PTR(glGetUnsignedBytevEXT);
-            GL_GET_PTR(glCreateTextures);
-            GL_GET_PTR(glCreateMemoryObjectsEXT);
-            GL_GET_PTR(glDeleteMemoryObjectsEXT);
-            GL_GET_PTR(glTextureStorageMem2DEXT);
-            GL_GET_PTR(glTextureStorageMem2DMultisampleEXT);
-            GL_GET_PTR(glTextureStorageMem3DEXT);
-            GL_GET_PTR(glTextureStorageMem3DMultisampleEXT);
-            GL_GET_PTR(glGenSemaphoresEXT);
-            GL_GET_PTR(glDeleteSemaphoresEXT);
-            GL_GET_PTR(glSemaphoreParameterui64vEXT);
-            GL_GET_PTR(glSignalSemaphoreEXT);
-            GL_GET_PTR(glImportMemoryWin32HandleEXT);
-            GL_GET_PTR(glImportSemaphoreWin32HandleEXT);
-
-#undef GL_GET_PTR
+        // Invoke a function for each swapchain sub-image referenced by the composition layers of a frame.
+        template <typename F>
+        void forEachSubImage(const XrFrameEndInfo& frameEndInfo, F&& function) const {
+            for (uint32_t i = 0; i < frameEndInfo.layerCount; i++) {
+                if (frameEndInfo.layers[i]->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                    const XrCompositionLayerProjection* proj =
+                        reinterpret_cast<const XrCompositionLayerProjection*>(frameEndInfo.layers[i]);
+
+                    for (uint32_t viewIndex = 0; viewIndex < proj->viewCount; viewIndex++) {
+                        function(proj->views[viewIndex].subImage);
+
+                        if (has_XR_KHR_composition_layer_depth) {
+                            const XrBaseInStructure* entry =
+                                reinterpret_cast<const XrBaseInStructure*>(proj->views[viewIndex].next);
+                            while (entry) {
+                                if (entry->type == XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR) {
+                                    const XrCompositionLayerDepthInfoKHR* depth =
+                                        reinterpret_cast<const XrCompositionLayerDepthInfoKHR*>(entry);
+                                    function(depth->subImage);
+                                    break;
+                                }
+
+                                entry = entry->next;
+                            }
+                        }
+                    }
+
+                } else if (frameEndInfo.layers[i]->type == XR_TYPE_COMPOSITION_LAYER_QUAD) {
+                    const XrCompositionLayerQuad* quad =
+                        reinterpret_cast<const XrCompositionLayerQuad*>(frameEndInfo.layers[i]);
+
+                    function(quad->subImage);
+
+                } else if (has_XR_KHR_composition_layer_cylinder &&
+                           frameEndInfo.layers[i]->type == XR_TYPE_COMPOSITION_LAYER_CYLINDER_KHR) {
+                    const XrCompositionLayerCylinderKHR* cylinder =
+                        reinterpret_cast<const XrCompositionLayerCylinderKHR*>(frameEndInfo.layers[i]);
+
+                    function(cylinder->subImage);
+
+                } else if (has_XR_KHR_composition_layer_equirect &&
+                           frameEndInfo.layers[i]->type == XR_TYPE_COMPOSITION_LAYER_EQUIRECT_KHR) {
+                    const XrCompositionLayerEquirectKHR* equirect =
+                        reinterpret_cast<const XrCompositionLayerEquirectKHR*>(frameEndInfo.layers[i]);
+
+                    function(equirect->subImage);
+
+                } else if (has_XR_KHR_composition_layer_equirect2 &&
+                           frameEndInfo.layers[i]->type == XR_TYPE_COMPOSITION_LAYER_EQUIRECT2_KHR) {
+                    const XrCompositionLayerEquirect2KHR* equirect =
+                        reinterpret_cast<const XrCompositionLayerEquirect2KHR*>(frameEndInfo.layers[i]);
+
+                    function(equirect->subImage);
+                }
+
+                // TODO: Need to support all other composition layer types.
+            }
         }
 
-        void initializeRuntimeResources(Session& session) {
-            ComPtr<IDXGIFactory1> dxgiFactory;
-            CHECK_HRCMD(CreateDXGIFactory1(IID_PPV_ARGS(dxgiFactory.ReleaseAndGetAddressOf())));
-
-            ComPtr<IDXGIAdapter1> dxgiAdapter;
-            for (UINT adapterIndex = 0;; adapterIndex++) {
-                // EnumAdapters1 will fail with DXGI_ERROR_NOT_FOUND when there are no more adapters to
-                // enumerate.
-                CHECK_HRCMD(dxgiFactory->EnumAdapters1(adapterIndex, dxgiAdapter.ReleaseAndGetAddressOf()));
-
-                DXGI_ADAPTER_DESC1 adapterDesc;
-                CHECK_HRCMD(dxgiAdapter->GetDesc1(&adapterDesc));
-                if (!memcmp(&adapterDesc.AdapterLuid, &m_d3d12Requirements.adapterLuid, sizeof(LUID))) {
-                    const std::wstring wadapterDescription(adapterDesc.Description);
-                    std::string adapterDescription;
-                    std::transform(wadapterDescription.begin(),
-                                   wadapterDescription.end(),
-                                   std::back_inserter(adapterDescription),
-                                   [](wchar_t c) { return (char)c; });
+        // Take the percentiles of the xrEndFrame() phases, for the last period or for the whole session.
+        static FramePhasesSnapshot snapshotFramePhases(const FrameProfiler& profiler, bool total) {
+            FramePhasesSnapshot snapshot;
+            for (size_t i = 0; i < (size_t)FramePhase::Count; i++) {
+                const auto& histogram = total ? profiler.getTotal(i) : profiler.getPeriod(i);
+                snapshot[i].count = histogram.getCount();
+                snapshot[i].p50 = histogram.getPercentile(0.5);
+                snapshot[i].p95 = histogram.getPercentile(0.95);
+                snapshot[i].p99 = histogram.getPercentile(0.99);
+            }
+            return snapshot;
+        }
 
-                    TraceLoggingWrite(
-                        g_traceProvider, "xrCreateSession", TLArg(adapterDescription.c_str(), "DeviceName"));
-                    Log("Using Direct3D 12 on adapter: %s\n", adapterDescription.c_str());
+        // Log the percentiles of the xrEndFrame() phases. The phases that are not reached on every frame (eg: the
+        // copies) report how many frames they were timed in.
+        static void logFramePhases(const FramePhasesSnapshot& snapshot, bool total) {
+            const uint64_t frameCount = snapshot[(size_t)FramePhase::Signal].count;
+            if (!frameCount) {
+                return;
+            }
+
+            Log("Frame phases (%s, %llu frames), p50/p95/p99:\n", total ? "session" : "period", frameCount);
+            for (size_t i = 0; i < (size_t)FramePhase::Count; i++) {
+                const auto& phase = snapshot[i];
+                if (phase.count == frameCount) {
+                    Log("  %-14s %.1f/%.1f/%.1f us\n",
+                        FramePhaseNames[i],
+                        phase.p50 / 1000.0,
+                        phase.p95 / 1000.0,
+                        phase.p99 / 1000.0);
+                } else {
+                    Log("  %-14s %.1f/%.1f/%.1f us (%llu frames)\n",
+                        FramePhaseNames[i],
+                        phase.p50 / 1000.0,
+                        phase.p95 / 1000.0,
+                        phase.p99 / 1000.0,
+                        phase.count);
+                }
+                TraceLoggingWrite(g_traceProvider,
+                                  "FramePhase",
+                                  TLArg(FramePhaseNames[i], "Phase"),
+                                  TLArg(total, "Total"),
+                                  TLArg(frameCount, "FrameCount"),
+                                  TLArg(phase.count, "Count"),
+                                  TLArg(phase.p50, "P50Ns"),
+                                  TLArg(phase.p95, "P95Ns"),
+                                  TLArg(phase.p99, "P99Ns"));
+            }
+        }
+
+        static void logLockStatistics(const char* name, const util::LockStatistics& statistics) {
+            const uint64_t count = statistics.wait.getCount();
+            if (!count) {
+                return;
+            }
+            const uint64_t waitP50 = statistics.wait.getPercentile(0.5);
+            const uint64_t waitP99 = statistics.wait.getPercentile(0.99);
+            const uint64_t waitP999 = statistics.wait.getPercentile(0.999);
+            const uint64_t holdP50 = statistics.hold.getPercentile(0.5);
+            const uint64_t holdP99 = statistics.hold.getPercentile(0.99);
+            const uint64_t holdP999 = statistics.hold.getPercentile(0.999);
+            const uint64_t sharedHoldP50 = statistics.sharedHold.getPercentile(0.5);
+            const uint64_t sharedHoldP99 = statistics.sharedHold.getPercentile(0.99);
+            const uint64_t sharedHoldP999 = statistics.sharedHold.getPercentile(0.999);
+            const uint64_t contendedCount = statistics.contendedCount.load();
+            Log("%s lock: %llu acquisitions (%.1f%% contended), wait p50/p99/p99.9 %.1f/%.1f/%.1f us, hold "
+                "p50/p99/p99.9 %.1f/%.1f/%.1f us\n",
+                name,
+                count,
+                100.0 * contendedCount / count,
+                waitP50 / 1000.0,
+                waitP99 / 1000.0,
+                waitP999 / 1000.0,
+                holdP50 / 1000.0,
+                holdP99 / 1000.0,
+                holdP999 / 1000.0);
+            if (statistics.sharedHold.getCount()) {
+                Log("%s lock: %llu shared acquisitions, hold p50/p99/p99.9 %.1f/%.1f/%.1f us\n",
+                    name,
+                    statistics.sharedHold.getCount(),
+                    sharedHoldP50 / 1000.0,
+                    sharedHoldP99 / 1000.0,
+                    sharedHoldP999 / 1000.0);
+            }
+            TraceLoggingWrite(g_traceProvider,
+                              "LockContention",
+                              TLArg(name, "Lock"),
+                              TLArg(count, "Count"),
+                              TLArg(contendedCount, "ContendedCount"),
+                              TLArg(waitP50, "WaitP50Ns"),
+                              TLArg(waitP99, "WaitP99Ns"),
+                              TLArg(waitP999, "WaitP999Ns"),
+                              TLArg(holdP50, "HoldP50Ns"),
+                              TLArg(holdP99, "HoldP99Ns"),
+                              TLArg(holdP999, "HoldP999Ns"),
+                              TLArg(sharedHoldP50, "SharedHoldP50Ns"),
+                              TLArg(sharedHoldP99, "SharedHoldP99Ns"),
+                              TLArg(sharedHoldP999, "SharedHoldP999Ns"));
+        }
+
+        // Serialize the composition layers submitted with a frame.
+        static void captureFrame(capture::CaptureWriter::Payload& payload,
+                                 XrSession session,
+                                 const XrFrameEndInfo& frameEndInfo) {
+            payload.append(capture::EndFrameRecord{(uint64_t)session,
+                                                   frameEndInfo.displayTime,
+                                                   (uint32_t)frameEndInfo.environmentBlendMode,
+                                                   frameEndInfo.layerCount});
+
+            const auto captureSubImage = [&](const XrSwapchainSubImage& subImage) {
+                payload.append(capture::SubImageRecord{(uint64_t)subImage.swapchain,
+                                                       subImage.imageRect.offset.x,
+                                                       subImage.imageRect.offset.y,
+                                                       subImage.imageRect.extent.width,
+                                                       subImage.imageRect.extent.height,
+                                                       subImage.imageArrayIndex});
+            };
+            for (uint32_t i = 0; i < frameEndInfo.layerCount; i++) {
+                const XrCompositionLayerBaseHeader* layer = frameEndInfo.layers[i];
+                capture::LayerRecord record{(uint32_t)layer->type, (uint32_t)layer->layerFlags, (uint64_t)layer->space};
+                switch (layer->type) {
+                case XR_TYPE_COMPOSITION_LAYER_PROJECTION: {
+                    const auto proj = reinterpret_cast<const XrCompositionLayerProjection*>(layer);
+                    record.subImageCount = proj->viewCount;
+                    payload.append(record);
+                    for (uint32_t view = 0; view < proj->viewCount; view++) {
+                        captureSubImage(proj->views[view].subImage);
+                    }
                     break;
                 }
+                case XR_TYPE_COMPOSITION_LAYER_QUAD:
+                    record.subImageCount = 1;
+                    payload.append(record);
+                    captureSubImage(reinterpret_cast<const XrCompositionLayerQuad*>(layer)->subImage);
+                    break;
+                case XR_TYPE_COMPOSITION_LAYER_CYLINDER_KHR:
+                    record.subImageCount = 1;
+                    payload.append(record);
+                    captureSubImage(reinterpret_cast<const XrCompositionLayerCylinderKHR*>(layer)->subImage);
+                    break;
+                case XR_TYPE_COMPOSITION_LAYER_EQUIRECT_KHR:
+                    record.subImageCount = 1;
+                    payload.append(record);
+                    captureSubImage(reinterpret_cast<const XrCompositionLayerEquirectKHR*>(layer)->subImage);
+                    break;
+                case XR_TYPE_COMPOSITION_LAYER_EQUIRECT2_KHR:
+                    record.subImageCount = 1;
+                    payload.append(record);
+                    captureSubImage(reinterpret_cast<const XrCompositionLayerEquirect2KHR*>(layer)->subImage);
+                    break;
+                default:
+                    payload.append(record);
+                    break;
+                }
+            }
+        }
+
+        // Signal the interop fence from the Vulkan queue/OpenGL context of the application. Returns the value that
+        // will be signaled.
+        UINT64 signalInteropFence(Session& session) {
+            std::unique_lock lock(session.appQueueMutex);
+
+            const UINT64 value = ++session.fenceValue;
+            session.app->signal(session, value);
+
+            return value;
+        }
+
+        // Make the runtime queue wait for the interop fence to reach the given value. Must be called with copyMutex
+        // held.
+        void waitInteropFence(Session& session, UINT64 waitFenceValue) {
+            if (waitFenceValue > session.lastWaitedFenceValue) {
+                TraceLoggingWrite(g_traceProvider, "WaitInteropFence", TLArg(waitFenceValue, "FenceValue"));
+                CHECK_HRCMD(session.runtimeQueue->Wait(session.runtimeFence.Get(), waitFenceValue));
+                session.lastWaitedFenceValue = waitFenceValue;
             }
+        }
 
-            // Create the interop device that the runtime will be using...
-            CHECK_HRCMD(D3D12CreateDevice(dxgiAdapter.Get(),
-                                          m_d3d12Requirements.minFeatureLevel,
-                                          IID_PPV_ARGS(session.runtimeDevice.ReleaseAndGetAddressOf())));
+        // Record and submit the copies from the shareable application textures to the runtime textures. The copies
+        // must wait for the application's work to be completed (waitFenceValue). Must be called with copyMutex held.
+        // Returns the value of the copy command list pool's fence signaled upon completion of the copies.
+        UINT64 submitCopies(Session& session,
+                            const CopyRequest* copies,
+                            size_t copyCount,
+                            UINT64 waitFenceValue,
+                            FrameProfiler* profiler = nullptr) {
+            auto& barriers = session.copyBarriers;
+
+            // Queue a transition barrier once per subresource.
+            const auto addBarrier = [&](ID3D12Resource* resource,
+                                        UINT subresource,
+                                        D3D12_RESOURCE_STATES before,
+                                        D3D12_RESOURCE_STATES after) {
+                if (before == after) {
+                    return;
+                }
+                for (const auto& barrier : barriers) {
+                    if (barrier.Transition.pResource == resource && barrier.Transition.Subresource == subresource) {
+                        return;
+                    }
+                }
+
+                D3D12_RESOURCE_BARRIER& barrier = barriers.emplace_back();
+                barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+                barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+                barrier.Transition.pResource = resource;
+                barrier.Transition.Subresource = subresource;
+                barrier.Transition.StateBefore = before;
+                barrier.Transition.StateAfter = after;
+            };
+            const auto flushBarriers = [&](ID3D12GraphicsCommandList* commandList) {
+                if (!barriers.empty()) {
+                    commandList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+                    barriers.clear();
+                }
+            };
+
+            // A copy queue cannot manipulate the render target/depth states, so the runtime textures must be
+            // transitioned to and from the COMMON state on the runtime queue around the copies.
+            const bool useCopyQueue = session.copyQueue;
+            const auto transitionRuntimeImages = [&](bool toCommon) -> UINT64 {
+                for (size_t i = 0; i < copyCount; i++) {
+                    const CopyRequest& copy = copies[i];
+                    addBarrier(copy.destination,
+                               copy.subresource,
+                               toCommon ? copy.destinationState : D3D12_RESOURCE_STATE_COMMON,
+                               toCommon ? D3D12_RESOURCE_STATE_COMMON : copy.destinationState);
+                }
+                if (barriers.empty()) {
+                    return 0;
+                }
+                flushBarriers(session.transitionCommandLists.getCommandList());
+                return session.transitionCommandLists.submit(session.runtimeQueue.Get());
+            };
+
+            ID3D12CommandQueue* const queue = useCopyQueue ? session.copyQueue.Get() : session.runtimeQueue.Get();
+            if (useCopyQueue) {
+                const UINT64 transitionFenceValue = transitionRuntimeImages(true);
+                if (transitionFenceValue) {
+                    CHECK_HRCMD(queue->Wait(session.transitionCommandLists.getFence(), transitionFenceValue));
+                }
+                if (waitFenceValue) {
+                    CHECK_HRCMD(queue->Wait(session.runtimeFence.Get(), waitFenceValue));
+                }
+            }
+
+            // The shareable textures are always left in the COMMON state outside of the copies.
+            ID3D12GraphicsCommandList* const commandList = session.copyCommandLists.getCommandList();
+            for (size_t i = 0; i < copyCount; i++) {
+                const CopyRequest& copy = copies[i];
+                addBarrier(copy.destination,
+                           copy.subresource,
+                           useCopyQueue ? D3D12_RESOURCE_STATE_COMMON : copy.destinationState,
+                           D3D12_RESOURCE_STATE_COPY_DEST);
+                addBarrier(
+                    copy.source, copy.subresource, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_SOURCE);
+            }
+            flushBarriers(commandList);
+
+            UINT64 copiedBytes = 0;
+            for (size_t i = 0; i < copyCount; i++) {
+                const CopyRequest& copy = copies[i];
+                copiedBytes += getCopySize(copy);
+                if (copy.subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) {
+                    commandList->CopyResource(copy.destination, copy.source);
+                    continue;
+                }
+
+                D3D12_TEXTURE_COPY_LOCATION src{};
+                src.pResource = copy.source;
+                src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+                src.SubresourceIndex = copy.subresource;
+
+                D3D12_TEXTURE_COPY_LOCATION dest{};
+                dest.pResource = copy.destination;
+                dest.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+                dest.SubresourceIndex = copy.subresource;
+
+                if (copy.wholeSubresource) {
+                    commandList->CopyTextureRegion(&dest, 0, 0, 0, &src, nullptr);
+                } else {
+                    commandList->CopyTextureRegion(&dest, copy.box.left, copy.box.top, 0, &src, &copy.box);
+                }
+            }
+
+            for (size_t i = 0; i < copyCount; i++) {
+                const CopyRequest& copy = copies[i];
+                addBarrier(copy.destination,
+                           copy.subresource,
+                           D3D12_RESOURCE_STATE_COPY_DEST,
+                           useCopyQueue ? D3D12_RESOURCE_STATE_COMMON : copy.destinationState);
+                addBarrier(
+                    copy.source, copy.subresource, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON);
+            }
+            flushBarriers(commandList);
+
+            if (profiler) {
+                profiler->mark((size_t)FramePhase::RecordCopies);
+            }
+            const UINT64 copyFenceValue = session.copyCommandLists.submit(queue);
+            session.copiedBytes += copiedBytes;
+            TraceLoggingWrite(g_traceProvider,
+                              "CopySubmit",
+                              TLArg(copyCount, "CopyCount"),
+                              TLArg(copiedBytes, "CopiedBytes"),
+                              TLArg(useCopyQueue, "CopyQueue"),
+                              TLArg(copyFenceValue, "FenceValue"),
+                              TLArg(session.copyCommandLists.getDepth(), "PoolDepth"),
+                              TLArg(session.copyCommandLists.getWaitCount(), "PoolWaitCount"));
+
+            if (useCopyQueue) {
+                // The runtime queue must wait for the copies before returning the runtime textures to their state.
+                CHECK_HRCMD(session.runtimeQueue->Wait(session.copyCommandLists.getFence(), copyFenceValue));
+                transitionRuntimeImages(false);
+            }
+            if (profiler) {
+                profiler->mark((size_t)FramePhase::ExecuteCopies);
+            }
+
+            return copyFenceValue;
+        }
+
+        // Merge the copies between the same subresources when their regions overlap or are adjacent and their union
+        // is a box, then use whole subresource (or whole texture) copies where possible.
+        static void coalesceCopies(std::vector<CopyRequest>& copies) {
+            const auto isSameTexture = [](const CopyRequest& a, const CopyRequest& b) {
+                return a.source == b.source && a.destination == b.destination;
+            };
+
+            bool merged = true;
+            while (merged) {
+                merged = false;
+                for (size_t i = 0; i < copies.size(); i++) {
+                    for (size_t j = i + 1; j < copies.size(); j++) {
+                        if (!isSameTexture(copies[i], copies[j])) {
+                            continue;
+                        }
+
+                        // A whole texture copy absorbs any other copy.
+                        if (copies[j].subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) {
+                            std::swap(copies[i], copies[j]);
+                        }
+                        if (copies[i].subresource != D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
+                            (copies[i].subresource != copies[j].subresource ||
+                             !mergeBoxes(copies[i].box, copies[j].box))) {
+                            continue;
+                        }
+
+                        copies.erase(copies.begin() + j);
+                        merged = true;
+                        j--;
+                    }
+                }
+            }
+
+            for (auto& copy : copies) {
+                if (copy.subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) {
+                    continue;
+                }
+
+                const auto& desc = copy.destination->GetDesc();
+                if (copy.box.left == 0 && copy.box.top == 0 && copy.box.right >= desc.Width &&
+                    copy.box.bottom >= desc.Height) {
+                    copy.wholeSubresource = true;
+                    copy.box.right = (UINT)desc.Width;
+                    copy.box.bottom = desc.Height;
+                    if (desc.DepthOrArraySize == 1 && desc.MipLevels == 1) {
+                        copy.subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+                    }
+                }
+            }
+        }
+
+        // Extend a box to include another one, if their union is also a box.
+        static bool mergeBoxes(D3D12_BOX& box, const D3D12_BOX& other) {
+            const bool overlapX = other.left <= box.right && box.left <= other.right;
+            const bool overlapY = other.top <= box.bottom && box.top <= other.bottom;
+            const bool sameX = other.left == box.left && other.right == box.right;
+            const bool sameY = other.top == box.top && other.bottom == box.bottom;
+            const bool contains = other.left >= box.left && other.right <= box.right && other.top >= box.top &&
+                                  other.bottom <= box.bottom;
+            const bool contained = box.left >= other.left && box.right <= other.right && box.top >= other.top &&
+                                   box.bottom <= other.bottom;
+            if (!(contains || contained || (sameX && overlapY) || (sameY && overlapX))) {
+                return false;
+            }
+
+            box.left = std::min(box.left, other.left);
+            box.top = std::min(box.top, other.top);
+            box.right = std::max(box.right, other.right);
+            box.bottom = std::max(box.bottom, other.bottom);
+            return true;
+        }
+
+        static UINT64 getCopySize(const CopyRequest& copy) {
+            if (copy.subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) {
+                return copy.imageBytes;
+            }
+            if (!copy.format) {
+                return 0;
+            }
+            return util::GetRegionSize(*copy.format, copy.box.right - copy.box.left, copy.box.bottom - copy.box.top);
+        }
+
+        static bool isRectContained(const XrRect2Di& rect, const XrRect2Di& container) {
+            return rect.offset.x >= container.offset.x && rect.offset.y >= container.offset.y &&
+                   rect.offset.x + rect.extent.width <= container.offset.x + container.extent.width &&
+                   rect.offset.y + rect.extent.height <= container.offset.y + container.extent.height;
+        }
+
+        // Returns the state that the runtime expects its swapchain textures to be in when they are submitted.
+        static D3D12_RESOURCE_STATES getRuntimeImageState(const XrSwapchainCreateInfo& createInfo) {
+            if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) {
+                return D3D12_RESOURCE_STATE_RENDER_TARGET;
+            } else if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+                return D3D12_RESOURCE_STATE_DEPTH_WRITE;
+            } else if (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT) {
+                return D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+            }
+            return D3D12_RESOURCE_STATE_COMMON;
+        }
+
+        void initializeRuntimeResources(Session& session) {
+            session.adapterLuid = m_d3d12Requirements.adapterLuid;
+
+            // Borrow a device from a previous session if possible. Its fence value continues monotonically.
+            {
+                std::unique_lock lock(m_runtimeContextsLock);
+                for (auto it = m_runtimeContexts.begin(); it != m_runtimeContexts.end(); ++it) {
+                    if (!memcmp(&it->adapterLuid, &session.adapterLuid, sizeof(LUID))) {
+                        session.runtimeDevice = std::move(it->device);
+                        session.runtimeQueue = std::move(it->queue);
+                        session.copyQueue = std::move(it->copyQueue);
+                        session.runtimeFence = std::move(it->fence);
+                        session.fenceValue = session.lastWaitedFenceValue = it->fenceValue;
+                        m_runtimeContexts.erase(it);
+
+                        TraceLoggingWrite(g_traceProvider,
+                                          "xrCreateSession_ReuseDevice",
+                                          TLArg(session.fenceValue, "FenceValue"));
+                        Log("Reusing Direct3D 12 device from a previous session\n");
+                        break;
+                    }
+                }
+            }
 
-            // ... and the necessary queue.
             D3D12_COMMAND_QUEUE_DESC queueDesc;
             ZeroMemory(&queueDesc, sizeof(queueDesc));
             queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
             queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
-            CHECK_HRCMD(session.runtimeDevice->CreateCommandQueue(
-                &queueDesc, IID_PPV_ARGS(session.runtimeQueue.ReleaseAndGetAddressOf())));
-
-            // We will use a shareable fence to synchronize between the Vulkan queue and the D3D queue.
-            CHECK_HRCMD(session.runtimeDevice->CreateFence(
-                0, D3D12_FENCE_FLAG_SHARED, IID_PPV_ARGS(session.runtimeFence.ReleaseAndGetAddressOf())));
-
-            // We may need command lists to perform copies between shareable/non-shareable textures.
-            for (uint32_t i = 0; i < std::size(session.commandAllocator); i++) {
-                CHECK_HRCMD(session.runtimeDevice->CreateCommandAllocator(
-                    D3D12_COMMAND_LIST_TYPE_DIRECT,
-                    IID_PPV_ARGS(session.commandAllocator[i].ReleaseAndGetAddressOf())));
-                CHECK_HRCMD(session.runtimeDevice->CreateCommandList(
-                    0,
-                    D3D12_COMMAND_LIST_TYPE_DIRECT,
-                    session.commandAllocator[i].Get(),
-                    nullptr,
-                    IID_PPV_ARGS(session.commandList[i].ReleaseAndGetAddressOf())));
-
-                // Set to a known state.
-                if (i != 0) {
-                    CHECK_HRCMD(session.commandList[i]->Close());
-                }
-            }
-            session.currentContext = 0;
-        }
-
-        XrResult initializeVulkanResources(Session& session, const XrGraphicsBindingVulkanKHR& vkBindings) {
-            session.vk.instance = vkBindings.instance;
-            session.vk.device = vkBindings.device;
-            session.vk.physicalDevice = vkBindings.physicalDevice;
-
-            initializeVulkanDispatch(session, session.vk.instance);
-
-            // Check that the app is using the correct adapter.
-            VkPhysicalDeviceIDProperties deviceId{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
-            VkPhysicalDeviceProperties2 properties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, &deviceId};
-            session.vk.dispatch.vkGetPhysicalDeviceProperties2(session.vk.physicalDevice, &properties);
-            if (!deviceId.deviceLUIDValid ||
-                memcmp(&m_d3d12Requirements.adapterLuid, deviceId.deviceLUID, sizeof(LUID))) {
-                Log("Application did not initialize the correct adapter\n");
-                return XR_ERROR_GRAPHICS_DEVICE_INVALID;
-            }
-
-            session.vk.dispatch.vkGetPhysicalDeviceMemoryProperties(session.vk.physicalDevice,
-                                                                    &session.vk.memoryProperties);
-
-            session.vk.dispatch.vkGetDeviceQueue(
-                session.vk.device, vkBindings.queueFamilyIndex, vkBindings.queueIndex, &session.vk.queue);
-
-            // Create the timeline semaphore that we will use to synchronize between the Vulkan
-            // queue and the D3D queue.
-            VkSemaphoreTypeCreateInfo timelineCreateInfo{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
-            timelineCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
-            VkSemaphoreCreateInfo createInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, &timelineCreateInfo};
-            CHECK_VKCMD(session.vk.dispatch.vkCreateSemaphore(
-                session.vk.device, &createInfo, m_vkAllocator, &session.vk.timelineSemaphore));
-
-            // Import the D3D fence into the semaphore.
-            wil::unique_handle fenceHandle = nullptr;
-            CHECK_HRCMD(session.runtimeDevice->CreateSharedHandle(
-                session.runtimeFence.Get(), nullptr, GENERIC_ALL, nullptr, fenceHandle.put()));
-
-            VkImportSemaphoreWin32HandleInfoKHR semaphoreImportInfo{
-                VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_WIN32_HANDLE_INFO_KHR};
-            semaphoreImportInfo.semaphore = session.vk.timelineSemaphore;
-            semaphoreImportInfo.handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_D3D12_FENCE_BIT;
-            semaphoreImportInfo.handle = fenceHandle.get();
-            CHECK_VKCMD(session.vk.dispatch.vkImportSemaphoreWin32HandleKHR(session.vk.device, &semaphoreImportInfo));
-
-            // Create a command buffer for transitioning the layout in xrCreateSwapchain().
-            VkCommandPoolCreateInfo poolCreateInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
-            poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-            poolCreateInfo.queueFamilyIndex = vkBindings.queueFamilyIndex;
-            CHECK_VKCMD(session.vk.dispatch.vkCreateCommandPool(
-                session.vk.device, &poolCreateInfo, m_vkAllocator, &session.vk.cmdPool));
-
-            VkCommandBufferAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
-            allocateInfo.commandPool = session.vk.cmdPool;
-            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-            allocateInfo.commandBufferCount = 1;
-
-            CHECK_VKCMD(
-                session.vk.dispatch.vkAllocateCommandBuffers(session.vk.device, &allocateInfo, &session.vk.cmdBuffer));
 
-            return XR_SUCCESS;
-        }
+            if (!session.runtimeDevice) {
+                ComPtr<IDXGIFactory1> dxgiFactory;
+                CHECK_HRCMD(CreateDXGIFactory1(IID_PPV_ARGS(dxgiFactory.ReleaseAndGetAddressOf())));
 
-        XrResult initializeOpenGLResources(Session& session, const XrGraphicsBindingOpenGLWin32KHR& glBindings) {
-            session.gl.DC = glBindings.hDC;
-            session.gl.GLRC = glBindings.hGLRC;
+                // Try the adapter that matched last time first.
+                std::optional<UINT> cachedAdapterIndex;
+                {
+                    std::unique_lock lock(m_adapterIndexLock);
+                    cachedAdapterIndex = m_dxgiAdapterIndex;
+                }
 
-            GlContextSwitch context(session);
+                ComPtr<IDXGIAdapter1> dxgiAdapter;
+                for (UINT i = 0;; i++) {
+                    UINT adapterIndex = i;
+                    if (cachedAdapterIndex) {
+                        adapterIndex = i == 0 ? *cachedAdapterIndex : i - 1;
+                        if (i > 0 && adapterIndex == *cachedAdapterIndex) {
+                            continue;
+                        }
+                    }
 
-            initializeOpenGLDispatch(session);
+                    // EnumAdapters1 will fail with DXGI_ERROR_NOT_FOUND when there are no more adapters to
+                    // enumerate.
+                    const HRESULT hr = dxgiFactory->EnumAdapters1(adapterIndex, dxgiAdapter.ReleaseAndGetAddressOf());
+                    if (hr == DXGI_ERROR_NOT_FOUND && i == 0 && cachedAdapterIndex) {
+                        continue;
+                    }
+                    CHECK_HRCMD(hr);
+
+                    DXGI_ADAPTER_DESC1 adapterDesc;
+                    CHECK_HRCMD(dxgiAdapter->GetDesc1(&adapterDesc));
+                    if (!memcmp(&adapterDesc.AdapterLuid, &m_d3d12Requirements.adapterLuid, sizeof(LUID))) {
+                        const std::wstring wadapterDescription(adapterDesc.Description);
+                        std::string adapterDescription;
+                        std::transform(wadapterDescription.begin(),
+                                       wadapterDescription.end(),
+                                       std::back_inserter(adapterDescription),
+                                       [](wchar_t c) { return (char)c; });
 
-            // Check that the app is using the correct adapter.
-            LUID adapterLuid{};
-            session.gl.dispatch.glGetUnsignedBytevEXT(GL_DEVICE_LUID_EXT, (GLubyte*)&adapterLuid);
-            if (memcmp(&adapterLuid, &m_d3d12Requirements.adapterLuid, sizeof(LUID))) {
-                Log("Application did not initialize the correct adapter\n");
-                return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+                        TraceLoggingWrite(
+                            g_traceProvider, "xrCreateSession", TLArg(adapterDescription.c_str(), "DeviceName"));
+                        Log("Using Direct3D 12 on adapter: %s\n", adapterDescription.c_str());
+
+                        std::unique_lock lock(m_adapterIndexLock);
+                        m_dxgiAdapterIndex = adapterIndex;
+                        break;
+                    }
+                }
+
+                // Create the interop device that the runtime will be using...
+                CHECK_HRCMD(D3D12CreateDevice(dxgiAdapter.Get(),
+                                              m_d3d12Requirements.minFeatureLevel,
+                                              IID_PPV_ARGS(session.runtimeDevice.ReleaseAndGetAddressOf())));
+
+                // ... and the necessary queue.
+                CHECK_HRCMD(session.runtimeDevice->CreateCommandQueue(
+                    &queueDesc, IID_PPV_ARGS(session.runtimeQueue.ReleaseAndGetAddressOf())));
+
+                // We will use a shareable fence to synchronize between the Vulkan queue and the D3D queue.
+                CHECK_HRCMD(session.runtimeDevice->CreateFence(
+                    0, D3D12_FENCE_FLAG_SHARED, IID_PPV_ARGS(session.runtimeFence.ReleaseAndGetAddressOf())));
             }
 
-            // Create the semaphore that we will use to synchronize between the OpenGL context
-            // and the D3D queue.
-            session.gl.dispatch.glGenSemaphoresEXT(1, &session.gl.semaphore);
+            // Monitor the video memory budget of the adapter.
+            if (m_evictIdleSwapchains) {
+                ComPtr<IDXGIFactory4> dxgiFactory;
+                CHECK_HRCMD(CreateDXGIFactory1(IID_PPV_ARGS(dxgiFactory.ReleaseAndGetAddressOf())));
+                CHECK_HRCMD(dxgiFactory->EnumAdapterByLuid(session.adapterLuid,
+                                                           IID_PPV_ARGS(session.dxgiAdapter.ReleaseAndGetAddressOf())));
+            }
 
-            // Import the D3D fence into the semaphore.
-            CHECK_HRCMD(session.runtimeDevice->CreateSharedHandle(session.runtimeFence.Get(),
-                                                                  nullptr,
-                                                                  GENERIC_ALL,
-                                                                  nullptr,
-                                                                  session.gl.fenceHandleForAMDWorkaround.put()));
+            // We may need command lists to perform copies between shareable/non-shareable textures. They are created
+            // on demand.
+            if (m_useCopyQueue) {
+                if (!session.copyQueue) {
+                    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+                    CHECK_HRCMD(session.runtimeDevice->CreateCommandQueue(
+                        &queueDesc, IID_PPV_ARGS(session.copyQueue.ReleaseAndGetAddressOf())));
+                }
 
-            session.gl.dispatch.glImportSemaphoreWin32HandleEXT(
-                session.gl.semaphore, GL_HANDLE_TYPE_D3D12_FENCE_EXT, session.gl.fenceHandleForAMDWorkaround.get());
+                session.copyCommandLists.initialize(session.runtimeDevice.Get(), D3D12_COMMAND_LIST_TYPE_COPY);
+                session.transitionCommandLists.initialize(session.runtimeDevice.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
+            } else {
+                session.copyCommandLists.initialize(session.runtimeDevice.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
+            }
+        }
 
-            return XR_SUCCESS;
+        // Release the resources of a session that failed to be created, including the runtime context that it may
+        // have borrowed. The session was never registered, but cleanupSession() sweeps m_swapchains, which requires
+        // the registry lock.
+        XrResult abandonSession(Session& session, XrResult result) {
+            std::unique_lock registryLock(m_registryLock);
+            cleanupSession(session);
+            return result;
         }
 
+        // Must be called with the registry lock held exclusively.
         void cleanupSession(Session& session) {
+            if (session.frameArena.frameCount) {
+                Log("Submitted %llu frames, %llu frames allocated memory, %llu copies skipped\n",
+                    session.frameArena.frameCount,
+                    session.frameArena.growthCount,
+                    session.frameArena.skippedCopyCount);
+            }
+            if (session.copyCommandLists.getDepth()) {
+                Log("Copy command lists: depth=%zu, waited %llu times, copied %llu MB\n",
+                    session.copyCommandLists.getDepth(),
+                    session.copyCommandLists.getWaitCount(),
+                    session.copiedBytes / (1024 * 1024));
+            }
+
+            // The memory still held by the session, before releasing its swapchains.
+            if (session.vram.peakBytes) {
+                const SwapchainMemory totals = session.vram.getTotals();
+                Log("Swapchain memory: runtime %.1f MB, bounce %.1f MB, imported %.1f MB, peak %.1f MB (runtime and "
+                    "bounce images)\n",
+                    totals.runtimeBytes / (1024.0 * 1024.0),
+                    totals.bounceBytes / (1024.0 * 1024.0),
+                    totals.importedBytes / (1024.0 * 1024.0),
+                    session.vram.peakBytes / (1024.0 * 1024.0));
+                TraceLoggingWrite(g_traceProvider,
+                                  "VramLedger_SessionEnd",
+                                  TLXArg(session.xrSession, "Session"),
+                                  TLArg(totals.runtimeBytes, "RuntimeBytes"),
+                                  TLArg(totals.bounceBytes, "BounceBytes"),
+                                  TLArg(totals.importedBytes, "ImportedBytes"),
+                                  TLArg(session.vram.peakBytes.load(), "PeakBytes"));
+            }
+
             // Wait for both devices to be idle.
             if (session.runtimeFence) {
                 wil::unique_handle eventHandle;
@@ -1733,59 +3510,117 @@ namespace {
                 WaitForSingleObject(eventHandle.get(), INFINITE);
             }
 
-            if (session.api == GfxApi::Vulkan) {
-                if (session.vk.device != VK_NULL_HANDLE) {
-                    session.vk.dispatch.vkDeviceWaitIdle(session.vk.device);
-                }
-            } else {
-                GlContextSwitch context(session);
-                glFinish();
+            if (session.app) {
+                session.app->waitIdle(session);
             }
 
-            for (auto it = m_swapchains.begin(); it != m_swapchains.end();) {
-                auto& swapchain = it->second;
-                if (swapchain.xrSession == session.xrSession) {
-                    cleanupSwapchain(swapchain);
-                    it = m_swapchains.erase(it);
-                } else {
-                    it++;
-                }
+            for (XrSwapchain swapchain :
+                 m_swapchains.collect([&](const Swapchain& entry) { return entry.frame.session == &session; })) {
+                cleanupSwapchain(*m_swapchains.find(swapchain));
+                m_swapchains.erase(swapchain);
             }
-
-            if (session.api == GfxApi::Vulkan) {
-                if (session.vk.cmdBuffer != VK_NULL_HANDLE) {
-                    session.vk.dispatch.vkFreeCommandBuffers(
-                        session.vk.device, session.vk.cmdPool, 1, &session.vk.cmdBuffer);
+            for (size_t i = 0; i < (size_t)Call::Count; i++) {
+                const auto& histogram = session.callOverhead[i];
+                const uint64_t count = histogram.getCount();
+                if (!count) {
+                    continue;
                 }
-                if (session.vk.cmdPool != VK_NULL_HANDLE) {
-                    session.vk.dispatch.vkDestroyCommandPool(session.vk.device, session.vk.cmdPool, m_vkAllocator);
+                const uint64_t p50 = histogram.getPercentile(0.5);
+                const uint64_t p99 = histogram.getPercentile(0.99);
+                const uint64_t p999 = histogram.getPercentile(0.999);
+                Log("%s overhead: %llu calls, p50 %.1f us, p99 %.1f us, p99.9 %.1f us\n",
+                    CallNames[i],
+                    count,
+                    p50 / 1000.0,
+                    p99 / 1000.0,
+                    p999 / 1000.0);
+                TraceLoggingWrite(g_traceProvider,
+                                  "CallOverhead",
+                                  TLArg(CallNames[i], "Call"),
+                                  TLArg(count, "Count"),
+                                  TLArg(p50, "P50Ns"),
+                                  TLArg(p99, "P99Ns"),
+                                  TLArg(p999, "P999Ns"));
+            }
+            if (session.frameProfiler.isEnabled()) {
+                logFramePhases(snapshotFramePhases(session.frameProfiler, true), true);
+            }
+            if (m_measureLockContention) {
+                for (size_t i = 0; i < (size_t)Lock::Count; i++) {
+                    logLockStatistics(LockNames[i], session.lockStatistics[i]);
                 }
-                if (session.vk.timelineSemaphore != VK_NULL_HANDLE) {
-                    session.vk.dispatch.vkDestroySemaphore(
-                        session.vk.device, session.vk.timelineSemaphore, m_vkAllocator);
+            }
+            if (session.evictionCount || session.makeResidentCount) {
+                Log("Residency: %llu evictions (%.1f MB, from the runtime device only, not reclaimed), %llu made "
+                    "resident\n",
+                    session.evictionCount.load(),
+                    session.evictedBytes / (1024.0 * 1024.0),
+                    session.makeResidentCount.load());
+            }
+            if (session.swapchainCacheHits || session.swapchainCacheMisses) {
+                Log("Swapchain cache: %llu hits, %llu misses\n",
+                    session.swapchainCacheHits,
+                    session.swapchainCacheMisses);
+            }
+            while (!session.swapchainCache.empty()) {
+                evictCachedSwapchain(session, session.swapchainCache.begin());
+            }
+            collectRetiredSwapchains(session, 1000);
+            {
+                const SwapchainMemory remaining = session.vram.getTotals();
+                if (remaining.runtimeBytes || remaining.bounceBytes || remaining.importedBytes) {
+                    Log("Swapchain memory not released: runtime %.1f MB, bounce %.1f MB, imported %.1f MB\n",
+                        remaining.runtimeBytes / (1024.0 * 1024.0),
+                        remaining.bounceBytes / (1024.0 * 1024.0),
+                        remaining.importedBytes / (1024.0 * 1024.0));
                 }
-            } else {
-                GlContextSwitch context(session);
-                if (session.gl.semaphore) {
-                    session.gl.dispatch.glDeleteSemaphoresEXT(1, &session.gl.semaphore);
+            }
+
+            // The application's device is idle at this point.
+            if (session.app) {
+                session.app->destroy(session);
+            }
+
+            // Return the device to the pool for the next session. All the work on its queues completed above.
+            if (session.runtimeDevice && session.runtimeFence &&
+                SUCCEEDED(session.runtimeDevice->GetDeviceRemovedReason())) {
+                std::unique_lock lock(m_runtimeContextsLock);
+                if (m_runtimeContexts.size() < MaxRuntimeContexts) {
+                    RuntimeContext& context = m_runtimeContexts.emplace_back();
+                    context.adapterLuid = session.adapterLuid;
+                    context.device = std::move(session.runtimeDevice);
+                    context.queue = std::move(session.runtimeQueue);
+                    context.copyQueue = std::move(session.copyQueue);
+                    context.fence = std::move(session.runtimeFence);
+                    context.fenceValue = session.fenceValue;
                 }
             }
         }
 
-        void getRuntimeSwapchainImages(const Session& sessionState,
-                                       Swapchain& swapchainState,
-                                       std::vector<wil::unique_handle>& textureHandles) {
-            // Enumerate the runtime swapchain images.
+        std::vector<XrSwapchainImageD3D12KHR> enumerateRuntimeSwapchainImages(XrSwapchain swapchain) {
             uint32_t count = 0;
-            CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainImages(swapchainState.xrSwapchain, 0, &count, nullptr));
+            CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainImages(swapchain, 0, &count, nullptr));
             std::vector<XrSwapchainImageD3D12KHR> runtimeImages(count, {XR_TYPE_SWAPCHAIN_IMAGE_D3D12_KHR});
             CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainImages(
-                swapchainState.xrSwapchain,
-                count,
-                &count,
-                reinterpret_cast<XrSwapchainImageBaseHeader*>(runtimeImages.data())));
+                swapchain, count, &count, reinterpret_cast<XrSwapchainImageBaseHeader*>(runtimeImages.data())));
+            return runtimeImages;
+        }
+
+        void getRuntimeSwapchainImages(const Session& sessionState,
+                                       Swapchain& swapchainState,
+                                       std::vector<wil::unique_handle>& textureHandles) {
+            const auto runtimeImages = enumerateRuntimeSwapchainImages(swapchainState.xrSwapchain);
+            const uint32_t count = (uint32_t)runtimeImages.size();
+
+            // The size of the allocations, used for importing the textures and for the VRAM ledger.
+            if (count) {
+                const auto& desc = runtimeImages[0].texture->GetDesc();
+                swapchainState.imageAllocationBytes =
+                    sessionState.runtimeDevice->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+            }
 
             // Export each texture as a HANDLE.
+            bool shareable = true;
             for (uint32_t i = 0; i < count; i++) {
                 // Dump the runtime texture descriptor.
                 if (i == 0) {
@@ -1817,19 +3652,40 @@ namespace {
                     }
                 }
 
-                swapchainState.runtimeImages.push_back(runtimeImages[i].texture);
+                swapchainState.frame.runtimeImages.push_back(runtimeImages[i].texture);
 
                 D3D12_HEAP_FLAGS heapFlags;
                 CHECK_HRCMD(runtimeImages[i].texture->GetHeapProperties(nullptr, &heapFlags));
 
+                if (!(heapFlags & D3D12_HEAP_FLAG_SHARED)) {
+                    shareable = false;
+                    continue;
+                }
+
                 wil::unique_handle textureHandle = nullptr;
-                if ((heapFlags & D3D12_HEAP_FLAG_SHARED)) {
-                    CHECK_HRCMD(sessionState.runtimeDevice->CreateSharedHandle(
-                        runtimeImages[i].texture, nullptr, GENERIC_ALL, nullptr, textureHandle.put()));
-                } else {
-                    // If the runtime textures are not shareable, then we must use a bounce buffer. We will give the
-                    // application a set of shareable textures that we created, and perform a copy to the runtime
-                    // textures during xrEndFrame().
+                CHECK_HRCMD(sessionState.runtimeDevice->CreateSharedHandle(
+                    runtimeImages[i].texture, nullptr, GENERIC_ALL, nullptr, textureHandle.put()));
+                textureHandles.push_back(std::move(textureHandle));
+            }
+
+            if (!shareable) {
+                // If the runtime textures are not shareable, then we must use a bounce buffer. We will give the
+                // application a set of shareable textures that we created, and perform a copy to the runtime
+                // textures during xrEndFrame(). With virtual images, the number of textures we create is decoupled
+                // from the number of runtime textures.
+                textureHandles.clear();
+                swapchainState.frame.virtualImages = m_virtualSwapchainImages != 0;
+
+                // Advertise this format last from now on.
+                const util::FormatInfo* format = sessionState.app->getFormatInfo(swapchainState.createInfo.format);
+                if (format) {
+                    std::unique_lock lock(m_bounceFormatsLock);
+                    if (m_bounceFormats.insert(format->dxgi).second) {
+                        m_bounceFormatsGeneration++;
+                    }
+                }
+                const uint32_t shareableCount = swapchainState.frame.virtualImages ? m_virtualSwapchainImages : count;
+                for (uint32_t i = 0; i < shareableCount; i++) {
                     ComPtr<ID3D12Resource> shareableTexture;
                     D3D12_HEAP_PROPERTIES heapProperties{};
                     heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
@@ -1843,308 +3699,482 @@ namespace {
                         nullptr,
                         IID_PPV_ARGS(shareableTexture.ReleaseAndGetAddressOf())));
 
+                    wil::unique_handle textureHandle = nullptr;
                     CHECK_HRCMD(sessionState.runtimeDevice->CreateSharedHandle(
                         shareableTexture.Get(), nullptr, GENERIC_ALL, nullptr, textureHandle.put()));
+                    textureHandles.push_back(std::move(textureHandle));
 
                     swapchainState.shareableImages.push_back(shareableTexture);
                 }
-                textureHandles.push_back(std::move(textureHandle));
-            }
-        }
 
-        void initializeVulkanSwapchain(const Session& sessionState, Swapchain& swapchain) {
-            const auto& swapchainInfo = swapchain.createInfo;
-
-            const bool needTransition = swapchainInfo.usageFlags & (XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT |
-                                                                    XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
-
-            // Helper to select the memory type.
-            auto findMemoryType = [&sessionState](uint32_t memoryTypeBitsRequirement, VkFlags requirementsMask) {
-                for (uint32_t memoryIndex = 0; memoryIndex < VK_MAX_MEMORY_TYPES; ++memoryIndex) {
-                    const uint32_t memoryTypeBits = (1 << memoryIndex);
-                    const bool isRequiredMemoryType = memoryTypeBitsRequirement & memoryTypeBits;
-                    const bool satisfiesFlags =
-                        (sessionState.vk.memoryProperties.memoryTypes[memoryIndex].propertyFlags & requirementsMask) ==
-                        requirementsMask;
+                // Remember the size of the textures, to report the amount of data copied.
+                const auto& desc = runtimeImages[0].texture->GetDesc();
+                sessionState.runtimeDevice->GetCopyableFootprints(&desc,
+                                                                  0,
+                                                                  desc.MipLevels * desc.DepthOrArraySize,
+                                                                  0,
+                                                                  nullptr,
+                                                                  nullptr,
+                                                                  nullptr,
+                                                                  &swapchainState.frame.imageBytes);
+                swapchainState.frame.format = util::GetFormatInfo(desc.Format);
 
-                    if (isRequiredMemoryType && satisfiesFlags) {
-                        return memoryIndex;
-                    }
+                if (swapchainState.frame.virtualImages) {
+                    Log("Using %u virtual images (runtime has %u images)\n", shareableCount, count);
+                    *swapchainState.frame.copyEvent.put() =
+                        CreateEventEx(nullptr, L"Virtual Swapchain Copy Fence", 0, EVENT_ALL_ACCESS);
                 }
-
-                CHECK_VKCMD(VK_ERROR_UNKNOWN);
-                return 0u;
-            };
-
-            // Start a command list to transition images.
-            if (needTransition) {
-                // Simplify our code here by waiting for the queue to be idle.
-                sessionState.vk.dispatch.vkQueueWaitIdle(sessionState.vk.queue);
-
-                VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
-                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-                CHECK_VKCMD(sessionState.vk.dispatch.vkBeginCommandBuffer(sessionState.vk.cmdBuffer, &beginInfo));
             }
 
-            std::vector<wil::unique_handle> runtimeTextureHandles;
-            getRuntimeSwapchainImages(sessionState, swapchain, runtimeTextureHandles);
+            // Size the per-image state to the number of images seen by the application.
+            const size_t imageCount = textureHandles.size();
+            swapchainState.frame.needCopy = !swapchainState.shareableImages.empty();
+            swapchainState.frame.runtimeImageState = getRuntimeImageState(swapchainState.createInfo);
+            swapchainState.frame.acquiredIndex.resize(imageCount);
+            swapchainState.frame.readyFenceValue.resize(imageCount, 0);
+            swapchainState.frame.copyFenceValue.resize(imageCount, 0);
+            swapchainState.frame.runtimeImageContent.resize(count);
+        }
 
-            for (uint32_t i = 0; i < runtimeTextureHandles.size(); i++) {
-                // Prepare the Vulkan image that the app will use.
-                VkImage image;
+        // The resources must no longer be in use by the GPU (see retireSwapchain()).
+        void cleanupSwapchain(Swapchain& swapchain) {
+            auto& sessionState = *swapchain.frame.session;
 
-                VkExternalMemoryImageCreateInfo externalCreateInfo{VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO};
-                externalCreateInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_D3D12_RESOURCE_BIT;
+            updateVramLedger(sessionState, swapchain.memory, true);
+            swapchain.memory = {};
 
-                VkImageCreateInfo createInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO, &externalCreateInfo};
-                createInfo.imageType = VK_IMAGE_TYPE_2D;
-                createInfo.format = (VkFormat)swapchainInfo.format;
-                createInfo.extent.width = swapchainInfo.width;
-                createInfo.extent.height = swapchainInfo.height;
-                createInfo.extent.depth = 1;
-                createInfo.mipLevels = swapchainInfo.mipCount;
-                createInfo.arrayLayers = swapchainInfo.arraySize;
-                createInfo.samples = (VkSampleCountFlagBits)swapchainInfo.sampleCount;
-                createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-                createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-                if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) {
-                    createInfo.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-                }
-                if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
-                    createInfo.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-                }
-                if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_SAMPLED_BIT) {
-                    createInfo.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
-                }
-                if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_UNORDERED_ACCESS_BIT) {
-                    createInfo.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
-                }
-                if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_TRANSFER_SRC_BIT) {
-                    createInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-                }
-                if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_TRANSFER_DST_BIT) {
-                    createInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-                }
-                if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_MUTABLE_FORMAT_BIT) {
-                    createInfo.usage |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
-                }
-                createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-                CHECK_VKCMD(
-                    sessionState.vk.dispatch.vkCreateImage(sessionState.vk.device, &createInfo, m_vkAllocator, &image));
+            sessionState.app->destroySwapchain(sessionState, swapchain);
+        }
 
-                swapchain.vk.images.push_back(image);
+        // Queue the destruction of a swapchain until the GPU work referencing it has completed. Must be called with
+        // the session lock held.
+        void retireSwapchain(Session& sessionState, std::unique_ptr<Swapchain> swapchain) {
+            Session::RetiredSwapchain retired;
+            retired.swapchain = std::move(swapchain);
 
-                // Import the device memory from D3D.
-                VkDeviceMemory memory;
+            // The runtime swapchain was already destroyed.
+            SwapchainMemory runtimeMemory;
+            runtimeMemory.runtimeBytes = std::exchange(retired.swapchain->memory.runtimeBytes, 0);
+            updateVramLedger(sessionState, runtimeMemory, true);
 
-                VkImageMemoryRequirementsInfo2 requirementInfo{VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2};
-                requirementInfo.image = image;
-                VkMemoryRequirements2 requirements{VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
-                sessionState.vk.dispatch.vkGetImageMemoryRequirements2KHR(
-                    sessionState.vk.device, &requirementInfo, &requirements);
+            // The application has submitted all of its work referencing the swapchain.
+            retired.interopFenceValue = signalInteropFence(sessionState);
+            {
+                std::unique_lock copyLock(sessionState.copyMutex);
+                retired.copyFenceValue = sessionState.copyCommandLists.getFenceValue();
+            }
 
-                VkMemoryWin32HandlePropertiesKHR handleProperties{VK_STRUCTURE_TYPE_MEMORY_WIN32_HANDLE_PROPERTIES_KHR};
-                CHECK_VKCMD(sessionState.vk.dispatch.vkGetMemoryWin32HandlePropertiesKHR(
-                    sessionState.vk.device,
-                    VK_EXTERNAL_MEMORY_HANDLE_TYPE_D3D12_RESOURCE_BIT,
-                    runtimeTextureHandles[i].get(),
-                    &handleProperties));
+            TraceLoggingWrite(g_traceProvider,
+                              "RetireSwapchain",
+                              TLXArg(retired.swapchain->xrSwapchain, "Swapchain"),
+                              TLArg(retired.interopFenceValue, "InteropFenceValue"),
+                              TLArg(retired.copyFenceValue, "CopyFenceValue"));
+
+            // Only the application images of the bounce textures are independent of the runtime swapchain.
+            if (m_swapchainCacheMaxBytes && retired.swapchain->frame.needCopy) {
+                sessionState.swapchainCacheBytes += getSwapchainBytes(*retired.swapchain);
+                sessionState.swapchainCache.push_back(std::move(retired));
+
+                // Evict the least recently retired swapchains.
+                while (sessionState.swapchainCacheBytes > m_swapchainCacheMaxBytes) {
+                    evictCachedSwapchain(sessionState, sessionState.swapchainCache.begin());
+                }
+            } else {
+                sessionState.retiredSwapchains.push_back(std::move(retired));
+            }
+        }
 
-                VkImportMemoryWin32HandleInfoKHR importInfo{VK_STRUCTURE_TYPE_IMPORT_MEMORY_WIN32_HANDLE_INFO_KHR};
-                importInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_D3D12_RESOURCE_BIT;
-                importInfo.handle = runtimeTextureHandles[i].get();
+        static UINT64 getSwapchainBytes(const Swapchain& swapchain) {
+            return swapchain.memory.bounceBytes;
+        }
 
-                VkMemoryDedicatedAllocateInfo memoryAllocateInfo{VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO,
-                                                                 &importInfo};
-                memoryAllocateInfo.image = image;
+        // Add (or remove) the memory of a swapchain to the session's VRAM ledger.
+        void updateVramLedger(Session& sessionState, const SwapchainMemory& memory, bool release) {
+            auto& vram = sessionState.vram;
+            if (release) {
+                vram.runtimeBytes -= memory.runtimeBytes;
+                vram.bounceBytes -= memory.bounceBytes;
+                vram.importedBytes -= memory.importedBytes;
+            } else {
+                vram.runtimeBytes += memory.runtimeBytes;
+                vram.bounceBytes += memory.bounceBytes;
+                vram.importedBytes += memory.importedBytes;
+            }
 
-                VkMemoryAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, &memoryAllocateInfo};
-                allocateInfo.allocationSize = requirements.memoryRequirements.size;
-                allocateInfo.memoryTypeIndex =
-                    findMemoryType(handleProperties.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+            // The imported images are aliases and do not count towards the total.
+            const UINT64 totalBytes = vram.runtimeBytes + vram.bounceBytes;
+            UINT64 peakBytes = vram.peakBytes;
+            while (totalBytes > peakBytes && !vram.peakBytes.compare_exchange_weak(peakBytes, totalBytes)) {
+            }
 
-                CHECK_VKCMD(sessionState.vk.dispatch.vkAllocateMemory(
-                    sessionState.vk.device, &allocateInfo, m_vkAllocator, &memory));
+            TraceLoggingWrite(g_traceProvider,
+                              "VramLedger",
+                              TLXArg(sessionState.xrSession, "Session"),
+                              TLArg(vram.runtimeBytes.load(), "RuntimeBytes"),
+                              TLArg(vram.bounceBytes.load(), "BounceBytes"),
+                              TLArg(vram.importedBytes.load(), "ImportedBytes"));
+        }
 
-                swapchain.vk.deviceMemory.push_back(memory);
+        // Move a cached swapchain to the queue of swapchains to destroy. Must be called with the session lock held.
+        void evictCachedSwapchain(Session& sessionState, std::vector<Session::RetiredSwapchain>::iterator it) {
+            TraceLoggingWrite(
+                g_traceProvider, "EvictCachedSwapchain", TLXArg(it->swapchain->xrSwapchain, "Swapchain"));
+            sessionState.swapchainCacheBytes -= getSwapchainBytes(*it->swapchain);
+            sessionState.retiredSwapchains.push_back(std::move(*it));
+            sessionState.swapchainCache.erase(it);
+        }
 
-                CHECK_VKCMD(sessionState.vk.dispatch.vkBindImageMemory(sessionState.vk.device, image, memory, 0));
+        static bool isSameCreateInfo(const XrSwapchainCreateInfo& a, const XrSwapchainCreateInfo& b) {
+            return a.createFlags == b.createFlags && a.usageFlags == b.usageFlags && a.format == b.format &&
+                   a.sampleCount == b.sampleCount && a.width == b.width && a.height == b.height &&
+                   a.faceCount == b.faceCount && a.arraySize == b.arraySize && a.mipCount == b.mipCount;
+        }
 
-                // Transition the image to the layout expected by the application.
-                if (needTransition) {
-                    VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
-                    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-                    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                    if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT) {
-                        barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-                    }
-                    if (swapchainInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
-                        barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-                        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        // Attempt to give the application the images of a cached swapchain with the same creation parameters. The
+        // runtime images must not be shareable (otherwise the application images must import them), and their
+        // description must match the cached bounce textures.
+        bool reuseCachedSwapchain(Session& sessionState, Swapchain& swapchain) {
+            std::optional<Session::RetiredSwapchain> cached;
+            {
+                std::unique_lock sessionLock(sessionState.mutex);
+                auto& cache = sessionState.swapchainCache;
+                for (auto it = cache.rbegin(); it != cache.rend(); ++it) {
+                    if (isSameCreateInfo(it->swapchain->createInfo, swapchain.createInfo)) {
+                        sessionState.swapchainCacheBytes -= getSwapchainBytes(*it->swapchain);
+                        cached = std::move(*it);
+                        cache.erase(std::next(it).base());
+                        break;
                     }
-                    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-                    barrier.image = swapchain.vk.images[i];
-                    barrier.subresourceRange.baseMipLevel = 0;
-                    barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
-                    barrier.subresourceRange.baseArrayLayer = 0;
-                    barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
-
-                    sessionState.vk.dispatch.vkCmdPipelineBarrier(sessionState.vk.cmdBuffer,
-                                                                  VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                                                                  VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
-                                                                  0,
-                                                                  0,
-                                                                  (VkMemoryBarrier*)nullptr,
-                                                                  0,
-                                                                  (VkBufferMemoryBarrier*)nullptr,
-                                                                  1,
-                                                                  &barrier);
+                }
+                if (!cached) {
+                    sessionState.swapchainCacheMisses++;
+                    return false;
                 }
             }
 
-            // Execute the command list to transition images.
-            if (needTransition) {
-                sessionState.vk.dispatch.vkEndCommandBuffer(sessionState.vk.cmdBuffer);
+            auto& cachedFrame = cached->swapchain->frame;
+            const auto runtimeImages = enumerateRuntimeSwapchainImages(swapchain.xrSwapchain);
+            const auto& cachedDesc = cached->swapchain->shareableImages[0]->GetDesc();
+            const size_t expectedImageCount =
+                cachedFrame.virtualImages ? m_virtualSwapchainImages : runtimeImages.size();
+            bool compatible =
+                !runtimeImages.empty() && cached->swapchain->shareableImages.size() == expectedImageCount;
+            for (const auto& image : runtimeImages) {
+                D3D12_HEAP_FLAGS heapFlags;
+                CHECK_HRCMD(image.texture->GetHeapProperties(nullptr, &heapFlags));
+                const auto& desc = image.texture->GetDesc();
+                compatible = compatible && !(heapFlags & D3D12_HEAP_FLAG_SHARED) && desc.Width == cachedDesc.Width &&
+                             desc.Height == cachedDesc.Height && desc.DepthOrArraySize == cachedDesc.DepthOrArraySize &&
+                             desc.MipLevels == cachedDesc.MipLevels && desc.Format == cachedDesc.Format &&
+                             desc.SampleDesc.Count == cachedDesc.SampleDesc.Count;
+            }
+            if (!compatible) {
+                std::unique_lock sessionLock(sessionState.mutex);
+                sessionState.retiredSwapchains.push_back(std::move(*cached));
+                sessionState.swapchainCacheMisses++;
+                return false;
+            }
+
+            // Take over the application images, and their accounting in the VRAM ledger.
+            swapchain.imageAllocationBytes = cached->swapchain->imageAllocationBytes;
+            swapchain.memory = std::exchange(cached->swapchain->memory, {});
+            swapchain.shareableImages = std::move(cached->swapchain->shareableImages);
+            swapchain.app = std::move(cached->swapchain->app);
 
-                VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
-                submitInfo.commandBufferCount = 1;
-                submitInfo.pCommandBuffers = &sessionState.vk.cmdBuffer;
-                CHECK_VKCMD(
-                    sessionState.vk.dispatch.vkQueueSubmit(sessionState.vk.queue, 1, &submitInfo, VK_NULL_HANDLE));
+            auto& frame = swapchain.frame;
+            for (const auto& image : runtimeImages) {
+                frame.runtimeImages.push_back(image.texture);
+            }
+            frame.needCopy = true;
+            frame.virtualImages = cachedFrame.virtualImages;
+            frame.copyEvent = std::move(cachedFrame.copyEvent);
+            frame.runtimeImageState = cachedFrame.runtimeImageState;
+            frame.format = cachedFrame.format;
+            frame.imageBytes = cachedFrame.imageBytes;
+            frame.evicted = cachedFrame.evicted;
+            const size_t imageCount = swapchain.shareableImages.size();
+            frame.acquiredIndex.resize(imageCount);
+            frame.readyFenceValue.resize(imageCount, 0);
+            frame.runtimeImageContent.resize(runtimeImages.size());
+
+            // Our previous copies from the images might still be in flight. With virtual images, this is taken care
+            // of in xrWaitSwapchainImage().
+            frame.copyFenceValue.resize(imageCount, cached->copyFenceValue);
+            ID3D12Fence* const copyFence = sessionState.copyCommandLists.getFence();
+            if (!frame.virtualImages && copyFence && copyFence->GetCompletedValue() < cached->copyFenceValue) {
+                wil::unique_handle eventHandle;
+                *eventHandle.put() = CreateEventEx(nullptr, L"Cached Swapchain Fence", 0, EVENT_ALL_ACCESS);
+                CHECK_HRCMD(copyFence->SetEventOnCompletion(cached->copyFenceValue, eventHandle.get()));
+                WaitForSingleObject(eventHandle.get(), INFINITE);
             }
-        }
 
-        void initializeOpenGLSwapchain(const Session& sessionState, Swapchain& swapchain) {
-            GlContextSwitch context(sessionState);
+            {
+                std::unique_lock sessionLock(sessionState.mutex);
+                sessionState.swapchainCacheHits++;
+            }
+            Log("Reusing the images of a previously destroyed swapchain\n");
+            TraceLoggingWrite(g_traceProvider,
+                              "ReuseCachedSwapchain",
+                              TLXArg(cached->swapchain->xrSwapchain, "CachedSwapchain"));
 
-            getRuntimeSwapchainImages(sessionState, swapchain, swapchain.gl.textureHandlesForAMDWorkaround);
+            return true;
+        }
 
-            const auto& swapchainInfo = swapchain.createInfo;
+        // Release the resources of the retired swapchains that are no longer in use. With a timeout, wait up to that
+        // long in total for the GPU work, then release the resources regardless. Must be called with the session lock
+        // held.
+        void collectRetiredSwapchains(Session& sessionState, DWORD timeoutMs = 0) {
+            ID3D12Fence* const copyFence = sessionState.copyCommandLists.getFence();
 
-            for (uint32_t i = 0; i < swapchain.gl.textureHandlesForAMDWorkaround.size(); i++) {
-                // Import the device memory from D3D.
-                GLuint memory;
-                sessionState.gl.dispatch.glCreateMemoryObjectsEXT(1, &memory);
-                swapchain.gl.memory.push_back(memory);
+            wil::unique_handle eventHandle;
+            if (timeoutMs && !sessionState.retiredSwapchains.empty()) {
+                *eventHandle.put() = CreateEventEx(nullptr, L"Retired Swapchain Fence", 0, EVENT_ALL_ACCESS);
+            }
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+            const auto remainingMs = [&]() {
+                const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now());
+                return remaining.count() > 0 ? (DWORD)remaining.count() : 0;
+            };
 
-                size_t bytePerPixels = 0;
-                for (size_t j = 0; j < ARRAYSIZE(util::DxgiToGlFormat); j++) {
-                    if (util::DxgiToGlFormat[j].gl == swapchainInfo.format) {
-                        bytePerPixels = util::DxgiToGlFormat[j].size;
-                        break;
+            auto& retiredSwapchains = sessionState.retiredSwapchains;
+            for (auto it = retiredSwapchains.begin(); it != retiredSwapchains.end();) {
+                const auto isCompleted = [&]() {
+                    return sessionState.runtimeFence->GetCompletedValue() >= it->interopFenceValue &&
+                           (!copyFence || copyFence->GetCompletedValue() >= it->copyFenceValue);
+                };
+
+                if (!isCompleted() && eventHandle) {
+                    CHECK_HRCMD(
+                        sessionState.runtimeFence->SetEventOnCompletion(it->interopFenceValue, eventHandle.get()));
+                    WaitForSingleObject(eventHandle.get(), remainingMs());
+                    if (copyFence) {
+                        CHECK_HRCMD(copyFence->SetEventOnCompletion(it->copyFenceValue, eventHandle.get()));
+                        WaitForSingleObject(eventHandle.get(), remainingMs());
+                    }
+                    if (!isCompleted()) {
+                        Log("Timed out waiting for swapchain resources to be idle\n");
                     }
                 }
 
-                // TODO: Not sure why we need to multiply by 2. Mipmapping?
-                // https://stackoverflow.com/questions/71108346/how-to-use-glimportmemorywin32handleext-to-share-an-id3d11texture2d-keyedmutex-s
-                sessionState.gl.dispatch.glImportMemoryWin32HandleEXT(
-                    memory,
-                    swapchainInfo.arraySize * swapchainInfo.width * swapchainInfo.height * swapchainInfo.sampleCount *
-                        bytePerPixels * 2,
-                    GL_HANDLE_TYPE_D3D12_RESOURCE_EXT,
-                    swapchain.gl.textureHandlesForAMDWorkaround[i].get());
-
-                // Create the texture that the app will use.
-                GLuint image;
-
-                if (swapchainInfo.arraySize == 1) {
-                    if (swapchainInfo.sampleCount == 1) {
-                        sessionState.gl.dispatch.glCreateTextures(GL_TEXTURE_2D, 1, &image);
-                        sessionState.gl.dispatch.glTextureStorageMem2DEXT(image,
-                                                                          swapchainInfo.mipCount,
-                                                                          (GLenum)swapchainInfo.format,
-                                                                          swapchainInfo.width,
-                                                                          swapchainInfo.height,
-                                                                          memory,
-                                                                          0);
-                    } else {
-                        sessionState.gl.dispatch.glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &image);
-                        sessionState.gl.dispatch.glTextureStorageMem2DMultisampleEXT(image,
-                                                                                     swapchainInfo.sampleCount,
-                                                                                     (GLenum)swapchainInfo.format,
-                                                                                     swapchainInfo.width,
-                                                                                     swapchainInfo.height,
-                                                                                     GL_TRUE,
-                                                                                     memory,
-                                                                                     0);
-                    }
+                if (isCompleted() || eventHandle) {
+                    TraceLoggingWrite(g_traceProvider,
+                                      "CollectRetiredSwapchain",
+                                      TLXArg(it->swapchain->xrSwapchain, "Swapchain"));
+                    cleanupSwapchain(*it->swapchain);
+                    it = retiredSwapchains.erase(it);
                 } else {
-                    if (swapchainInfo.sampleCount == 1) {
-                        sessionState.gl.dispatch.glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &image);
-                        sessionState.gl.dispatch.glTextureStorageMem3DEXT(image,
-                                                                          swapchainInfo.mipCount,
-                                                                          (GLenum)swapchainInfo.format,
-                                                                          swapchainInfo.width,
-                                                                          swapchainInfo.height,
-                                                                          swapchainInfo.arraySize,
-                                                                          memory,
-                                                                          0);
-                    } else {
-                        sessionState.gl.dispatch.glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE_ARRAY, 1, &image);
-                        sessionState.gl.dispatch.glTextureStorageMem3DMultisampleEXT(image,
-                                                                                     swapchainInfo.sampleCount,
-                                                                                     (GLenum)swapchainInfo.format,
-                                                                                     swapchainInfo.width,
-                                                                                     swapchainInfo.height,
-                                                                                     swapchainInfo.arraySize,
-                                                                                     GL_TRUE,
-                                                                                     memory,
-                                                                                     0);
-                    }
+                    ++it;
                 }
-                swapchain.gl.images.push_back(image);
             }
         }
 
-        void cleanupSwapchain(Swapchain& swapchain) {
-            const auto& sessionState = m_sessions[swapchain.xrSession];
+        // Evict the bounce textures of the swapchains that have not been used for some time, when the application is
+        // over its video memory budget. They are made resident again upon their next use. This only releases the
+        // runtime device's residency: the application's device keeps its imports of the textures resident (see
+        // Session::evictedBytes). Must be called with the session lock held.
+        void manageResidency(Session& sessionState) {
+            DXGI_QUERY_VIDEO_MEMORY_INFO info{};
+            CHECK_HRCMD(sessionState.dxgiAdapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info));
+            const bool overBudget = info.CurrentUsage > info.Budget;
+            if (overBudget) {
+                TraceLoggingWrite(g_traceProvider,
+                                  "ManageResidency_OverBudget",
+                                  TLArg(info.CurrentUsage, "CurrentUsage"),
+                                  TLArg(info.Budget, "Budget"));
+            }
+
+            const uint64_t currentFrame = sessionState.frameArena.frameCount;
+            const UINT64 completedInteropFenceValue = sessionState.runtimeFence->GetCompletedValue();
+            ID3D12Fence* const copyFence = sessionState.copyCommandLists.getFence();
+            const UINT64 completedCopyFenceValue = copyFence ? copyFence->GetCompletedValue() : 0;
 
-            if (sessionState.api == GfxApi::Vulkan) {
-                sessionState.vk.dispatch.vkDeviceWaitIdle(sessionState.vk.device);
+            // The latest values signaled, which the swapchains becoming idle must wait for. The interop fence is also
+            // signaled from xrReleaseSwapchainImage() and the copies are also submitted from there.
+            UINT64 interopFenceValue;
+            {
+                std::unique_lock appQueueLock(sessionState.appQueueMutex);
+                interopFenceValue = sessionState.fenceValue;
+            }
+            UINT64 copyFenceValue;
+            {
+                std::unique_lock copyLock(sessionState.copyMutex);
+                copyFenceValue = sessionState.copyCommandLists.getFenceValue();
+            }
 
-                for (auto& image : swapchain.vk.images) {
-                    sessionState.vk.dispatch.vkDestroyImage(sessionState.vk.device, image, m_vkAllocator);
+            m_swapchains.forEach([&](XrSwapchain handle, Swapchain& swapchain) {
+                if (swapchain.frame.session != &sessionState || swapchain.shareableImages.empty()) {
+                    return;
                 }
-                for (auto& memory : swapchain.vk.deviceMemory) {
-                    sessionState.vk.dispatch.vkFreeMemory(sessionState.vk.device, memory, m_vkAllocator);
+
+                std::unique_lock swapchainLock(swapchain.mutex);
+                auto& frame = swapchain.frame;
+                if (frame.usedSinceLastPoll || frame.acquiredCount) {
+                    frame.usedSinceLastPoll = false;
+                    frame.lastUsedFrame = currentFrame;
+                    frame.evictionPending = false;
+                    return;
+                }
+                if (frame.evicted || !overBudget || currentFrame - frame.lastUsedFrame < ResidencyIdleFrames) {
+                    return;
                 }
-            } else {
-                GlContextSwitch context(sessionState);
-                glFinish();
 
-                for (auto& image : swapchain.gl.images) {
-                    glDeleteTextures(1, &image);
+                // All the work referencing the textures was submitted before the latest signals of the interop fence
+                // and of the copy command lists. Wait for them to complete (without blocking) before evicting.
+                if (!frame.evictionPending) {
+                    frame.evictionPending = true;
+                    frame.evictionInteropFenceValue = interopFenceValue;
+                    frame.evictionCopyFenceValue = copyFenceValue;
+                    return;
                 }
-                for (auto& memory : swapchain.gl.memory) {
-                    sessionState.gl.dispatch.glDeleteMemoryObjectsEXT(1, &memory);
+                if (completedInteropFenceValue < frame.evictionInteropFenceValue ||
+                    (copyFence && completedCopyFenceValue < frame.evictionCopyFenceValue)) {
+                    return;
+                }
+
+                const size_t pageablesCapacity = swapchain.pageables.capacity();
+                const auto& pageables = getPageables(swapchain);
+                sessionState.frameArena.grew |= pageables.capacity() != pageablesCapacity;
+                CHECK_HRCMD(sessionState.runtimeDevice->Evict((UINT)pageables.size(), pageables.data()));
+                frame.evicted = true;
+                frame.evictionPending = false;
+                sessionState.evictionCount++;
+                sessionState.evictedBytes += swapchain.memory.bounceBytes;
+
+                TraceLoggingWrite(g_traceProvider,
+                                  "ManageResidency_Evict",
+                                  TLXArg(handle, "Swapchain"),
+                                  TLArg(currentFrame - frame.lastUsedFrame, "IdleFrames"),
+                                  TLArg(swapchain.memory.bounceBytes, "RuntimeDeviceBytes"));
+            });
+        }
+
+        // The storage used for submitting copies, whose growth is accounted for in the frame arena. Must be called
+        // with copyMutex held.
+        static size_t getCopyStorageCapacity(const Session& sessionState) {
+            return sessionState.copyBarriers.capacity() + sessionState.copyCommandLists.getDepth() +
+                   sessionState.transitionCommandLists.getDepth();
+        }
+
+        // Must be called with the swapchain lock held.
+        static const std::vector<ID3D12Pageable*>& getPageables(Swapchain& swapchain) {
+            if (swapchain.pageables.empty()) {
+                for (const auto& image : swapchain.shareableImages) {
+                    swapchain.pageables.push_back(image.Get());
                 }
             }
+            return swapchain.pageables;
         }
 
-        bool isSystemHandled(XrSystemId systemId) const {
-            return systemId == m_systemId;
+        // Must be called with the swapchain lock held.
+        void makeSwapchainResident(Session& sessionState, Swapchain& swapchain) {
+            const auto& pageables = getPageables(swapchain);
+            CHECK_HRCMD(sessionState.runtimeDevice->MakeResident((UINT)pageables.size(), pageables.data()));
+            swapchain.frame.evicted = false;
+            sessionState.makeResidentCount++;
+
+            TraceLoggingWrite(g_traceProvider, "MakeSwapchainResident", TLXArg(swapchain.xrSwapchain, "Swapchain"));
         }
 
-        bool isSessionHandled(XrSession session) const {
-            return m_sessions.find(session) != m_sessions.cend();
+        void loadSettings() {
+            const auto getSetting = [](const char* name, auto& setting) {
+                const auto value = util::RegGetDword(HKEY_LOCAL_MACHINE, util::RegPrefix, name);
+                if (value) {
+                    setting = static_cast<std::remove_reference_t<decltype(setting)>>(*value);
+                    Log("Using %s=%u\n", name, *value);
+                }
+            };
+
+            getSetting("signal_on_release", m_signalOnRelease);
+            getSetting("use_copy_queue", m_useCopyQueue);
+            getSetting("copy_on_release", m_copyOnRelease);
+            getSetting("virtual_swapchain_images", m_virtualSwapchainImages);
+            getSetting("swapchain_cache_mb", m_swapchainCacheMaxBytes);
+            m_swapchainCacheMaxBytes *= 1024 * 1024;
+            getSetting("evict_idle_swapchains", m_evictIdleSwapchains);
+            getSetting("measure_call_overhead", m_measureCallOverhead);
+            getSetting("capture_calls", m_captureCalls);
+            getSetting("measure_lock_contention", m_measureLockContention);
+            getSetting("frame_profiler_period", m_frameProfilerPeriod);
+
+            // Copying upon release requires to know when the work for the released image is completed.
+            m_signalOnRelease = m_signalOnRelease || m_copyOnRelease;
         }
 
-        bool isSwapchainHandled(XrSwapchain swapchain) const {
-            return m_swapchains.find(swapchain) != m_swapchains.cend();
+        bool isSystemHandled(XrSystemId systemId) const {
+            return systemId == m_systemId;
         }
 
         XrSystemId m_systemId{XR_NULL_SYSTEM_ID};
         bool m_graphicsRequirementQueried{false};
         XrGraphicsRequirementsD3D12KHR m_d3d12Requirements;
 
-        std::map<XrSession, Session> m_sessions;
-        std::map<XrSwapchain, Swapchain> m_swapchains;
-
-        // We can afford to use a giant lock given that all our overlay functions are typically in control path
-        // (with the exception of xrEndFrame()).
-        std::mutex m_globalLock;
+        // Our state is looked up on every frame, and pointers to it are kept (eg: from a swapchain to its session).
+        util::HandleRegistry<XrSession, Session> m_sessions;
+        util::HandleRegistry<XrSwapchain, Swapchain> m_swapchains;
+
+        // Advanced settings, read from the registry upon instance creation.
+        bool m_signalOnRelease{false};
+        bool m_useCopyQueue{false};
+        bool m_copyOnRelease{false};
+        uint32_t m_virtualSwapchainImages{0};
+        UINT64 m_swapchainCacheMaxBytes{0};
+        bool m_evictIdleSwapchains{false};
+        bool m_measureCallOverhead{false};
+        bool m_captureCalls{false};
+        bool m_measureLockContention{false};
+        uint32_t m_frameProfilerPeriod{0};
+
+        // How often (in frames) to check the video memory budget, and after how many frames without use the bounce
+        // textures of a swapchain may be evicted.
+        static constexpr uint64_t ResidencyPollFrames = 30;
+        static constexpr uint64_t ResidencyIdleFrames = 90;
+
+        // How long xrEndFrame() waits for a runtime image to copy a virtual image to (see prepareRuntimeImage()).
+        static constexpr XrDuration RuntimeImageWaitTimeout = 100'000'000;
+
+        // Protects the instance-level state (system, graphics requirements, XR_KHR_vulkan_enable2 emulation).
+        std::mutex m_instanceLock;
+
+        // D3D12 devices released by previous sessions, to be reused by the next ones. Sessions are commonly
+        // restarted, and creating the device is costly. Protected by m_runtimeContextsLock, which is a leaf lock.
+        struct RuntimeContext {
+            LUID adapterLuid;
+            ComPtr<ID3D12Device> device;
+            ComPtr<ID3D12CommandQueue> queue;
+            ComPtr<ID3D12CommandQueue> copyQueue;
+            ComPtr<ID3D12Fence> fence;
+            UINT64 fenceValue;
+        };
+        static constexpr size_t MaxRuntimeContexts = 2;
+        std::vector<RuntimeContext> m_runtimeContexts;
+        std::mutex m_runtimeContextsLock;
+
+        // The indices of the Vulkan physical device and DXGI adapter that last matched the runtime's adapter LUID.
+        // They are only hints, and are verified against the LUID before being used. Protected by m_adapterIndexLock,
+        // which is a leaf lock.
+        std::optional<uint32_t> m_vkPhysicalDeviceIndex;
+        std::optional<UINT> m_dxgiAdapterIndex;
+        std::mutex m_adapterIndexLock;
+
+        // The runtime formats whose swapchain images were found not to be shareable, requiring a bounce copy. Their
+        // translation is listed last by xrEnumerateSwapchainFormats(). Protected by m_bounceFormatsLock, which is a
+        // leaf lock.
+        std::unordered_set<DXGI_FORMAT> m_bounceFormats;
+        uint64_t m_bounceFormatsGeneration{0};
+        std::mutex m_bounceFormatsLock;
+
+        // The capture of the calls made by the application (see m_captureCalls).
+        capture::CaptureWriter m_capture;
+
+        // Protects the content of the registries. Lookups take a shared lock, which must be held for as long as the
+        // state is being used, except across the blocking calls to the runtime, after which the session or swapchain
+        // state is looked up again by its epoch. Insertions and removals take an exclusive lock. The state itself is
+        // protected by the session and swapchain locks. Lock order is: registry -> session -> swapchain.
+        util::InstrumentedMutex<std::shared_mutex> m_registryLock;
+        util::LockStatistics m_registryLockStatistics;
+        uint64_t m_sessionEpoch{0};
+        uint64_t m_swapchainEpoch{0};
 
         // State for XR_KHR_vulkan_enable2 emulation.
         VkInstance m_vkBootstrapInstance{VK_NULL_HANDLE};
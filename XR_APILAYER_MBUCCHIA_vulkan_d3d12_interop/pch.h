@@ -23,8 +23,12 @@
 #pragma once
 
 // Standard library.
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdarg>
 #include <ctime>
 #include <deque>
@@ -34,9 +38,12 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <memory>
 #include <map>
+#include <numeric>
 #include <optional>
+#include <shared_mutex>
 #include <unordered_set>
 #include <vector>
 #include <mutex>
@@ -56,7 +63,7 @@ using Microsoft::WRL::ComPtr;
 
 // Graphics APIs.
 #include <d3d12.h>
-#include <dxgi.h>
+#include <dxgi1_4.h>
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
 #include <GL/GL.h>
@@ -0,0 +1,182 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// The lookup of the sessions and swapchains. Only the standard library is used here, since tests/lock_stress.cpp
+// builds it outside of Windows.
+
+namespace vulkan_d3d12_interop::util {
+
+    // A registry for resolving OpenXR handles to the layer's state objects. This is an open-addressing hash table
+    // (linear probing) that owns its entries through unique pointers, so that the pointers handed out remain stable
+    // for the lifetime of the entry, regardless of insertions and deletions of other entries. Handle{} is the null
+    // handle.
+    template <typename Handle, typename T>
+    class HandleRegistry {
+      public:
+        HandleRegistry() = default;
+        HandleRegistry(const HandleRegistry&) = delete;
+        HandleRegistry& operator=(const HandleRegistry&) = delete;
+
+        T* find(Handle handle) const {
+            if (m_slots.empty() || handle == Handle{}) {
+                return nullptr;
+            }
+
+            for (size_t i = bucketOf(handle);; i = (i + 1) & (m_slots.size() - 1)) {
+                const Slot& slot = m_slots[i];
+                if (!slot.entry) {
+                    return nullptr;
+                }
+                if (slot.handle == handle) {
+                    return slot.entry.get();
+                }
+            }
+        }
+
+        // Insert or replace the entry for a handle. Returns the stable pointer to the entry.
+        T* insert(Handle handle, std::unique_ptr<T> entry) {
+            if ((m_count + 1) * 4 > m_slots.size() * 3) {
+                rehash(std::max(m_slots.size() * 2, k_initialCapacity));
+            }
+
+            for (size_t i = bucketOf(handle);; i = (i + 1) & (m_slots.size() - 1)) {
+                Slot& slot = m_slots[i];
+                if (!slot.entry) {
+                    slot.handle = handle;
+                    slot.entry = std::move(entry);
+                    m_count++;
+                    return slot.entry.get();
+                }
+                if (slot.handle == handle) {
+                    slot.entry = std::move(entry);
+                    return slot.entry.get();
+                }
+            }
+        }
+
+        // Remove the entry for a handle and give back ownership to the caller.
+        std::unique_ptr<T> erase(Handle handle) {
+            if (m_slots.empty()) {
+                return {};
+            }
+
+            const size_t mask = m_slots.size() - 1;
+            size_t i = bucketOf(handle);
+            while (m_slots[i].entry && m_slots[i].handle != handle) {
+                i = (i + 1) & mask;
+            }
+            if (!m_slots[i].entry) {
+                return {};
+            }
+
+            std::unique_ptr<T> removed = std::move(m_slots[i].entry);
+            m_slots[i].handle = Handle{};
+            m_count--;
+
+            // Backward-shift deletion: move up any entry in the probe sequence that would otherwise become
+            // unreachable.
+            for (size_t j = (i + 1) & mask; m_slots[j].entry; j = (j + 1) & mask) {
+                const size_t home = bucketOf(m_slots[j].handle);
+                if (((j - home) & mask) >= ((j - i) & mask)) {
+                    m_slots[i] = std::move(m_slots[j]);
+                    m_slots[j].handle = Handle{};
+                    i = j;
+                }
+            }
+
+            return removed;
+        }
+
+        // Invoke a function for each entry. The function must not insert nor erase entries.
+        template <typename F>
+        void forEach(F&& function) const {
+            for (const Slot& slot : m_slots) {
+                if (slot.entry) {
+                    function(slot.handle, *slot.entry);
+                }
+            }
+        }
+
+        // Collect the handles of all entries matching a predicate.
+        template <typename F>
+        std::vector<Handle> collect(F&& predicate) const {
+            std::vector<Handle> handles;
+            forEach([&](Handle handle, const T& entry) {
+                if (predicate(entry)) {
+                    handles.push_back(handle);
+                }
+            });
+            return handles;
+        }
+
+        size_t size() const {
+            return m_count;
+        }
+
+        bool empty() const {
+            return m_count == 0;
+        }
+
+      private:
+        struct Slot {
+            Handle handle{};
+            std::unique_ptr<T> entry;
+        };
+
+        static constexpr size_t k_initialCapacity = 16;
+
+        size_t bucketOf(Handle handle) const {
+            uint64_t key;
+            if constexpr (std::is_pointer_v<Handle>) {
+                key = (uint64_t)reinterpret_cast<uintptr_t>(handle);
+            } else {
+                key = (uint64_t)handle;
+            }
+
+            // Fibonacci hashing (handles are often aligned pointers with poor low-bits entropy).
+            return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (m_slots.size() - 1);
+        }
+
+        void rehash(size_t capacity) {
+            std::vector<Slot> oldSlots = std::move(m_slots);
+            m_slots = std::vector<Slot>(capacity);
+            m_count = 0;
+            for (Slot& slot : oldSlots) {
+                if (slot.entry) {
+                    insert(slot.handle, std::move(slot.entry));
+                }
+            }
+        }
+
+        std::vector<Slot> m_slots;
+        size_t m_count{0};
+    };
+
+} // namespace vulkan_d3d12_interop::util
@@ -0,0 +1,162 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <utility>
+
+#include "latency.h"
+
+// The mutex wrapper behind the measure_lock_contention setting. See tests/lock_stress.cpp for how it behaves under
+// contention.
+
+namespace vulkan_d3d12_interop::util {
+
+    // How long the threads waited for a lock and held it, and how often it was already taken.
+    struct LockStatistics {
+        LatencyHistogram wait;
+        LatencyHistogram hold;
+        LatencyHistogram sharedHold;
+        std::atomic<uint64_t> contendedCount{0};
+    };
+
+    namespace detail {
+
+        // The shared ownerships of instrumented mutexes held by the calling thread, with their acquisition time. A
+        // thread only holds a few of them at once, and the ones beyond the capacity are not timed.
+        struct SharedOwnerships {
+            static constexpr size_t Capacity = 8;
+            std::pair<const void*, std::chrono::steady_clock::time_point> entries[Capacity];
+            size_t count{0};
+        };
+        inline thread_local SharedOwnerships t_sharedOwnerships;
+
+    } // namespace detail
+
+    // A mutex measuring the time spent waiting for it and holding it, once statistics are attached. The statistics
+    // must be attached before the mutex is used by more than one thread. The hold time of shared ownership is kept by
+    // the owning thread (see detail::SharedOwnerships).
+    template <typename Mutex>
+    class InstrumentedMutex {
+      public:
+        using Clock = std::chrono::steady_clock;
+
+        void setStatistics(LockStatistics* statistics) {
+            m_statistics = statistics;
+        }
+
+        void lock() {
+            if (!m_statistics) {
+                m_mutex.lock();
+                return;
+            }
+            const auto start = Clock::now();
+            if (!m_mutex.try_lock()) {
+                m_statistics->contendedCount.fetch_add(1, std::memory_order_relaxed);
+                m_mutex.lock();
+            }
+            m_acquiredTime = Clock::now();
+            m_statistics->wait.record(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(m_acquiredTime - start).count());
+        }
+
+        bool try_lock() {
+            if (!m_mutex.try_lock()) {
+                return false;
+            }
+            if (m_statistics) {
+                m_acquiredTime = Clock::now();
+            }
+            return true;
+        }
+
+        void unlock() {
+            if (m_statistics) {
+                m_statistics->hold.record(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_acquiredTime).count());
+            }
+            m_mutex.unlock();
+        }
+
+        void lock_shared() {
+            if (!m_statistics) {
+                m_mutex.lock_shared();
+                return;
+            }
+            const auto start = Clock::now();
+            if (!m_mutex.try_lock_shared()) {
+                m_statistics->contendedCount.fetch_add(1, std::memory_order_relaxed);
+                m_mutex.lock_shared();
+            }
+            const auto acquiredTime = Clock::now();
+            m_statistics->wait.record(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(acquiredTime - start).count());
+            pushSharedOwnership(acquiredTime);
+        }
+
+        bool try_lock_shared() {
+            if (!m_mutex.try_lock_shared()) {
+                return false;
+            }
+            if (m_statistics) {
+                pushSharedOwnership(Clock::now());
+            }
+            return true;
+        }
+
+        void unlock_shared() {
+            if (m_statistics) {
+                // Search from the most recent ownership, since locks are usually released in reverse order.
+                auto& ownerships = detail::t_sharedOwnerships;
+                for (size_t i = ownerships.count; i > 0; i--) {
+                    auto& entry = ownerships.entries[i - 1];
+                    if (entry.first == this) {
+                        m_statistics->sharedHold.record(
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - entry.second).count());
+                        std::move(&entry + 1, ownerships.entries + ownerships.count, &entry);
+                        ownerships.count--;
+                        break;
+                    }
+                }
+            }
+            m_mutex.unlock_shared();
+        }
+
+      private:
+        void pushSharedOwnership(Clock::time_point acquiredTime) {
+            auto& ownerships = detail::t_sharedOwnerships;
+            if (ownerships.count < detail::SharedOwnerships::Capacity) {
+                ownerships.entries[ownerships.count++] = {this, acquiredTime};
+            }
+        }
+
+        Mutex m_mutex;
+        LockStatistics* m_statistics{nullptr};
+
+        // Only accessed by the thread owning the mutex exclusively.
+        Clock::time_point m_acquiredTime;
+    };
+
+} // namespace vulkan_d3d12_interop::util
@@ -24,6 +24,12 @@
 
 #include "pch.h"
 
+#include "formats.h"
+#include "latency.h"
+#include "registry.h"
+#include "sync.h"
+#include "log.h"
+
 #define CHECK_VKCMD(cmd) xr::detail::_CheckVKResult(cmd, #cmd, FILE_AND_LINE)
 
 namespace xr::detail {
@@ -48,146 +54,158 @@ namespace xr::detail {
 
 namespace vulkan_d3d12_interop::util {
 
-    struct VkFormatMapping {
-        DXGI_FORMAT dxgi;
-        VkFormat vk;
-    };
+    // The registry key holding the advanced settings of the layer.
+    const std::string RegPrefix = "SOFTWARE\\OpenXR-Vk-D3D12";
 
-    struct GlFormatMapping {
-        DXGI_FORMAT dxgi;
-        GLint gl;
-        size_t size;
-    };
+    // Read a DWORD value from the registry.
+    inline std::optional<DWORD> RegGetDword(HKEY hKey, const std::string& subKey, const std::string& value) {
+        DWORD data;
+        DWORD dataSize = sizeof(data);
+        const LONG retCode =
+            ::RegGetValueA(hKey, subKey.c_str(), value.c_str(), RRF_RT_REG_DWORD, nullptr, &data, &dataSize);
+        if (retCode != ERROR_SUCCESS) {
+            return {};
+        }
+        return data;
+    }
 
-    // Based on https://github.com/doitsujin/dxvk/blob/master/src/dxgi/dxgi_format.cpp
-    const VkFormatMapping DxgiToVkFormat[] = {
-        {DXGI_FORMAT_R32G32B32A32_FLOAT, VK_FORMAT_R32G32B32A32_SFLOAT},
-        {DXGI_FORMAT_R32G32B32A32_UINT, VK_FORMAT_R32G32B32A32_UINT},
-        {DXGI_FORMAT_R32G32B32A32_SINT, VK_FORMAT_R32G32B32A32_SINT},
-        {DXGI_FORMAT_R32G32B32_FLOAT, VK_FORMAT_R32G32B32_SFLOAT},
-        {DXGI_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32_UINT},
-        {DXGI_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32_SINT},
-        {DXGI_FORMAT_R16G16B16A16_FLOAT, VK_FORMAT_R16G16B16A16_SFLOAT},
-        {DXGI_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R16G16B16A16_UNORM},
-        {DXGI_FORMAT_R16G16B16A16_UINT, VK_FORMAT_R16G16B16A16_UINT},
-        {DXGI_FORMAT_R16G16B16A16_SNORM, VK_FORMAT_R16G16B16A16_SNORM},
-        {DXGI_FORMAT_R16G16B16A16_SINT, VK_FORMAT_R16G16B16A16_SINT},
-        {DXGI_FORMAT_R32G32_FLOAT, VK_FORMAT_R32G32_SFLOAT},
-        {DXGI_FORMAT_R32G32_UINT, VK_FORMAT_R32G32_UINT},
-        {DXGI_FORMAT_R32G32_SINT, VK_FORMAT_R32G32_SINT},
-        {DXGI_FORMAT_D32_FLOAT_S8X24_UINT, VK_FORMAT_D32_SFLOAT_S8_UINT},
-        {DXGI_FORMAT_R10G10B10A2_UNORM, VK_FORMAT_A2B10G10R10_UNORM_PACK32},
-        {DXGI_FORMAT_R10G10B10A2_UINT, VK_FORMAT_A2B10G10R10_UINT_PACK32},
-        {DXGI_FORMAT_R11G11B10_FLOAT, VK_FORMAT_B10G11R11_UFLOAT_PACK32},
-        {DXGI_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM},
-        {DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, VK_FORMAT_R8G8B8A8_SRGB},
-        {DXGI_FORMAT_R8G8B8A8_UINT, VK_FORMAT_R8G8B8A8_UINT},
-        {DXGI_FORMAT_R8G8B8A8_SNORM, VK_FORMAT_R8G8B8A8_SNORM},
-        {DXGI_FORMAT_R8G8B8A8_SINT, VK_FORMAT_R8G8B8A8_SINT},
-        {DXGI_FORMAT_R16G16_FLOAT, VK_FORMAT_R16G16_SFLOAT},
-        {DXGI_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16_UNORM},
-        {DXGI_FORMAT_R16G16_UINT, VK_FORMAT_R16G16_UINT},
-        {DXGI_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16_SNORM},
-        {DXGI_FORMAT_R16G16_SINT, VK_FORMAT_R16G16_SINT},
-        {DXGI_FORMAT_D32_FLOAT, VK_FORMAT_D32_SFLOAT},
-        {DXGI_FORMAT_R32_FLOAT, VK_FORMAT_R32_SFLOAT},
-        {DXGI_FORMAT_R32_UINT, VK_FORMAT_R32_UINT},
-        {DXGI_FORMAT_R32_SINT, VK_FORMAT_R32_SINT},
-        {DXGI_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
-        {DXGI_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8_UNORM},
-        {DXGI_FORMAT_R8G8_UINT, VK_FORMAT_R8G8_UINT},
-        {DXGI_FORMAT_R8G8_SNORM, VK_FORMAT_R8G8_SNORM},
-        {DXGI_FORMAT_R8G8_SINT, VK_FORMAT_R8G8_SINT},
-        {DXGI_FORMAT_R16_FLOAT, VK_FORMAT_R16_SFLOAT},
-        {DXGI_FORMAT_D16_UNORM, VK_FORMAT_D16_UNORM},
-        {DXGI_FORMAT_R16_UNORM, VK_FORMAT_R16_UNORM},
-        {DXGI_FORMAT_R16_UINT, VK_FORMAT_R16_UINT},
-        {DXGI_FORMAT_R16_SNORM, VK_FORMAT_R16_SNORM},
-        {DXGI_FORMAT_R16_SINT, VK_FORMAT_R16_SINT},
-        {DXGI_FORMAT_R8_UNORM, VK_FORMAT_R8_UNORM},
-        {DXGI_FORMAT_R8_UINT, VK_FORMAT_R8_UINT},
-        {DXGI_FORMAT_R8_SNORM, VK_FORMAT_R8_SNORM},
-        {DXGI_FORMAT_R8_SINT, VK_FORMAT_R8_SINT},
-        {DXGI_FORMAT_A8_UNORM, VK_FORMAT_R8_UNORM},
-        {DXGI_FORMAT_R9G9B9E5_SHAREDEXP, VK_FORMAT_E5B9G9R9_UFLOAT_PACK32},
-        {DXGI_FORMAT_R8G8_B8G8_UNORM, VK_FORMAT_B8G8R8G8_422_UNORM},
-        {DXGI_FORMAT_G8R8_G8B8_UNORM, VK_FORMAT_G8B8G8R8_422_UNORM},
-        {DXGI_FORMAT_BC1_UNORM, VK_FORMAT_BC1_RGBA_UNORM_BLOCK},
-        {DXGI_FORMAT_BC1_UNORM_SRGB, VK_FORMAT_BC1_RGBA_SRGB_BLOCK},
-        {DXGI_FORMAT_BC2_UNORM, VK_FORMAT_BC2_UNORM_BLOCK},
-        {DXGI_FORMAT_BC2_UNORM_SRGB, VK_FORMAT_BC2_SRGB_BLOCK},
-        {DXGI_FORMAT_BC3_UNORM, VK_FORMAT_BC3_UNORM_BLOCK},
-        {DXGI_FORMAT_BC3_UNORM_SRGB, VK_FORMAT_BC3_SRGB_BLOCK},
-        {DXGI_FORMAT_BC4_UNORM, VK_FORMAT_BC4_UNORM_BLOCK},
-        {DXGI_FORMAT_BC4_SNORM, VK_FORMAT_BC4_SNORM_BLOCK},
-        {DXGI_FORMAT_BC5_UNORM, VK_FORMAT_BC5_UNORM_BLOCK},
-        {DXGI_FORMAT_BC5_SNORM, VK_FORMAT_BC5_SNORM_BLOCK},
-        {DXGI_FORMAT_B5G6R5_UNORM, VK_FORMAT_R5G6B5_UNORM_PACK16},
-        {DXGI_FORMAT_B5G5R5A1_UNORM, VK_FORMAT_A1R5G5B5_UNORM_PACK16},
-        {DXGI_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_B8G8R8A8_UNORM},
-        {DXGI_FORMAT_B8G8R8X8_UNORM, VK_FORMAT_B8G8R8A8_UNORM},
-        {DXGI_FORMAT_B8G8R8A8_UNORM_SRGB, VK_FORMAT_B8G8R8A8_SRGB},
-        {DXGI_FORMAT_B8G8R8X8_UNORM_SRGB, VK_FORMAT_B8G8R8A8_SRGB},
-        {DXGI_FORMAT_BC6H_UF16, VK_FORMAT_BC6H_UFLOAT_BLOCK},
-        {DXGI_FORMAT_BC6H_SF16, VK_FORMAT_BC6H_SFLOAT_BLOCK},
-        {DXGI_FORMAT_BC7_UNORM, VK_FORMAT_BC7_UNORM_BLOCK},
-        {DXGI_FORMAT_BC7_UNORM_SRGB, VK_FORMAT_BC7_SRGB_BLOCK},
-        {DXGI_FORMAT_AYUV, VK_FORMAT_R8G8B8A8_UNORM},
-        {DXGI_FORMAT_Y410, VK_FORMAT_G8_B8R8_2PLANE_420_UNORM},
-        {DXGI_FORMAT_420_OPAQUE, VK_FORMAT_G8_B8R8_2PLANE_420_UNORM},
-        {DXGI_FORMAT_YUY2, VK_FORMAT_G8B8G8R8_422_UNORM},
-        {DXGI_FORMAT_B4G4R4A4_UNORM, VK_FORMAT_A4R4G4B4_UNORM_PACK16_EXT},
-    };
+    // A pool of D3D12 command allocators and command lists. Each submission is tagged with a value of a fence
+    // private to the pool, and the allocators are only recycled once the GPU has completed the corresponding value.
+    // The pool grows on demand, up to a maximum depth, after which the oldest submission must be waited for.
+    class CommandListPool {
+      public:
+        CommandListPool() = default;
+        CommandListPool(const CommandListPool&) = delete;
+        CommandListPool& operator=(const CommandListPool&) = delete;
+
+        ~CommandListPool() {
+            flush();
+        }
+
+        void initialize(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type, size_t maxDepth = 8) {
+            m_device = device;
+            m_type = type;
+            m_maxDepth = maxDepth;
+
+            CHECK_HRCMD(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
+            *m_event.put() = CreateEventEx(nullptr, L"Command List Pool Fence", 0, EVENT_ALL_ACCESS);
+        }
+
+        // Get the command list currently being recorded, or open a new one.
+        ID3D12GraphicsCommandList* getCommandList() {
+            if (!m_current) {
+                m_current = acquireContext();
+            }
+            return m_current->commandList.Get();
+        }
+
+        bool isRecording() const {
+            return m_current != nullptr;
+        }
+
+        // Close and submit the command list currently being recorded. Returns the value of the pool's fence
+        // signaled upon completion.
+        UINT64 submit(ID3D12CommandQueue* queue) {
+            CHECK_HRCMD(m_current->commandList->Close());
+            ID3D12CommandList* const commandLists[] = {m_current->commandList.Get()};
+            queue->ExecuteCommandLists(1, commandLists);
+
+            m_current->fenceValue = ++m_fenceValue;
+            CHECK_HRCMD(queue->Signal(m_fence.Get(), m_fenceValue));
+            m_current = nullptr;
+
+            return m_fenceValue;
+        }
+
+        // Wait for all submissions to complete.
+        void flush() {
+            if (m_fence && m_fence->GetCompletedValue() < m_fenceValue) {
+                CHECK_HRCMD(m_fence->SetEventOnCompletion(m_fenceValue, m_event.get()));
+                WaitForSingleObject(m_event.get(), INFINITE);
+            }
+        }
+
+        ID3D12Fence* getFence() const {
+            return m_fence.Get();
+        }
+
+        // The value of the fence signaled upon completion of the last submission.
+        UINT64 getFenceValue() const {
+            return m_fenceValue;
+        }
+
+        size_t getDepth() const {
+            return m_contexts.size();
+        }
+
+        uint64_t getWaitCount() const {
+            return m_waitCount;
+        }
+
+      private:
+        struct Context {
+            ComPtr<ID3D12CommandAllocator> commandAllocator;
+            ComPtr<ID3D12GraphicsCommandList> commandList;
+            UINT64 fenceValue{0};
+        };
+
+        Context* acquireContext() {
+            // Contexts are recycled in submission order, so the oldest submission is always next.
+            Context* context = nullptr;
+            if (!m_contexts.empty() && m_fence->GetCompletedValue() >= m_contexts[m_next]->fenceValue) {
+                context = m_contexts[m_next].get();
+            } else if (m_contexts.size() < m_maxDepth) {
+                auto newContext = std::make_unique<Context>();
+                CHECK_HRCMD(m_device->CreateCommandAllocator(
+                    m_type, IID_PPV_ARGS(newContext->commandAllocator.ReleaseAndGetAddressOf())));
+                CHECK_HRCMD(m_device->CreateCommandList(0,
+                                                        m_type,
+                                                        newContext->commandAllocator.Get(),
+                                                        nullptr,
+                                                        IID_PPV_ARGS(newContext->commandList.ReleaseAndGetAddressOf())));
+                m_contexts.insert(m_contexts.begin() + m_next, std::move(newContext));
+                context = m_contexts[m_next].get();
+                m_next = (m_next + 1) % m_contexts.size();
+
+                TraceLoggingWrite(log::g_traceProvider,
+                                  "CommandListPool_Grow",
+                                  TLArg((int)m_type, "Type"),
+                                  TLArg(m_contexts.size(), "Depth"));
+
+                // A newly created command list is already open.
+                return context;
+            } else {
+                // The pool is exhausted: we must wait for the GPU to complete the oldest submission.
+                context = m_contexts[m_next].get();
+                m_waitCount++;
+                TraceLoggingWrite(log::g_traceProvider,
+                                  "CommandListPool_Wait",
+                                  TLArg((int)m_type, "Type"),
+                                  TLArg(context->fenceValue, "FenceValue"));
+                CHECK_HRCMD(m_fence->SetEventOnCompletion(context->fenceValue, m_event.get()));
+                WaitForSingleObject(m_event.get(), INFINITE);
+            }
+            m_next = (m_next + 1) % m_contexts.size();
+
+            CHECK_HRCMD(context->commandAllocator->Reset());
+            CHECK_HRCMD(context->commandList->Reset(context->commandAllocator.Get(), nullptr));
+
+            return context;
+        }
+
+        ComPtr<ID3D12Device> m_device;
+        D3D12_COMMAND_LIST_TYPE m_type{D3D12_COMMAND_LIST_TYPE_DIRECT};
+        size_t m_maxDepth{0};
+
+        ComPtr<ID3D12Fence> m_fence;
+        UINT64 m_fenceValue{0};
+        wil::unique_handle m_event;
+
+        std::vector<std::unique_ptr<Context>> m_contexts;
+        size_t m_next{0};
+        Context* m_current{nullptr};
 
-    // Based on
-    // https://chromium.googlesource.com/angle/angle/+/34cc136a689711ee7f64f90b2de9b07cfb9a9f17/src/libANGLE/renderer/d3d/d3d11/formatutils11.cpp
-    const GlFormatMapping DxgiToGlFormat[] = {
-        {DXGI_FORMAT_A8_UNORM, GL_ALPHA8_EXT, 1},
-        {DXGI_FORMAT_R8_UNORM, GL_R8, 1},
-        {DXGI_FORMAT_R8G8_UNORM, GL_RG8, 2},
-        {DXGI_FORMAT_R8G8B8A8_UNORM, GL_RGBA8, 4},
-        {DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, GL_SRGB8_ALPHA8, 4},
-        {DXGI_FORMAT_R8_SNORM, GL_R8_SNORM, 1},
-        {DXGI_FORMAT_R8G8_SNORM, GL_RG8_SNORM, 2},
-        {DXGI_FORMAT_R8G8B8A8_SNORM, GL_RGBA8_SNORM, 4},
-        {DXGI_FORMAT_R8_UINT, GL_R8UI, 1},
-        {DXGI_FORMAT_R16_UINT, GL_R16UI, 2},
-        {DXGI_FORMAT_R32_UINT, GL_R32UI, 4},
-        {DXGI_FORMAT_R8G8_UINT, GL_RG8UI, 2},
-        {DXGI_FORMAT_R16G16_UINT, GL_RG16UI, 4},
-        {DXGI_FORMAT_R32G32_UINT, GL_RG32UI, 8},
-        {DXGI_FORMAT_R32G32B32_UINT, GL_RGB32UI, 12},
-        {DXGI_FORMAT_R8G8B8A8_UINT, GL_RGBA8UI, 4},
-        {DXGI_FORMAT_R16G16B16A16_UINT, GL_RGBA16UI, 8},
-        {DXGI_FORMAT_R32G32B32A32_UINT, GL_RGBA32UI, 16},
-        {DXGI_FORMAT_R8_SINT, GL_R8I, 1},
-        {DXGI_FORMAT_R16_SINT, GL_R16I, 2},
-        {DXGI_FORMAT_R32_SINT, GL_R32I, 4},
-        {DXGI_FORMAT_R8G8_SINT, GL_RG8I, 2},
-        {DXGI_FORMAT_R16G16_SINT, GL_RG16I, 4},
-        {DXGI_FORMAT_R32G32_SINT, GL_RG32I, 8},
-        {DXGI_FORMAT_R32G32B32_SINT, GL_RGB32I, 12},
-        {DXGI_FORMAT_R8G8B8A8_SINT, GL_RGBA8I, 4},
-        {DXGI_FORMAT_R16G16B16A16_SINT, GL_RGBA16I, 8},
-        {DXGI_FORMAT_R32G32B32A32_SINT, GL_RGBA32I, 16},
-        {DXGI_FORMAT_R10G10B10A2_UNORM, GL_RGB10_A2, 4},
-        {DXGI_FORMAT_R10G10B10A2_UINT, GL_RGB10_A2UI, 4},
-        {DXGI_FORMAT_R16_FLOAT, GL_R16F, 2},
-        {DXGI_FORMAT_R16G16_FLOAT, GL_RG16F, 4},
-        {DXGI_FORMAT_R16G16B16A16_FLOAT, GL_RGBA16F, 8},
-        {DXGI_FORMAT_R32_FLOAT, GL_R32F, 4},
-        {DXGI_FORMAT_R32G32_FLOAT, GL_RG32F, 8},
-        {DXGI_FORMAT_R32G32B32_FLOAT, GL_RGB32F, 12},
-        {DXGI_FORMAT_R32G32B32A32_FLOAT, GL_RGBA32F, 16},
-        {DXGI_FORMAT_R9G9B9E5_SHAREDEXP, GL_RGB9_E5, 4},
-        {DXGI_FORMAT_R11G11B10_FLOAT, GL_R11F_G11F_B10F, 4},
-        {DXGI_FORMAT_R16_TYPELESS, GL_DEPTH_COMPONENT16, 2},
-        {DXGI_FORMAT_R16_UNORM, GL_DEPTH_COMPONENT16, 2},
-        {DXGI_FORMAT_D16_UNORM, GL_DEPTH_COMPONENT16, 2},
-        {DXGI_FORMAT_D24_UNORM_S8_UINT, GL_DEPTH24_STENCIL8, 4},
-        {DXGI_FORMAT_D32_FLOAT_S8X24_UINT, GL_DEPTH32F_STENCIL8, 8},
-        {DXGI_FORMAT_D32_FLOAT, GL_DEPTH_COMPONENT32F, 4},
-        {DXGI_FORMAT_BC1_UNORM, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 4},
+        uint64_t m_waitCount{0};
     };
 
-} // namespace vulkan_d3d12_interop::util
\ No newline at end of file
+} // namespace vulkan_d3d12_interop::util
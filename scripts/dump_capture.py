@@ -0,0 +1,127 @@
+# MIT License
+#
+# Copyright(c) 2022 Matthieu Bucchianeri
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this softwareand associated documentation files(the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions :
+#
+# The above copyright noticeand this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Print the records of a capture file written with the capture_calls setting, one line per record.
+# The format is described in XR_APILAYER_MBUCCHIA_vulkan_d3d12_interop/capture_format.h.
+#
+# Usage: python dump_capture.py <file.capture>
+
+import struct
+import sys
+
+MAGIC = b'XRVKCAPT'
+VERSION = 1
+
+FILE_HEADER = struct.Struct('<8sII')
+RECORD_HEADER = struct.Struct('<IIQQiI')
+SESSION_RECORD = struct.Struct('<QII')
+CREATE_SWAPCHAIN_RECORD = struct.Struct('<QQqQQIIIIII')
+SWAPCHAIN_RECORD = struct.Struct('<Qq')
+END_FRAME_RECORD = struct.Struct('<QqII')
+LAYER_RECORD = struct.Struct('<IIQII')
+SUB_IMAGE_RECORD = struct.Struct('<QiiiiII')
+
+RECORD_TYPES = {
+    1: 'CreateSession',
+    2: 'DestroySession',
+    3: 'CreateSwapchain',
+    4: 'DestroySwapchain',
+    5: 'AcquireSwapchainImage',
+    6: 'WaitSwapchainImage',
+    7: 'ReleaseSwapchainImage',
+    8: 'EndFrame',
+}
+
+APIS = {0: 'Passthrough', 1: 'Vulkan', 2: 'OpenGL'}
+
+def format_payload(record_type, payload):
+    if record_type in ('CreateSession', 'DestroySession'):
+        session, api, _ = SESSION_RECORD.unpack_from(payload)
+        return f'session=0x{session:x} api={APIS.get(api, api)}'
+
+    if record_type == 'CreateSwapchain':
+        (session, swapchain, swapchain_format, usage, create, samples, width, height, faces, array_size,
+         mips) = CREATE_SWAPCHAIN_RECORD.unpack_from(payload)
+        return (f'session=0x{session:x} swapchain=0x{swapchain:x} format={swapchain_format} usage=0x{usage:x} '
+                f'create=0x{create:x} {width}x{height} samples={samples} faces={faces} array={array_size} '
+                f'mips={mips}')
+
+    if record_type in ('DestroySwapchain', 'AcquireSwapchainImage', 'WaitSwapchainImage', 'ReleaseSwapchainImage'):
+        swapchain, value = SWAPCHAIN_RECORD.unpack_from(payload)
+        line = f'swapchain=0x{swapchain:x}'
+        if record_type == 'AcquireSwapchainImage':
+            line += f' index={value}'
+        elif record_type == 'WaitSwapchainImage':
+            line += f' timeout={value}'
+        return line
+
+    if record_type == 'EndFrame':
+        session, display_time, blend_mode, layer_count = END_FRAME_RECORD.unpack_from(payload)
+        lines = [f'session=0x{session:x} displayTime={display_time} blendMode={blend_mode} layers={layer_count}']
+        offset = END_FRAME_RECORD.size
+        for i in range(layer_count):
+            layer_type, flags, space, sub_image_count, _ = LAYER_RECORD.unpack_from(payload, offset)
+            offset += LAYER_RECORD.size
+            lines.append(f'  layer {i}: type={layer_type} flags=0x{flags:x} space=0x{space:x}')
+            for j in range(sub_image_count):
+                swapchain, x, y, width, height, array_index, _ = SUB_IMAGE_RECORD.unpack_from(payload, offset)
+                offset += SUB_IMAGE_RECORD.size
+                lines.append(f'    subImage {j}: swapchain=0x{swapchain:x} rect=({x},{y} {width}x{height}) '
+                             f'arrayIndex={array_index}')
+        return '\n'.join(lines)
+
+    return f'{len(payload)} bytes'
+
+def dump(path):
+    with open(path, 'rb') as file:
+        data = file.read()
+
+    if len(data) < FILE_HEADER.size:
+        sys.exit(f'{path}: file is too short')
+    magic, version, _ = FILE_HEADER.unpack_from(data)
+    if magic != MAGIC:
+        sys.exit(f'{path}: not a capture file')
+    if version != VERSION:
+        sys.exit(f'{path}: unsupported version {version}')
+
+    offset = FILE_HEADER.size
+    count = 0
+    while offset + RECORD_HEADER.size <= len(data):
+        type_id, size, timestamp, duration, result, _ = RECORD_HEADER.unpack_from(data, offset)
+        offset += RECORD_HEADER.size
+        if offset + size > len(data):
+            print(f'Truncated record at offset {offset - RECORD_HEADER.size}')
+            break
+        payload = data[offset:offset + size]
+        offset += size
+
+        record_type = RECORD_TYPES.get(type_id, f'Unknown({type_id})')
+        print(f'{timestamp / 1e6:12.3f} ms {duration / 1e3:10.1f} us {record_type:<22} result={result} '
+              f'{format_payload(record_type, payload)}')
+        count += 1
+
+    print(f'{count} records')
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        sys.exit('Usage: dump_capture.py <file.capture>')
+    dump(sys.argv[1])
@@ -0,0 +1,167 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Writes a synthetic capture file in the format of the capture_calls setting, for the replay test: one Vulkan
+// session rendering a projection layer and a quad layer to two swapchains, at 90 Hz.
+//
+// Usage: capture_fixture <file.capture> [--frames <count>]
+
+#include "capture_format.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace vulkan_d3d12_interop::capture;
+
+namespace {
+
+    // The values of the OpenXR enums, without depending on openxr.h.
+    constexpr int64_t DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29;
+    constexpr uint64_t XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT = 0x00000001;
+    constexpr uint64_t XR_SWAPCHAIN_USAGE_SAMPLED_BIT = 0x00000020;
+    constexpr uint32_t XR_TYPE_COMPOSITION_LAYER_PROJECTION = 35;
+    constexpr uint32_t XR_TYPE_COMPOSITION_LAYER_QUAD = 36;
+    constexpr uint32_t XR_ENVIRONMENT_BLEND_MODE_OPAQUE = 1;
+    constexpr int64_t XR_INFINITE_DURATION = 0x7fffffffffffffffLL;
+
+    constexpr uint64_t FramePeriodNs = 11'111'111;
+
+    class Writer {
+      public:
+        Writer(std::ofstream& file) : m_file(file) {
+            FileHeader header{};
+            std::memcpy(header.magic, Magic, sizeof(Magic));
+            header.version = Version;
+            m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+
+        template <typename T>
+        void append(const T& value) {
+            const char* bytes = reinterpret_cast<const char*>(&value);
+            m_payload.insert(m_payload.end(), bytes, bytes + sizeof(T));
+        }
+
+        // Write a record with the payload appended since the last record. Each call lasts 1us.
+        void write(RecordType type) {
+            RecordHeader header{};
+            header.type = type;
+            header.size = (uint32_t)m_payload.size();
+            header.timestampNs = m_timestampNs;
+            header.durationNs = 1000;
+            m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            m_file.write(m_payload.data(), m_payload.size());
+            m_payload.clear();
+            m_timestampNs += 2000;
+        }
+
+        void setTimestamp(uint64_t timestampNs) {
+            m_timestampNs = timestampNs;
+        }
+
+      private:
+        std::ofstream& m_file;
+        std::vector<char> m_payload;
+        uint64_t m_timestampNs{0};
+    };
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 2 && !(argc == 4 && std::string_view(argv[2]) == "--frames")) {
+        std::cerr << "Usage: capture_fixture <file.capture> [--frames <count>]\n";
+        return 1;
+    }
+    const uint32_t frameCount = argc == 4 ? std::stoul(argv[3]) : 300;
+
+    std::ofstream file(argv[1], std::ios_base::binary | std::ios_base::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Cannot open " << argv[1] << "\n";
+        return 1;
+    }
+    Writer writer(file);
+
+    // The handles are arbitrary, as they would be in a capture.
+    const uint64_t session = 0x1000;
+    const uint64_t swapchains[] = {0x2000, 0x3000};
+    const uint32_t widths[] = {2 * 2064, 1024};
+    const uint32_t heights[] = {2208, 512};
+
+    writer.append(SessionRecord{session, Api::Vulkan, 0});
+    writer.write(RecordType::CreateSession);
+    for (size_t i = 0; i < std::size(swapchains); i++) {
+        CreateSwapchainRecord record{};
+        record.session = session;
+        record.swapchain = swapchains[i];
+        record.format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+        record.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT | XR_SWAPCHAIN_USAGE_SAMPLED_BIT;
+        record.sampleCount = 1;
+        record.width = widths[i];
+        record.height = heights[i];
+        record.faceCount = 1;
+        record.arraySize = 1;
+        record.mipCount = 1;
+        writer.append(record);
+        writer.write(RecordType::CreateSwapchain);
+    }
+
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+        writer.setTimestamp((frame + 1) * FramePeriodNs);
+        for (size_t i = 0; i < std::size(swapchains); i++) {
+            writer.append(SwapchainRecord{swapchains[i], frame % 3});
+            writer.write(RecordType::AcquireSwapchainImage);
+            writer.append(SwapchainRecord{swapchains[i], XR_INFINITE_DURATION});
+            writer.write(RecordType::WaitSwapchainImage);
+            writer.append(SwapchainRecord{swapchains[i], 0});
+            writer.write(RecordType::ReleaseSwapchainImage);
+        }
+
+        // The projection layer renders both views side by side, the quad layer uses the whole swapchain.
+        writer.append(EndFrameRecord{
+            session, (int64_t)(frame + 2) * (int64_t)FramePeriodNs, XR_ENVIRONMENT_BLEND_MODE_OPAQUE, 2});
+        writer.append(LayerRecord{XR_TYPE_COMPOSITION_LAYER_PROJECTION, 0, 0x4000, 2, 0});
+        for (int32_t view = 0; view < 2; view++) {
+            const int32_t width = (int32_t)widths[0] / 2;
+            writer.append(SubImageRecord{swapchains[0], view * width, 0, width, (int32_t)heights[0], 0, 0});
+        }
+        writer.append(LayerRecord{XR_TYPE_COMPOSITION_LAYER_QUAD, 0, 0x4000, 1, 0});
+        writer.append(SubImageRecord{swapchains[1], 0, 0, (int32_t)widths[1], (int32_t)heights[1], 0, 0});
+        writer.write(RecordType::EndFrame);
+    }
+
+    for (const uint64_t swapchain : swapchains) {
+        writer.append(SwapchainRecord{swapchain, 0});
+        writer.write(RecordType::DestroySwapchain);
+    }
+    writer.append(SessionRecord{session, Api::Vulkan, 0});
+    writer.write(RecordType::DestroySession);
+
+    file.close();
+    if (!file) {
+        std::cerr << "Failed to write " << argv[1] << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "chain.h"
+#include "mock_runtime.h"
+
+namespace vulkan_d3d12_interop::test {
+
+    namespace {
+
+        std::vector<Layer>& getRegisteredLayers() {
+            static std::vector<Layer> layers;
+            return layers;
+        }
+
+        template <typename T>
+        void resolve(PFN_xrGetInstanceProcAddr getInstanceProcAddr,
+                     XrInstance instance,
+                     const char* name,
+                     T& function) {
+            CheckXrResult(getInstanceProcAddr(instance, name, reinterpret_cast<PFN_xrVoidFunction*>(&function)),
+                          name,
+                          __FILE__,
+                          __LINE__);
+        }
+
+    } // namespace
+
+    const std::vector<Layer>& GetLayers() {
+        return getRegisteredLayers();
+    }
+
+    LayerRegistration::LayerRegistration(const Layer& layer) {
+        getRegisteredLayers().push_back(layer);
+    }
+
+    Chain::Chain(MockRuntime& runtime, size_t layerCount) {
+        const auto& layers = GetLayers();
+        if (layerCount > layers.size()) {
+            throw std::runtime_error("Only " + std::to_string(layers.size()) + " layers are available");
+        }
+
+        XrInstanceCreateInfo createInfo{XR_TYPE_INSTANCE_CREATE_INFO};
+        std::snprintf(createInfo.applicationInfo.applicationName,
+                      sizeof(createInfo.applicationInfo.applicationName),
+                      "ChainTest");
+        createInfo.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+
+        m_instance = runtime.createInstance();
+        PFN_xrGetInstanceProcAddr getInstanceProcAddr = &MockRuntime::xrGetInstanceProcAddr;
+        for (size_t i = layerCount; i > 0; i--) {
+            const Layer& layer = layers[i - 1];
+            CHECK_XRCMD(layer.createInstance(getInstanceProcAddr, m_instance, &createInfo));
+            getInstanceProcAddr = layer.getInstanceProcAddr;
+        }
+
+        resolve(getInstanceProcAddr, m_instance, "xrDestroyInstance", m_dispatch.xrDestroyInstance);
+        resolve(getInstanceProcAddr, m_instance, "xrGetSystem", m_dispatch.xrGetSystem);
+        resolve(getInstanceProcAddr, m_instance, "xrCreateSession", m_dispatch.xrCreateSession);
+        resolve(getInstanceProcAddr, m_instance, "xrDestroySession", m_dispatch.xrDestroySession);
+        resolve(
+            getInstanceProcAddr, m_instance, "xrEnumerateSwapchainFormats", m_dispatch.xrEnumerateSwapchainFormats);
+        resolve(getInstanceProcAddr, m_instance, "xrCreateSwapchain", m_dispatch.xrCreateSwapchain);
+        resolve(getInstanceProcAddr, m_instance, "xrDestroySwapchain", m_dispatch.xrDestroySwapchain);
+        resolve(getInstanceProcAddr, m_instance, "xrEnumerateSwapchainImages", m_dispatch.xrEnumerateSwapchainImages);
+        resolve(getInstanceProcAddr, m_instance, "xrAcquireSwapchainImage", m_dispatch.xrAcquireSwapchainImage);
+        resolve(getInstanceProcAddr, m_instance, "xrWaitSwapchainImage", m_dispatch.xrWaitSwapchainImage);
+        resolve(getInstanceProcAddr, m_instance, "xrReleaseSwapchainImage", m_dispatch.xrReleaseSwapchainImage);
+        resolve(getInstanceProcAddr, m_instance, "xrEndFrame", m_dispatch.xrEndFrame);
+
+        XrSystemGetInfo getInfo{XR_TYPE_SYSTEM_GET_INFO};
+        getInfo.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+        CHECK_XRCMD(m_dispatch.xrGetSystem(m_instance, &getInfo, &m_systemId));
+    }
+
+    // Destroying the instance through the chain also destroys the layers' singletons.
+    Chain::~Chain() {
+        m_dispatch.xrDestroyInstance(m_instance);
+    }
+
+} // namespace vulkan_d3d12_interop::test
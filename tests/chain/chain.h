@@ -0,0 +1,106 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+#define CHECK_XRCMD(cmd) ::vulkan_d3d12_interop::test::CheckXrResult(cmd, #cmd, __FILE__, __LINE__)
+
+namespace vulkan_d3d12_interop::test {
+
+    class MockRuntime;
+
+    inline XrResult CheckXrResult(XrResult result, const char* originator, const char* file, int line) {
+        if (XR_FAILED(result)) {
+            throw std::runtime_error(std::string(file) + ":" + std::to_string(line) + ": " + originator +
+                                     " failed with " + xr::ToCString(result));
+        }
+        return result;
+    }
+
+    // Does what xrCreateApiLayerInstance() does once the next layer created the instance: initialize the layer's
+    // singleton with the next xrGetInstanceProcAddr().
+    using CreateLayerInstance = XrResult (*)(PFN_xrGetInstanceProcAddr nextGetInstanceProcAddr,
+                                             XrInstance instance,
+                                             const XrInstanceCreateInfo* createInfo);
+
+    // A copy of the framework compiled in its own LAYER_NAMESPACE (see passthrough_layer.cpp).
+    struct Layer {
+        const char* name;
+        CreateLayerInstance createInstance;
+        PFN_xrGetInstanceProcAddr getInstanceProcAddr;
+    };
+
+    // The layers linked into the executable, in no particular order.
+    const std::vector<Layer>& GetLayers();
+
+    struct LayerRegistration {
+        LayerRegistration(const Layer& layer);
+    };
+
+    // The functions of the top of the chain, as seen by the application.
+    struct Dispatch {
+        PFN_xrDestroyInstance xrDestroyInstance{nullptr};
+        PFN_xrGetSystem xrGetSystem{nullptr};
+        PFN_xrCreateSession xrCreateSession{nullptr};
+        PFN_xrDestroySession xrDestroySession{nullptr};
+        PFN_xrEnumerateSwapchainFormats xrEnumerateSwapchainFormats{nullptr};
+        PFN_xrCreateSwapchain xrCreateSwapchain{nullptr};
+        PFN_xrDestroySwapchain xrDestroySwapchain{nullptr};
+        PFN_xrEnumerateSwapchainImages xrEnumerateSwapchainImages{nullptr};
+        PFN_xrAcquireSwapchainImage xrAcquireSwapchainImage{nullptr};
+        PFN_xrWaitSwapchainImage xrWaitSwapchainImage{nullptr};
+        PFN_xrReleaseSwapchainImage xrReleaseSwapchainImage{nullptr};
+        PFN_xrEndFrame xrEndFrame{nullptr};
+    };
+
+    // An instance of the mock runtime with a number of layers on top of it, created bottom-up like the loader does.
+    // With no layers, the application calls the runtime directly. The layers are singletons, so there can only be one
+    // chain at a time.
+    class Chain {
+      public:
+        Chain(MockRuntime& runtime, size_t layerCount);
+        ~Chain();
+
+        Chain(const Chain&) = delete;
+        Chain& operator=(const Chain&) = delete;
+
+        XrInstance getInstance() const {
+            return m_instance;
+        }
+
+        XrSystemId getSystemId() const {
+            return m_systemId;
+        }
+
+        const Dispatch& xr() const {
+            return m_dispatch;
+        }
+
+      private:
+        XrInstance m_instance{XR_NULL_HANDLE};
+        XrSystemId m_systemId{0};
+        Dispatch m_dispatch;
+    };
+
+} // namespace vulkan_d3d12_interop::test
@@ -0,0 +1,452 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "mock_runtime.h"
+
+namespace vulkan_d3d12_interop::test {
+
+    namespace {
+
+        MockRuntime* g_runtime = nullptr;
+
+        // The handles are the addresses of the runtime's objects. The instance has no state.
+        char g_instanceObject;
+        const XrInstance Instance = reinterpret_cast<XrInstance>(&g_instanceObject);
+
+        constexpr uint64_t SessionMagic = 0x5345535349304E31;
+        constexpr uint64_t SwapchainMagic = 0x5357415043484E31;
+
+        // The default formats, a subset of what a D3D12 runtime typically offers (as DXGI_FORMAT values).
+        const std::vector<int64_t> DefaultFormats = {
+            29, // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+            91, // DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+            28, // DXGI_FORMAT_R8G8B8A8_UNORM
+            87, // DXGI_FORMAT_B8G8R8A8_UNORM
+            10, // DXGI_FORMAT_R16G16B16A16_FLOAT
+            24, // DXGI_FORMAT_R10G10B10A2_UNORM
+            40, // DXGI_FORMAT_D32_FLOAT
+            45, // DXGI_FORMAT_D24_UNORM_S8_UINT
+            55, // DXGI_FORMAT_D16_UNORM
+        };
+
+    } // namespace
+
+    struct MockRuntime::Session {
+        uint64_t magic{SessionMagic};
+    };
+
+    // Only the thread using the swapchain accesses its image state, as required by OpenXR.
+    struct MockRuntime::Swapchain {
+        uint64_t magic{SwapchainMagic};
+        Session* session{nullptr};
+
+        // Fake textures: only their addresses are used.
+        std::unique_ptr<uint64_t[]> textures;
+        uint32_t imageCount{0};
+
+        uint32_t nextIndex{0};
+        uint32_t acquiredCount{0};
+        bool waited{false};
+    };
+
+    MockRuntime::MockRuntime() : m_formats(DefaultFormats) {
+        if (g_runtime) {
+            throw std::logic_error("There can only be one MockRuntime");
+        }
+        g_runtime = this;
+    }
+
+    MockRuntime::~MockRuntime() {
+        g_runtime = nullptr;
+    }
+
+    void MockRuntime::setLatency(Call call, std::chrono::nanoseconds latency) {
+        m_latencies[(size_t)call] = latency;
+    }
+
+    void MockRuntime::setImageCount(uint32_t imageCount) {
+        m_imageCount = imageCount;
+    }
+
+    void MockRuntime::setFormats(std::vector<int64_t> formats) {
+        m_formats = std::move(formats);
+    }
+
+    XrInstance MockRuntime::createInstance() {
+        std::unique_lock lock(m_handlesMutex);
+        if (m_hasInstance) {
+            throw std::logic_error("The runtime only supports one instance");
+        }
+        m_hasInstance = true;
+        return Instance;
+    }
+
+    void* MockRuntime::getTexture(XrSwapchain swapchain, uint32_t index) const {
+        const Swapchain* const swapchainState = findSwapchain(swapchain);
+        if (!swapchainState || index >= swapchainState->imageCount) {
+            return nullptr;
+        }
+        return &swapchainState->textures[index];
+    }
+
+    MockRuntime& MockRuntime::get() {
+        return *g_runtime;
+    }
+
+    // Sleeping is too coarse for the latencies of these calls, so we spin.
+    void MockRuntime::spin(Call call) const {
+        const auto latency = m_latencies[(size_t)call];
+        if (latency.count() <= 0) {
+            return;
+        }
+        const auto deadline = std::chrono::steady_clock::now() + latency;
+        while (std::chrono::steady_clock::now() < deadline) {
+        }
+    }
+
+    MockRuntime::Session* MockRuntime::findSession(XrSession session) const {
+        Session* const sessionState = reinterpret_cast<Session*>(session);
+        return sessionState && sessionState->magic == SessionMagic ? sessionState : nullptr;
+    }
+
+    MockRuntime::Swapchain* MockRuntime::findSwapchain(XrSwapchain swapchain) const {
+        Swapchain* const swapchainState = reinterpret_cast<Swapchain*>(swapchain);
+        return swapchainState && swapchainState->magic == SwapchainMagic ? swapchainState : nullptr;
+    }
+
+    XrResult MockRuntime::xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
+#define RESOLVE(entry)                                                                                                 \
+    if (std::string_view(name) == #entry) {                                                                            \
+        *function = reinterpret_cast<PFN_xrVoidFunction>(&MockRuntime::entry);                                         \
+        return XR_SUCCESS;                                                                                             \
+    }
+        RESOLVE(xrDestroyInstance);
+        RESOLVE(xrGetInstanceProperties);
+        RESOLVE(xrGetSystem);
+        RESOLVE(xrGetSystemProperties);
+        RESOLVE(xrGetViewConfigurationProperties);
+        RESOLVE(xrCreateSession);
+        RESOLVE(xrDestroySession);
+        RESOLVE(xrEnumerateSwapchainFormats);
+        RESOLVE(xrCreateSwapchain);
+        RESOLVE(xrDestroySwapchain);
+        RESOLVE(xrEnumerateSwapchainImages);
+        RESOLVE(xrAcquireSwapchainImage);
+        RESOLVE(xrWaitSwapchainImage);
+        RESOLVE(xrReleaseSwapchainImage);
+        RESOLVE(xrEndFrame);
+#undef RESOLVE
+
+        *function = nullptr;
+        return XR_ERROR_FUNCTION_UNSUPPORTED;
+    }
+
+    XrResult MockRuntime::xrDestroyInstance(XrInstance instance) {
+        MockRuntime& runtime = get();
+        std::unique_lock lock(runtime.m_handlesMutex);
+        if (instance != Instance || !runtime.m_hasInstance) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        runtime.m_swapchains.clear();
+        runtime.m_sessions.clear();
+        runtime.m_hasInstance = false;
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrGetInstanceProperties(XrInstance instance, XrInstanceProperties* instanceProperties) {
+        if (instance != Instance) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!instanceProperties || instanceProperties->type != XR_TYPE_INSTANCE_PROPERTIES) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        instanceProperties->runtimeVersion = XR_MAKE_VERSION(1, 0, 0);
+        std::snprintf(instanceProperties->runtimeName, sizeof(instanceProperties->runtimeName), "MockRuntime");
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId) {
+        if (instance != Instance) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!getInfo || getInfo->type != XR_TYPE_SYSTEM_GET_INFO || !systemId) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        *systemId = 1;
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrGetSystemProperties(XrInstance instance,
+                                                XrSystemId systemId,
+                                                XrSystemProperties* properties) {
+        if (instance != Instance) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (systemId != 1 || !properties || properties->type != XR_TYPE_SYSTEM_PROPERTIES) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        properties->systemId = systemId;
+        std::snprintf(properties->systemName, sizeof(properties->systemName), "MockSystem");
+        properties->graphicsProperties.maxSwapchainImageWidth = 16384;
+        properties->graphicsProperties.maxSwapchainImageHeight = 16384;
+        properties->graphicsProperties.maxLayerCount = 16;
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrGetViewConfigurationProperties(XrInstance instance,
+                                                           XrSystemId systemId,
+                                                           XrViewConfigurationType viewConfigurationType,
+                                                           XrViewConfigurationProperties* configurationProperties) {
+        if (instance != Instance) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (systemId != 1 || !configurationProperties ||
+            configurationProperties->type != XR_TYPE_VIEW_CONFIGURATION_PROPERTIES) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        configurationProperties->viewConfigurationType = viewConfigurationType;
+        configurationProperties->fovMutable = true;
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrCreateSession(XrInstance instance,
+                                          const XrSessionCreateInfo* createInfo,
+                                          XrSession* session) {
+        MockRuntime& runtime = get();
+        if (instance != Instance) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!createInfo || createInfo->type != XR_TYPE_SESSION_CREATE_INFO || createInfo->systemId != 1 || !session) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+
+        std::unique_lock lock(runtime.m_handlesMutex);
+        *session = reinterpret_cast<XrSession>(runtime.m_sessions.emplace_back(std::make_unique<Session>()).get());
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrDestroySession(XrSession session) {
+        MockRuntime& runtime = get();
+        std::unique_lock lock(runtime.m_handlesMutex);
+        Session* const sessionState = runtime.findSession(session);
+        if (!sessionState) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+
+        // Destroying a session destroys its swapchains.
+        auto& swapchains = runtime.m_swapchains;
+        swapchains.erase(std::remove_if(swapchains.begin(),
+                                        swapchains.end(),
+                                        [&](const auto& swapchain) { return swapchain->session == sessionState; }),
+                         swapchains.end());
+        auto& sessions = runtime.m_sessions;
+        sessions.erase(std::find_if(
+            sessions.begin(), sessions.end(), [&](const auto& entry) { return entry.get() == sessionState; }));
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrEnumerateSwapchainFormats(XrSession session,
+                                                      uint32_t formatCapacityInput,
+                                                      uint32_t* formatCountOutput,
+                                                      int64_t* formats) {
+        const MockRuntime& runtime = get();
+        if (!runtime.findSession(session)) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!formatCountOutput || (formatCapacityInput && !formats)) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        runtime.spin(Call::EnumerateSwapchainFormats);
+
+        *formatCountOutput = (uint32_t)runtime.m_formats.size();
+        if (!formatCapacityInput) {
+            return XR_SUCCESS;
+        }
+        if (formatCapacityInput < runtime.m_formats.size()) {
+            return XR_ERROR_SIZE_INSUFFICIENT;
+        }
+        std::copy(runtime.m_formats.begin(), runtime.m_formats.end(), formats);
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrCreateSwapchain(XrSession session,
+                                            const XrSwapchainCreateInfo* createInfo,
+                                            XrSwapchain* swapchain) {
+        MockRuntime& runtime = get();
+        std::unique_lock lock(runtime.m_handlesMutex);
+        Session* const sessionState = runtime.findSession(session);
+        if (!sessionState) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!createInfo || createInfo->type != XR_TYPE_SWAPCHAIN_CREATE_INFO || !swapchain ||
+            std::find(runtime.m_formats.begin(), runtime.m_formats.end(), createInfo->format) ==
+                runtime.m_formats.end()) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+
+        auto newSwapchain = std::make_unique<Swapchain>();
+        newSwapchain->session = sessionState;
+        newSwapchain->imageCount = runtime.m_imageCount;
+        newSwapchain->textures = std::make_unique<uint64_t[]>(runtime.m_imageCount);
+        *swapchain = reinterpret_cast<XrSwapchain>(runtime.m_swapchains.emplace_back(std::move(newSwapchain)).get());
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrDestroySwapchain(XrSwapchain swapchain) {
+        MockRuntime& runtime = get();
+        std::unique_lock lock(runtime.m_handlesMutex);
+        Swapchain* const swapchainState = runtime.findSwapchain(swapchain);
+        if (!swapchainState) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        auto& swapchains = runtime.m_swapchains;
+        swapchains.erase(std::find_if(
+            swapchains.begin(), swapchains.end(), [&](const auto& entry) { return entry.get() == swapchainState; }));
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrEnumerateSwapchainImages(XrSwapchain swapchain,
+                                                     uint32_t imageCapacityInput,
+                                                     uint32_t* imageCountOutput,
+                                                     XrSwapchainImageBaseHeader* images) {
+        const Swapchain* const swapchainState = get().findSwapchain(swapchain);
+        if (!swapchainState) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!imageCountOutput || (imageCapacityInput && !images)) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+
+        *imageCountOutput = swapchainState->imageCount;
+        if (!imageCapacityInput) {
+            return XR_SUCCESS;
+        }
+        if (imageCapacityInput < swapchainState->imageCount) {
+            return XR_ERROR_SIZE_INSUFFICIENT;
+        }
+        SwapchainImageD3D12* const d3dImages = reinterpret_cast<SwapchainImageD3D12*>(images);
+        for (uint32_t i = 0; i < swapchainState->imageCount; i++) {
+            if (d3dImages[i].type != XR_TYPE_SWAPCHAIN_IMAGE_D3D12_KHR) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            d3dImages[i].texture = &swapchainState->textures[i];
+        }
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrAcquireSwapchainImage(XrSwapchain swapchain,
+                                                  const XrSwapchainImageAcquireInfo* acquireInfo,
+                                                  uint32_t* index) {
+        const MockRuntime& runtime = get();
+        Swapchain* const swapchainState = runtime.findSwapchain(swapchain);
+        if (!swapchainState) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if ((acquireInfo && acquireInfo->type != XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO) || !index) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        if (swapchainState->acquiredCount == swapchainState->imageCount) {
+            return XR_ERROR_CALL_ORDER_INVALID;
+        }
+        runtime.spin(Call::AcquireSwapchainImage);
+
+        *index = swapchainState->nextIndex;
+        swapchainState->nextIndex = (swapchainState->nextIndex + 1) % swapchainState->imageCount;
+        swapchainState->acquiredCount++;
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo) {
+        const MockRuntime& runtime = get();
+        Swapchain* const swapchainState = runtime.findSwapchain(swapchain);
+        if (!swapchainState) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!waitInfo || waitInfo->type != XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        if (!swapchainState->acquiredCount || swapchainState->waited) {
+            return XR_ERROR_CALL_ORDER_INVALID;
+        }
+        runtime.spin(Call::WaitSwapchainImage);
+
+        swapchainState->waited = true;
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrReleaseSwapchainImage(XrSwapchain swapchain,
+                                                  const XrSwapchainImageReleaseInfo* releaseInfo) {
+        const MockRuntime& runtime = get();
+        Swapchain* const swapchainState = runtime.findSwapchain(swapchain);
+        if (!swapchainState) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (releaseInfo && releaseInfo->type != XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+        if (!swapchainState->waited) {
+            return XR_ERROR_CALL_ORDER_INVALID;
+        }
+        runtime.spin(Call::ReleaseSwapchainImage);
+
+        swapchainState->waited = false;
+        swapchainState->acquiredCount--;
+        return XR_SUCCESS;
+    }
+
+    XrResult MockRuntime::xrEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo) {
+        const MockRuntime& runtime = get();
+        if (!runtime.findSession(session)) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!frameEndInfo || frameEndInfo->type != XR_TYPE_FRAME_END_INFO ||
+            (frameEndInfo->layerCount && !frameEndInfo->layers)) {
+            return XR_ERROR_VALIDATION_FAILURE;
+        }
+
+        // The swapchains must be the ones of the runtime, not the ones of a layer.
+        for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
+            const XrCompositionLayerBaseHeader* const layer = frameEndInfo->layers[i];
+            if (!layer) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            if (layer->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                const XrCompositionLayerProjection* const projection =
+                    reinterpret_cast<const XrCompositionLayerProjection*>(layer);
+                for (uint32_t j = 0; j < projection->viewCount; j++) {
+                    if (!runtime.findSwapchain(projection->views[j].subImage.swapchain)) {
+                        return XR_ERROR_HANDLE_INVALID;
+                    }
+                }
+            } else if (layer->type == XR_TYPE_COMPOSITION_LAYER_QUAD) {
+                const XrCompositionLayerQuad* const quad = reinterpret_cast<const XrCompositionLayerQuad*>(layer);
+                if (!runtime.findSwapchain(quad->subImage.swapchain)) {
+                    return XR_ERROR_HANDLE_INVALID;
+                }
+            }
+        }
+        runtime.spin(Call::EndFrame);
+
+        return XR_SUCCESS;
+    }
+
+} // namespace vulkan_d3d12_interop::test
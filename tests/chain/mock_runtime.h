@@ -0,0 +1,145 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace vulkan_d3d12_interop::test {
+
+    // The entry points with a configurable latency in the mock runtime.
+    enum class Call : uint32_t {
+        EnumerateSwapchainFormats,
+        AcquireSwapchainImage,
+        WaitSwapchainImage,
+        ReleaseSwapchainImage,
+        EndFrame,
+
+        Count
+    };
+
+    constexpr const char* CallNames[] = {
+        "xrEnumerateSwapchainFormats",
+        "xrAcquireSwapchainImage",
+        "xrWaitSwapchainImage",
+        "xrReleaseSwapchainImage",
+        "xrEndFrame",
+    };
+    static_assert(std::size(CallNames) == (size_t)Call::Count);
+
+    // The layout of XrSwapchainImageD3D12KHR, without depending on d3d12.h.
+    struct SwapchainImageD3D12 {
+        XrStructureType type;
+        void* next;
+        void* texture;
+    };
+
+    // A runtime implementing the subset of OpenXR that the layer intercepts, served through xrGetInstanceProcAddr()
+    // like a real runtime. It needs no GPU: the swapchain images are fake D3D12 textures (distinct non-null pointers
+    // that must never be dereferenced). Each call validates its arguments and the state of the swapchain images, then
+    // spins for its configured latency. There can only be one runtime at a time.
+    class MockRuntime {
+      public:
+        MockRuntime();
+        ~MockRuntime();
+
+        MockRuntime(const MockRuntime&) = delete;
+        MockRuntime& operator=(const MockRuntime&) = delete;
+
+        // Must not be called while other threads are calling the runtime.
+        void setLatency(Call call, std::chrono::nanoseconds latency);
+        void setImageCount(uint32_t imageCount);
+
+        // The formats returned by xrEnumerateSwapchainFormats(), as DXGI_FORMAT values.
+        void setFormats(std::vector<int64_t> formats);
+
+        // Create an instance, as the loader does before creating the layers on top of it.
+        XrInstance createInstance();
+
+        static XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance instance,
+                                                         const char* name,
+                                                         PFN_xrVoidFunction* function);
+
+        // The fake texture of an image, to check what the layers return to the application.
+        void* getTexture(XrSwapchain swapchain, uint32_t index) const;
+
+      private:
+        struct Session;
+        struct Swapchain;
+
+        static MockRuntime& get();
+        void spin(Call call) const;
+        Session* findSession(XrSession session) const;
+        Swapchain* findSwapchain(XrSwapchain swapchain) const;
+
+        static XrResult XRAPI_CALL xrDestroyInstance(XrInstance instance);
+        static XrResult XRAPI_CALL xrGetInstanceProperties(XrInstance instance,
+                                                           XrInstanceProperties* instanceProperties);
+        static XrResult XRAPI_CALL xrGetSystem(XrInstance instance,
+                                               const XrSystemGetInfo* getInfo,
+                                               XrSystemId* systemId);
+        static XrResult XRAPI_CALL xrGetSystemProperties(XrInstance instance,
+                                                         XrSystemId systemId,
+                                                         XrSystemProperties* properties);
+        static XrResult XRAPI_CALL
+        xrGetViewConfigurationProperties(XrInstance instance,
+                                         XrSystemId systemId,
+                                         XrViewConfigurationType viewConfigurationType,
+                                         XrViewConfigurationProperties* configurationProperties);
+        static XrResult XRAPI_CALL xrCreateSession(XrInstance instance,
+                                                   const XrSessionCreateInfo* createInfo,
+                                                   XrSession* session);
+        static XrResult XRAPI_CALL xrDestroySession(XrSession session);
+        static XrResult XRAPI_CALL xrEnumerateSwapchainFormats(XrSession session,
+                                                               uint32_t formatCapacityInput,
+                                                               uint32_t* formatCountOutput,
+                                                               int64_t* formats);
+        static XrResult XRAPI_CALL xrCreateSwapchain(XrSession session,
+                                                     const XrSwapchainCreateInfo* createInfo,
+                                                     XrSwapchain* swapchain);
+        static XrResult XRAPI_CALL xrDestroySwapchain(XrSwapchain swapchain);
+        static XrResult XRAPI_CALL xrEnumerateSwapchainImages(XrSwapchain swapchain,
+                                                              uint32_t imageCapacityInput,
+                                                              uint32_t* imageCountOutput,
+                                                              XrSwapchainImageBaseHeader* images);
+        static XrResult XRAPI_CALL xrAcquireSwapchainImage(XrSwapchain swapchain,
+                                                           const XrSwapchainImageAcquireInfo* acquireInfo,
+                                                           uint32_t* index);
+        static XrResult XRAPI_CALL xrWaitSwapchainImage(XrSwapchain swapchain,
+                                                        const XrSwapchainImageWaitInfo* waitInfo);
+        static XrResult XRAPI_CALL xrReleaseSwapchainImage(XrSwapchain swapchain,
+                                                           const XrSwapchainImageReleaseInfo* releaseInfo);
+        static XrResult XRAPI_CALL xrEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo);
+
+        std::array<std::chrono::nanoseconds, (size_t)Call::Count> m_latencies{};
+        uint32_t m_imageCount{3};
+        std::vector<int64_t> m_formats;
+
+        // Protects the creation and destruction of the handles. The calls on existing handles do not take it: like
+        // with a real runtime, the application must not destroy a handle while using it.
+        mutable std::mutex m_handlesMutex;
+        bool m_hasInstance{false};
+        std::vector<std::unique_ptr<Session>> m_sessions;
+        std::vector<std::unique_ptr<Swapchain>> m_swapchains;
+    };
+
+} // namespace vulkan_d3d12_interop::test
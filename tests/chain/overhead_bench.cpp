@@ -0,0 +1,304 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Measures the latency added by a chain of layers to the calls made every frame, on top of the mock runtime.
+//
+// Usage: overhead_bench [--layers 0,1,2,4,8,16,32] [--swapchains 1,4,16] [--threads 1,2,4] [--frames 2000]
+//                       [--latency <call>=<ns>]... [--output <file.json>]
+//
+// Each configuration runs the given number of frames on each thread. Every thread renders to its own share of the
+// swapchains (acquire, wait and release each of them) and enumerates the swapchain formats once per frame, and the
+// first thread also submits all the swapchains with xrEndFrame(). The latency of every call is written as JSON. The
+// configurations with no layers measure the mock runtime alone, which is the baseline for the others.
+
+#include "chain.h"
+#include "mock_runtime.h"
+#include "samples.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+using namespace vulkan_d3d12_interop::test;
+
+namespace {
+
+    struct Options {
+        std::vector<size_t> layerCounts{0, 1, 2, 4, 8, 16, 32};
+        std::vector<size_t> swapchainCounts{1, 4, 16};
+        std::vector<size_t> threadCounts{1, 2, 4};
+        size_t frames{2000};
+        std::array<std::chrono::nanoseconds, (size_t)Call::Count> latencies{};
+        std::string output;
+    };
+
+    struct Configuration {
+        size_t layerCount;
+        size_t swapchainCount;
+        size_t threadCount;
+    };
+
+    std::vector<size_t> parseList(const std::string& value) {
+        std::vector<size_t> list;
+        std::stringstream stream(value);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            list.push_back(std::stoul(item));
+        }
+        if (list.empty()) {
+            throw std::invalid_argument("Empty list: " + value);
+        }
+        return list;
+    }
+
+    Options parseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg(argv[i]);
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + std::string(arg));
+            }
+            const std::string value(argv[++i]);
+            if (arg == "--layers") {
+                options.layerCounts = parseList(value);
+            } else if (arg == "--swapchains") {
+                options.swapchainCounts = parseList(value);
+            } else if (arg == "--threads") {
+                options.threadCounts = parseList(value);
+            } else if (arg == "--frames") {
+                options.frames = std::stoul(value);
+            } else if (arg == "--latency") {
+                const size_t separator = value.find('=');
+                const auto name = value.substr(0, separator);
+                const auto it = std::find_if(std::begin(CallNames), std::end(CallNames), [&](const char* callName) {
+                    return name == callName || "xr" + name == callName;
+                });
+                if (separator == std::string::npos || it == std::end(CallNames)) {
+                    throw std::invalid_argument("Invalid latency: " + value);
+                }
+                options.latencies[it - std::begin(CallNames)] =
+                    std::chrono::nanoseconds(std::stoull(value.substr(separator + 1)));
+            } else if (arg == "--output") {
+                options.output = value;
+            } else {
+                throw std::invalid_argument("Unknown option: " + std::string(arg));
+            }
+        }
+        return options;
+    }
+
+    template <typename F>
+    void timeCall(Samples& samples, F&& call) {
+        const auto start = std::chrono::steady_clock::now();
+        CHECK_XRCMD(call());
+        samples.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // The latencies of each call, for all the threads of a configuration.
+    std::array<Samples, (size_t)Call::Count> run(MockRuntime& runtime, const Configuration& config, size_t frames) {
+        Chain chain(runtime, config.layerCount);
+        const Dispatch& xr = chain.xr();
+
+        XrSessionCreateInfo sessionCreateInfo{XR_TYPE_SESSION_CREATE_INFO};
+        sessionCreateInfo.systemId = chain.getSystemId();
+        XrSession session;
+        CHECK_XRCMD(xr.xrCreateSession(chain.getInstance(), &sessionCreateInfo, &session));
+
+        uint32_t formatCount = 0;
+        CHECK_XRCMD(xr.xrEnumerateSwapchainFormats(session, 0, &formatCount, nullptr));
+        std::vector<int64_t> formats(formatCount);
+        CHECK_XRCMD(xr.xrEnumerateSwapchainFormats(session, formatCount, &formatCount, formats.data()));
+
+        std::vector<XrSwapchain> swapchains(config.swapchainCount);
+        for (XrSwapchain& swapchain : swapchains) {
+            XrSwapchainCreateInfo createInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+            createInfo.format = formats[0];
+            createInfo.width = createInfo.height = 1024;
+            createInfo.sampleCount = createInfo.faceCount = createInfo.arraySize = createInfo.mipCount = 1;
+            CHECK_XRCMD(xr.xrCreateSwapchain(session, &createInfo, &swapchain));
+
+            // The layers must hand out the images of the runtime.
+            uint32_t imageCount = 0;
+            CHECK_XRCMD(xr.xrEnumerateSwapchainImages(swapchain, 0, &imageCount, nullptr));
+            std::vector<SwapchainImageD3D12> images(imageCount, {XR_TYPE_SWAPCHAIN_IMAGE_D3D12_KHR});
+            CHECK_XRCMD(xr.xrEnumerateSwapchainImages(
+                swapchain, imageCount, &imageCount, reinterpret_cast<XrSwapchainImageBaseHeader*>(images.data())));
+            for (uint32_t i = 0; i < imageCount; i++) {
+                if (images[i].texture != runtime.getTexture(swapchain, i)) {
+                    throw std::runtime_error("The chain did not return the runtime's images");
+                }
+            }
+        }
+
+        // One quad per swapchain.
+        std::vector<XrCompositionLayerQuad> quads(swapchains.size(), {XR_TYPE_COMPOSITION_LAYER_QUAD});
+        std::vector<const XrCompositionLayerBaseHeader*> layers;
+        for (size_t i = 0; i < swapchains.size(); i++) {
+            quads[i].subImage.swapchain = swapchains[i];
+            quads[i].subImage.imageRect.extent = {1024, 1024};
+            quads[i].size = {1.f, 1.f};
+            quads[i].pose.orientation.w = 1.f;
+            layers.push_back(reinterpret_cast<const XrCompositionLayerBaseHeader*>(&quads[i]));
+        }
+
+        std::vector<std::array<Samples, (size_t)Call::Count>> threadSamples(config.threadCount);
+        std::vector<std::string> threadErrors(config.threadCount);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < config.threadCount; t++) {
+            threads.emplace_back([&, t] {
+                auto& samples = threadSamples[t];
+                const size_t ownedCount = (swapchains.size() - t + config.threadCount - 1) / config.threadCount;
+                samples[(size_t)Call::EnumerateSwapchainFormats].reserve(frames);
+                for (Call call : {Call::AcquireSwapchainImage, Call::WaitSwapchainImage, Call::ReleaseSwapchainImage}) {
+                    samples[(size_t)call].reserve(frames * ownedCount);
+                }
+                if (t == 0) {
+                    samples[(size_t)Call::EndFrame].reserve(frames);
+                }
+
+                try {
+                    std::vector<int64_t> threadFormats(formats.size());
+                    for (size_t frame = 0; frame < frames; frame++) {
+                        timeCall(samples[(size_t)Call::EnumerateSwapchainFormats], [&] {
+                            uint32_t count;
+                            return xr.xrEnumerateSwapchainFormats(
+                                session, (uint32_t)threadFormats.size(), &count, threadFormats.data());
+                        });
+
+                        for (size_t i = t; i < swapchains.size(); i += config.threadCount) {
+                            uint32_t index;
+                            timeCall(samples[(size_t)Call::AcquireSwapchainImage],
+                                     [&] { return xr.xrAcquireSwapchainImage(swapchains[i], nullptr, &index); });
+
+                            XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                            waitInfo.timeout = XR_INFINITE_DURATION;
+                            timeCall(samples[(size_t)Call::WaitSwapchainImage],
+                                     [&] { return xr.xrWaitSwapchainImage(swapchains[i], &waitInfo); });
+
+                            timeCall(samples[(size_t)Call::ReleaseSwapchainImage],
+                                     [&] { return xr.xrReleaseSwapchainImage(swapchains[i], nullptr); });
+                        }
+
+                        if (t == 0) {
+                            XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
+                            frameEndInfo.displayTime = (XrTime)frame + 1;
+                            frameEndInfo.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+                            frameEndInfo.layerCount = (uint32_t)layers.size();
+                            frameEndInfo.layers = layers.data();
+                            timeCall(samples[(size_t)Call::EndFrame],
+                                     [&] { return xr.xrEndFrame(session, &frameEndInfo); });
+                        }
+                    }
+                } catch (std::exception& exc) {
+                    threadErrors[t] = exc.what();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (const auto& error : threadErrors) {
+            if (!error.empty()) {
+                throw std::runtime_error(error);
+            }
+        }
+
+        for (XrSwapchain swapchain : swapchains) {
+            CHECK_XRCMD(xr.xrDestroySwapchain(swapchain));
+        }
+        CHECK_XRCMD(xr.xrDestroySession(session));
+
+        std::array<Samples, (size_t)Call::Count> merged;
+        for (auto& samples : threadSamples) {
+            for (size_t i = 0; i < merged.size(); i++) {
+                merged[i].insert(merged[i].end(), samples[i].begin(), samples[i].end());
+            }
+        }
+        return merged;
+    }
+
+    void writeResult(std::ostream& out, const Configuration& config, Call call, Samples& samples, bool first) {
+        out << (first ? "" : ",\n") << "    {\"layers\": " << config.layerCount
+            << ", \"swapchains\": " << config.swapchainCount << ", \"threads\": " << config.threadCount
+            << ", \"call\": \"" << CallNames[(size_t)call] << "\", " << FormatSamples(samples) << "}";
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        const Options options = parseOptions(argc, argv);
+
+        MockRuntime runtime;
+        for (size_t i = 0; i < (size_t)Call::Count; i++) {
+            runtime.setLatency((Call)i, options.latencies[i]);
+        }
+
+        std::ofstream file;
+        if (!options.output.empty()) {
+            file.open(options.output, std::ios_base::trunc);
+            if (!file.is_open()) {
+                throw std::runtime_error("Cannot open " + options.output);
+            }
+        }
+        std::ostream& out = file.is_open() ? file : std::cout;
+
+        out << "{\n  \"frames\": " << options.frames << ",\n  \"runtimeLatencyNs\": {";
+        for (size_t i = 0; i < (size_t)Call::Count; i++) {
+            out << (i ? ", " : "") << "\"" << CallNames[i] << "\": " << options.latencies[i].count();
+        }
+        out << "},\n  \"results\": [\n";
+
+        bool first = true;
+        for (const size_t layerCount : options.layerCounts) {
+            for (const size_t swapchainCount : options.swapchainCounts) {
+                for (const size_t threadCount : options.threadCounts) {
+                    // Each thread needs a swapchain of its own.
+                    if (!threadCount || threadCount > swapchainCount) {
+                        continue;
+                    }
+
+                    const Configuration config{layerCount, swapchainCount, threadCount};
+                    auto samples = run(runtime, config, options.frames);
+                    for (size_t i = 0; i < (size_t)Call::Count; i++) {
+                        writeResult(out, config, (Call)i, samples[i], first);
+                        first = false;
+                    }
+                    std::cerr << "layers=" << layerCount << " swapchains=" << swapchainCount
+                              << " threads=" << threadCount << " done\n";
+                }
+            }
+        }
+        out << "\n  ]\n}\n";
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Failed to write the results");
+        }
+    } catch (std::exception& exc) {
+        std::cerr << exc.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
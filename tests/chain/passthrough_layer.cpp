@@ -0,0 +1,122 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// A layer that only goes through the framework: the generated dispatcher and wrappers (dispatch.gen.cpp) and the
+// entry points of dispatch.cpp, without the loader negotiation. It is compiled once for each LAYER_NAMESPACE, so that
+// a chain can stack as many distinct layers as we want.
+
+#include "pch.h"
+
+#include <layer.h>
+
+#include "framework/dispatch.h"
+#include "log.h"
+
+#include "chain.h"
+
+#ifndef LAYER_NAMESPACE
+#error Must define LAYER_NAMESPACE
+#endif
+
+#define LAYER_STRINGIFY(name) #name
+#define LAYER_NAME(name) LAYER_STRINGIFY(name)
+
+using namespace LAYER_NAMESPACE::log;
+
+namespace LAYER_NAMESPACE {
+
+    namespace {
+
+        // Does not override anything from OpenXrApi.
+        class PassthroughLayer : public OpenXrApi {};
+
+        std::unique_ptr<PassthroughLayer> g_instance;
+
+        XrResult createLayerInstance(PFN_xrGetInstanceProcAddr nextGetInstanceProcAddr,
+                                     XrInstance instance,
+                                     const XrInstanceCreateInfo* createInfo) {
+            GetInstance()->SetGetInstanceProcAddr(nextGetInstanceProcAddr, instance);
+
+            XrResult result;
+            try {
+                result = GetInstance()->xrCreateInstance(createInfo);
+            } catch (std::runtime_error exc) {
+                ErrorLog("xrCreateInstance: %s\n", exc.what());
+                result = XR_ERROR_RUNTIME_FAILURE;
+            }
+            return result;
+        }
+
+    } // namespace
+
+    OpenXrApi* GetInstance() {
+        if (!g_instance) {
+            g_instance = std::make_unique<PassthroughLayer>();
+        }
+        return g_instance.get();
+    }
+
+    void ResetInstance() {
+        g_instance.reset();
+    }
+
+    // Same as dispatch.cpp.
+    XrResult XRAPI_CALL xrDestroyInstance(XrInstance instance) {
+        XrResult result;
+        try {
+            result = LAYER_NAMESPACE::GetInstance()->xrDestroyInstance(instance);
+            if (XR_SUCCEEDED(result)) {
+                LAYER_NAMESPACE::ResetInstance();
+            }
+        } catch (std::runtime_error exc) {
+            ErrorLog("xrDestroyInstance: %s\n", exc.what());
+            result = XR_ERROR_RUNTIME_FAILURE;
+        }
+
+        if (XR_FAILED(result)) {
+            ErrorLog("xrDestroyInstance failed with %s\n", xr::ToCString(result));
+        }
+
+        return result;
+    }
+
+    // Same as dispatch.cpp, without the bypass of the layer.
+    XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
+        XrResult result;
+        try {
+            result = LAYER_NAMESPACE::GetInstance()->xrGetInstanceProcAddr(instance, name, function);
+        } catch (std::runtime_error exc) {
+            ErrorLog("xrGetInstanceProcAddr: %s\n", exc.what());
+            result = XR_ERROR_RUNTIME_FAILURE;
+        }
+
+        return result;
+    }
+
+    namespace {
+
+        const vulkan_d3d12_interop::test::LayerRegistration g_registration(
+            {LAYER_NAME(LAYER_NAMESPACE), &createLayerInstance, &LAYER_NAMESPACE::xrGetInstanceProcAddr});
+
+    } // namespace
+
+} // namespace LAYER_NAMESPACE
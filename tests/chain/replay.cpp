@@ -0,0 +1,463 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Replays a capture file (written with the capture_calls setting) through a chain of layers on top of the mock
+// runtime, and reports the time spent in each call and in each frame.
+//
+// Usage: replay <file.capture> [--layers <count>] [--paced] [--output <file.json>]
+//
+// The records are replayed in the order of the file, on a single thread. The calls that failed in the capture are
+// skipped. With --paced, each call is delayed until its captured timestamp, otherwise the calls are made back to back.
+// The mock runtime is given the formats of the captured swapchains, and the composition layers other than projection
+// layers are submitted as quad layers, since the runtime only validates their swapchains.
+
+#include "chain.h"
+#include "mock_runtime.h"
+#include "samples.h"
+
+#include "capture_format.h"
+
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <thread>
+
+using namespace vulkan_d3d12_interop;
+using namespace vulkan_d3d12_interop::test;
+
+namespace {
+
+    struct Options {
+        std::string path;
+        size_t layerCount{1};
+        bool paced{false};
+        std::string output;
+    };
+
+    struct Record {
+        capture::RecordHeader header;
+        const uint8_t* payload;
+    };
+
+    // The calls of one frame, up to and including its xrEndFrame().
+    struct Frame {
+        int64_t displayTime;
+        uint64_t capturedNs;
+        uint64_t replayedNs;
+        uint64_t capturedEndFrameNs;
+        uint64_t replayedEndFrameNs;
+    };
+
+    Options parseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg(argv[i]);
+            if (arg == "--paced") {
+                options.paced = true;
+            } else if (arg == "--layers" && i + 1 < argc) {
+                options.layerCount = std::stoul(argv[++i]);
+            } else if (arg == "--output" && i + 1 < argc) {
+                options.output = argv[++i];
+            } else if (options.path.empty() && arg.substr(0, 2) != "--") {
+                options.path = arg;
+            } else {
+                throw std::invalid_argument("Invalid option: " + std::string(arg));
+            }
+        }
+        if (options.path.empty()) {
+            throw std::invalid_argument("Usage: replay <file.capture> [--layers <count>] [--paced] [--output <file>]");
+        }
+        return options;
+    }
+
+    template <typename T>
+    T readAt(const Record& record, size_t offset) {
+        if (offset + sizeof(T) > record.header.size) {
+            throw std::runtime_error("Truncated payload");
+        }
+        T value;
+        std::memcpy(&value, record.payload + offset, sizeof(T));
+        return value;
+    }
+
+    // Returns the records of a capture file, which are stored in the order in which the calls completed.
+    std::vector<Record> readCapture(const std::vector<uint8_t>& data) {
+        capture::FileHeader fileHeader;
+        if (data.size() < sizeof(fileHeader)) {
+            throw std::runtime_error("The file is too short");
+        }
+        std::memcpy(&fileHeader, data.data(), sizeof(fileHeader));
+        if (std::memcmp(fileHeader.magic, capture::Magic, sizeof(capture::Magic))) {
+            throw std::runtime_error("Not a capture file");
+        }
+        if (fileHeader.version != capture::Version) {
+            throw std::runtime_error("Unsupported version " + std::to_string(fileHeader.version));
+        }
+
+        std::vector<Record> records;
+        size_t offset = sizeof(fileHeader);
+        while (offset + sizeof(capture::RecordHeader) <= data.size()) {
+            Record record;
+            std::memcpy(&record.header, data.data() + offset, sizeof(record.header));
+            offset += sizeof(record.header);
+            if (offset + record.header.size > data.size()) {
+                std::cerr << "Truncated record at offset " << offset - sizeof(record.header) << "\n";
+                break;
+            }
+            record.payload = data.data() + offset;
+            offset += record.header.size;
+            records.push_back(record);
+        }
+        return records;
+    }
+
+    class Replayer {
+      public:
+        Replayer(MockRuntime& runtime, const Options& options) : m_chain(runtime, options.layerCount) {
+        }
+
+        // Returns false when the record cannot be replayed.
+        bool replay(const Record& record) {
+            switch (record.header.type) {
+            case capture::RecordType::CreateSession:
+                return createSession(readAt<capture::SessionRecord>(record, 0));
+            case capture::RecordType::DestroySession:
+                return destroySession(readAt<capture::SessionRecord>(record, 0));
+            case capture::RecordType::CreateSwapchain:
+                return createSwapchain(readAt<capture::CreateSwapchainRecord>(record, 0));
+            case capture::RecordType::DestroySwapchain:
+                return destroySwapchain(readAt<capture::SwapchainRecord>(record, 0));
+            case capture::RecordType::AcquireSwapchainImage:
+            case capture::RecordType::WaitSwapchainImage:
+            case capture::RecordType::ReleaseSwapchainImage:
+                return useSwapchain(record.header.type, readAt<capture::SwapchainRecord>(record, 0));
+            case capture::RecordType::EndFrame:
+                return endFrame(record);
+            }
+            return false;
+        }
+
+        std::array<Samples, (size_t)Call::Count>& getSamples() {
+            return m_samples;
+        }
+
+        // The time spent in the last replayed call.
+        uint64_t getLastDuration() const {
+            return m_lastDuration;
+        }
+
+        // Destroy what the capture did not.
+        void cleanup() {
+            for (const auto& [handle, swapchain] : m_swapchains) {
+                m_chain.xr().xrDestroySwapchain(swapchain);
+            }
+            m_swapchains.clear();
+            for (const auto& [handle, session] : m_sessions) {
+                m_chain.xr().xrDestroySession(session);
+            }
+            m_sessions.clear();
+        }
+
+      private:
+        template <typename F>
+        bool time(std::optional<Call> call, F&& function) {
+            const auto start = std::chrono::steady_clock::now();
+            const XrResult result = function();
+            m_lastDuration =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            if (XR_FAILED(result)) {
+                std::cerr << "Replayed call failed with " << xr::ToCString(result) << "\n";
+                return false;
+            }
+            if (call) {
+                m_samples[(size_t)*call].push_back(m_lastDuration);
+            }
+            return true;
+        }
+
+        bool createSession(const capture::SessionRecord& record) {
+            XrSessionCreateInfo createInfo{XR_TYPE_SESSION_CREATE_INFO};
+            createInfo.systemId = m_chain.getSystemId();
+            XrSession session;
+            if (!time({}, [&] { return m_chain.xr().xrCreateSession(m_chain.getInstance(), &createInfo, &session); })) {
+                return false;
+            }
+            m_sessions.insert_or_assign(record.session, session);
+            return true;
+        }
+
+        bool destroySession(const capture::SessionRecord& record) {
+            const auto it = m_sessions.find(record.session);
+            if (it == m_sessions.end()) {
+                return false;
+            }
+            const XrSession session = it->second;
+            m_sessions.erase(it);
+
+            // Destroying a session destroys its swapchains in the runtime.
+            for (auto swapchain = m_swapchains.begin(); swapchain != m_swapchains.end();) {
+                swapchain = m_swapchainSessions[swapchain->first] == session ? m_swapchains.erase(swapchain)
+                                                                             : std::next(swapchain);
+            }
+            return time({}, [&] { return m_chain.xr().xrDestroySession(session); });
+        }
+
+        bool createSwapchain(const capture::CreateSwapchainRecord& record) {
+            const auto session = m_sessions.find(record.session);
+            if (session == m_sessions.end()) {
+                return false;
+            }
+
+            XrSwapchainCreateInfo createInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+            createInfo.createFlags = record.createFlags;
+            createInfo.usageFlags = record.usageFlags;
+            createInfo.format = record.format;
+            createInfo.sampleCount = record.sampleCount;
+            createInfo.width = record.width;
+            createInfo.height = record.height;
+            createInfo.faceCount = record.faceCount;
+            createInfo.arraySize = record.arraySize;
+            createInfo.mipCount = record.mipCount;
+            XrSwapchain swapchain;
+            if (!time({}, [&] { return m_chain.xr().xrCreateSwapchain(session->second, &createInfo, &swapchain); })) {
+                return false;
+            }
+            m_swapchains.insert_or_assign(record.swapchain, swapchain);
+            m_swapchainSessions.insert_or_assign(record.swapchain, session->second);
+            return true;
+        }
+
+        bool destroySwapchain(const capture::SwapchainRecord& record) {
+            const auto it = m_swapchains.find(record.swapchain);
+            if (it == m_swapchains.end()) {
+                return false;
+            }
+            const XrSwapchain swapchain = it->second;
+            m_swapchains.erase(it);
+            return time({}, [&] { return m_chain.xr().xrDestroySwapchain(swapchain); });
+        }
+
+        bool useSwapchain(capture::RecordType type, const capture::SwapchainRecord& record) {
+            const auto it = m_swapchains.find(record.swapchain);
+            if (it == m_swapchains.end()) {
+                return false;
+            }
+            const XrSwapchain swapchain = it->second;
+            const Dispatch& xr = m_chain.xr();
+
+            if (type == capture::RecordType::AcquireSwapchainImage) {
+                uint32_t index;
+                return time(Call::AcquireSwapchainImage,
+                            [&] { return xr.xrAcquireSwapchainImage(swapchain, nullptr, &index); });
+            } else if (type == capture::RecordType::WaitSwapchainImage) {
+                XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                waitInfo.timeout = record.value;
+                return time(Call::WaitSwapchainImage, [&] { return xr.xrWaitSwapchainImage(swapchain, &waitInfo); });
+            } else {
+                return time(Call::ReleaseSwapchainImage,
+                            [&] { return xr.xrReleaseSwapchainImage(swapchain, nullptr); });
+            }
+        }
+
+        bool endFrame(const Record& record) {
+            const auto frame = readAt<capture::EndFrameRecord>(record, 0);
+            const auto session = m_sessions.find(frame.session);
+            if (session == m_sessions.end()) {
+                return false;
+            }
+
+            // The views and quads must not move while we point to them.
+            std::vector<XrCompositionLayerProjection> projections;
+            std::vector<XrCompositionLayerQuad> quads;
+            std::vector<std::vector<XrCompositionLayerProjectionView>> views;
+            projections.reserve(frame.layerCount);
+            quads.reserve(frame.layerCount);
+            views.reserve(frame.layerCount);
+            std::vector<const XrCompositionLayerBaseHeader*> layers;
+
+            size_t offset = sizeof(frame);
+            for (uint32_t i = 0; i < frame.layerCount; i++) {
+                const auto layer = readAt<capture::LayerRecord>(record, offset);
+                offset += sizeof(layer);
+
+                std::vector<XrSwapchainSubImage> subImages;
+                for (uint32_t j = 0; j < layer.subImageCount; j++) {
+                    const auto subImageRecord = readAt<capture::SubImageRecord>(record, offset);
+                    offset += sizeof(subImageRecord);
+
+                    const auto swapchain = m_swapchains.find(subImageRecord.swapchain);
+                    if (swapchain == m_swapchains.end()) {
+                        return false;
+                    }
+                    XrSwapchainSubImage& subImage = subImages.emplace_back();
+                    subImage.swapchain = swapchain->second;
+                    subImage.imageRect.offset = {subImageRecord.x, subImageRecord.y};
+                    subImage.imageRect.extent = {subImageRecord.width, subImageRecord.height};
+                    subImage.imageArrayIndex = subImageRecord.imageArrayIndex;
+                }
+                if (subImages.empty()) {
+                    continue;
+                }
+
+                if (layer.type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                    auto& projectionViews = views.emplace_back(subImages.size());
+                    for (size_t j = 0; j < subImages.size(); j++) {
+                        projectionViews[j] = {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
+                        projectionViews[j].pose.orientation.w = 1.f;
+                        projectionViews[j].subImage = subImages[j];
+                    }
+                    XrCompositionLayerProjection& projection = projections.emplace_back();
+                    projection = {XR_TYPE_COMPOSITION_LAYER_PROJECTION};
+                    projection.layerFlags = layer.layerFlags;
+                    projection.viewCount = (uint32_t)projectionViews.size();
+                    projection.views = projectionViews.data();
+                    layers.push_back(reinterpret_cast<const XrCompositionLayerBaseHeader*>(&projection));
+                } else {
+                    XrCompositionLayerQuad& quad = quads.emplace_back();
+                    quad = {XR_TYPE_COMPOSITION_LAYER_QUAD};
+                    quad.layerFlags = layer.layerFlags;
+                    quad.subImage = subImages[0];
+                    quad.pose.orientation.w = 1.f;
+                    quad.size = {1.f, 1.f};
+                    layers.push_back(reinterpret_cast<const XrCompositionLayerBaseHeader*>(&quad));
+                }
+            }
+
+            XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
+            frameEndInfo.displayTime = frame.displayTime;
+            frameEndInfo.environmentBlendMode = (XrEnvironmentBlendMode)frame.environmentBlendMode;
+            frameEndInfo.layerCount = (uint32_t)layers.size();
+            frameEndInfo.layers = layers.data();
+            return time(Call::EndFrame, [&] { return m_chain.xr().xrEndFrame(session->second, &frameEndInfo); });
+        }
+
+        Chain m_chain;
+        std::map<uint64_t, XrSession> m_sessions;
+        std::map<uint64_t, XrSwapchain> m_swapchains;
+        std::map<uint64_t, XrSession> m_swapchainSessions;
+
+        std::array<Samples, (size_t)Call::Count> m_samples;
+        uint64_t m_lastDuration{0};
+    };
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        const Options options = parseOptions(argc, argv);
+
+        std::ifstream file(options.path, std::ios_base::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot open " + options.path);
+        }
+        const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        const std::vector<Record> records = readCapture(data);
+
+        // The runtime must accept the formats of the captured swapchains.
+        MockRuntime runtime;
+        std::vector<int64_t> formats;
+        for (const Record& record : records) {
+            if (record.header.type == capture::RecordType::CreateSwapchain) {
+                const int64_t format = readAt<capture::CreateSwapchainRecord>(record, 0).format;
+                if (std::find(formats.begin(), formats.end(), format) == formats.end()) {
+                    formats.push_back(format);
+                }
+            }
+        }
+        runtime.setFormats(formats);
+
+        Replayer replayer(runtime, options);
+        std::vector<Frame> frames;
+        Frame frame{};
+        size_t replayedCount = 0;
+        size_t skippedCount = 0;
+        const auto origin = std::chrono::steady_clock::now();
+        for (const Record& record : records) {
+            if (record.header.result < 0) {
+                skippedCount++;
+                continue;
+            }
+            if (options.paced) {
+                std::this_thread::sleep_until(origin + std::chrono::nanoseconds(record.header.timestampNs));
+            }
+            if (!replayer.replay(record)) {
+                skippedCount++;
+                continue;
+            }
+            replayedCount++;
+
+            frame.capturedNs += record.header.durationNs;
+            frame.replayedNs += replayer.getLastDuration();
+            if (record.header.type == capture::RecordType::EndFrame) {
+                frame.displayTime = readAt<capture::EndFrameRecord>(record, 0).displayTime;
+                frame.capturedEndFrameNs = record.header.durationNs;
+                frame.replayedEndFrameNs = replayer.getLastDuration();
+                frames.push_back(frame);
+                frame = {};
+            }
+        }
+        replayer.cleanup();
+
+        std::ofstream outputFile;
+        if (!options.output.empty()) {
+            outputFile.open(options.output, std::ios_base::trunc);
+            if (!outputFile.is_open()) {
+                throw std::runtime_error("Cannot open " + options.output);
+            }
+        }
+        std::ostream& out = outputFile.is_open() ? outputFile : std::cout;
+
+        out << "{\n  \"layers\": " << options.layerCount << ",\n  \"records\": " << records.size()
+            << ",\n  \"replayed\": " << replayedCount << ",\n  \"skipped\": " << skippedCount
+            << ",\n  \"calls\": [\n";
+        bool first = true;
+        for (size_t i = 0; i < (size_t)Call::Count; i++) {
+            auto& samples = replayer.getSamples()[i];
+            if (samples.empty()) {
+                continue;
+            }
+            out << (first ? "" : ",\n") << "    {\"call\": \"" << CallNames[i] << "\", " << FormatSamples(samples)
+                << "}";
+            first = false;
+        }
+        out << "\n  ],\n  \"frames\": [\n";
+        for (size_t i = 0; i < frames.size(); i++) {
+            out << (i ? ",\n" : "") << "    {\"displayTime\": " << frames[i].displayTime
+                << ", \"capturedNs\": " << frames[i].capturedNs << ", \"replayedNs\": " << frames[i].replayedNs
+                << ", \"capturedEndFrameNs\": " << frames[i].capturedEndFrameNs
+                << ", \"replayedEndFrameNs\": " << frames[i].replayedEndFrameNs << "}";
+        }
+        out << "\n  ]\n}\n";
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Failed to write the results");
+        }
+
+        std::cerr << "Replayed " << replayedCount << " records, skipped " << skippedCount << ", " << frames.size()
+                  << " frames\n";
+    } catch (std::exception& exc) {
+        std::cerr << exc.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+#include <cmath>
+#include <numeric>
+
+namespace vulkan_d3d12_interop::test {
+
+    // The latencies of a call, in nanoseconds.
+    using Samples = std::vector<uint64_t>;
+
+    // The nearest-rank percentile, the samples are partially sorted.
+    inline uint64_t GetPercentile(Samples& samples, double quantile) {
+        const size_t rank = std::max<size_t>((size_t)std::ceil(quantile * samples.size()), 1) - 1;
+        std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+        return samples[rank];
+    }
+
+    // The JSON members describing the distribution of the samples, without the braces.
+    inline std::string FormatSamples(Samples& samples) {
+        const uint64_t total = std::accumulate(samples.begin(), samples.end(), uint64_t{0});
+        std::string members = "\"count\": " + std::to_string(samples.size()) +
+                              ", \"meanNs\": " + std::to_string(samples.empty() ? 0 : total / samples.size());
+        if (!samples.empty()) {
+            members += ", \"p50Ns\": " + std::to_string(GetPercentile(samples, 0.5)) +
+                       ", \"p99Ns\": " + std::to_string(GetPercentile(samples, 0.99)) +
+                       ", \"p999Ns\": " + std::to_string(GetPercentile(samples, 0.999)) +
+                       ", \"maxNs\": " + std::to_string(GetPercentile(samples, 1.0));
+        }
+        return members;
+    }
+
+} // namespace vulkan_d3d12_interop::test
@@ -0,0 +1,123 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Check the format registry against the real enum values, without any of the Windows headers.
+
+#include "format_enums.h"
+
+#include <formats.h>
+
+#include <cstdio>
+#include <iterator>
+
+using namespace vulkan_d3d12_interop::util;
+
+namespace {
+
+    int g_failures = 0;
+
+#define CHECK(condition)                                                                                               \
+    do {                                                                                                               \
+        if (!(condition)) {                                                                                            \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);                         \
+            g_failures++;                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+    bool HaveSameLayout(const FormatInfo& a, const FormatInfo& b) {
+        return a.blockWidth == b.blockWidth && a.blockHeight == b.blockHeight && a.bytesPerBlock == b.bytesPerBlock;
+    }
+
+    void TestRoundTrips() {
+        for (const FormatInfo& format : Formats) {
+            CHECK(GetFormatInfo(format.dxgi) == &format);
+
+            if (format.vk != VK_FORMAT_UNDEFINED) {
+                const FormatInfo* const reverse = GetFormatInfoFromVk(format.vk);
+                CHECK(reverse && reverse->vk == format.vk && HaveSameLayout(*reverse, format));
+            }
+            if (format.gl) {
+                const FormatInfo* const reverse = GetFormatInfoFromGl(format.gl);
+                CHECK(reverse && reverse->gl == format.gl && HaveSameLayout(*reverse, format));
+            }
+        }
+    }
+
+    void TestLookups() {
+        CHECK(GetFormatInfo(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)->vk == VK_FORMAT_R8G8B8A8_SRGB);
+        CHECK(GetFormatInfo(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)->gl == GL_SRGB8_ALPHA8);
+        CHECK(GetFormatInfoFromVk(VK_FORMAT_B8G8R8A8_UNORM)->dxgi == DXGI_FORMAT_B8G8R8A8_UNORM);
+        CHECK(GetFormatInfoFromVk(VK_FORMAT_D32_SFLOAT_S8_UINT)->dxgi == DXGI_FORMAT_D32_FLOAT_S8X24_UINT);
+        CHECK(GetFormatInfoFromVk(VK_FORMAT_A4R4G4B4_UNORM_PACK16_EXT)->dxgi == DXGI_FORMAT_B4G4R4A4_UNORM);
+        CHECK(GetFormatInfoFromGl(GL_RGBA8)->dxgi == DXGI_FORMAT_R8G8B8A8_UNORM);
+        CHECK(GetFormatInfoFromGl(GL_RGB10_A2)->dxgi == DXGI_FORMAT_R10G10B10A2_UNORM);
+        CHECK(GetFormatInfoFromGl(GL_DEPTH24_STENCIL8)->aspects ==
+              (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT));
+        CHECK(GetFormatInfoFromGl(GL_DEPTH_COMPONENT16)->dxgi == DXGI_FORMAT_R16_TYPELESS);
+
+        CHECK(!GetFormatInfo(DXGI_FORMAT_UNKNOWN));
+        CHECK(!GetFormatInfo(DXGI_FORMAT_NV12));
+        CHECK(!GetFormatInfo((DXGI_FORMAT)1000));
+        CHECK(!GetFormatInfoFromVk(VK_FORMAT_UNDEFINED));
+        CHECK(!GetFormatInfoFromVk((VkFormat)1000156002));
+        CHECK(!GetFormatInfoFromGl(0));
+        CHECK(!GetFormatInfoFromGl(GL_RGBA16_SNORM));
+    }
+
+    // Y410 packs its 10-bit components like R10G10B10A2, and must not translate to a format with a different layout.
+    void TestY410() {
+        const FormatInfo* const y410 = GetFormatInfo(DXGI_FORMAT_Y410);
+        CHECK(y410 && y410->vk == VK_FORMAT_A2B10G10R10_UNORM_PACK32 && y410->bytesPerBlock == 4);
+
+        const FormatInfo* const reverse = GetFormatInfoFromVk(VK_FORMAT_A2B10G10R10_UNORM_PACK32);
+        CHECK(reverse && reverse->dxgi == DXGI_FORMAT_R10G10B10A2_UNORM && HaveSameLayout(*reverse, *y410));
+    }
+
+    void TestViewCompatibility() {
+        CHECK(AreFormatsViewCompatible(*GetFormatInfo(DXGI_FORMAT_R8G8B8A8_UNORM),
+                                       *GetFormatInfo(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)));
+        CHECK(!AreFormatsViewCompatible(*GetFormatInfo(DXGI_FORMAT_R8G8B8A8_UNORM),
+                                        *GetFormatInfo(DXGI_FORMAT_B8G8R8A8_UNORM)));
+        CHECK(!AreFormatsViewCompatible(*GetFormatInfo(DXGI_FORMAT_AYUV), *GetFormatInfo(DXGI_FORMAT_Y410)));
+    }
+
+    void TestRegionSize() {
+        CHECK(GetRegionSize(*GetFormatInfo(DXGI_FORMAT_R8G8B8A8_UNORM), 1920, 1080) == 1920ull * 1080 * 4);
+        CHECK(GetRegionSize(*GetFormatInfo(DXGI_FORMAT_BC7_UNORM), 5, 3) == 2 * 1 * 16);
+        CHECK(GetRegionSize(*GetFormatInfo(DXGI_FORMAT_BC4_UNORM), 4, 4) == 8);
+        CHECK(GetRegionSize(*GetFormatInfo(DXGI_FORMAT_YUY2), 3, 2) == 2 * 2 * 4);
+        CHECK(GetRegionSize(*GetFormatInfo(DXGI_FORMAT_420_OPAQUE), 4, 4) == 4 * 6);
+        CHECK(GetRegionSize(*GetFormatInfo(DXGI_FORMAT_R32G32B32A32_FLOAT), 65536, 65536) == 65536ull * 65536 * 16);
+    }
+
+} // namespace
+
+int main() {
+    TestRoundTrips();
+    TestLookups();
+    TestY410();
+    TestViewCompatibility();
+    TestRegionSize();
+
+    std::printf("%zu formats, %d failure(s)\n", std::size(Formats), g_failures);
+    return g_failures ? 1 : 0;
+}
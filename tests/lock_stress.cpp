@@ -0,0 +1,758 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Drives the locking protocol of the layer with the threads of a typical application, and measures the throughput,
+// the latency of each entry point, and the wait and hold times of each lock per entry point.
+//
+// Usage: lock_stress [--threads 1,2,4,8] [--swapchains 4,16] [--duration <ms>] [--latency <call>=<ns>]...
+//                    [--no-quads] [--output <file.json>]
+//
+// The application has a number of render threads, each acquiring, waiting for and releasing its share of the
+// projection swapchains in a loop, a main thread submitting all the swapchains with xrEndFrame(), and a loader thread
+// creating quad swapchains, rendering to them once, submitting them for a few frames and destroying them. The
+// configurations with more render threads than swapchains are skipped.
+//
+// The layer is layer.cpp reduced to its locks and to the frame state they protect, with the same HandleRegistry and
+// InstrumentedMutex: the registry lock (shared for lookups, exclusive to insert and remove), then the session lock,
+// then the swapchain lock. The locks are released around the calls to the runtime, after which the swapchain is looked
+// up again by its epoch. The runtime spins for the latency of each call (none by default) and reuses the handles of
+// the destroyed swapchains. Any inconsistency of the frame state fails the run, which is best run under
+// ThreadSanitizer too (-DSANITIZE=thread).
+
+#include <latency.h>
+#include <registry.h>
+#include <sync.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace vulkan_d3d12_interop;
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+    using Handle = uint64_t;
+
+    // The entry points of the layer that the application calls.
+    enum class Call {
+        CreateSwapchain,
+        DestroySwapchain,
+        AcquireSwapchainImage,
+        WaitSwapchainImage,
+        ReleaseSwapchainImage,
+        EndFrame,
+
+        Count
+    };
+    constexpr const char* CallNames[] = {"xrCreateSwapchain",
+                                         "xrDestroySwapchain",
+                                         "xrAcquireSwapchainImage",
+                                         "xrWaitSwapchainImage",
+                                         "xrReleaseSwapchainImage",
+                                         "xrEndFrame"};
+    static_assert(std::size(CallNames) == (size_t)Call::Count);
+
+    enum class Lock { Registry, Session, Swapchain, Count };
+    constexpr const char* LockNames[] = {"Registry", "Session", "Swapchain"};
+    static_assert(std::size(LockNames) == (size_t)Lock::Count);
+
+    constexpr uint32_t ImageCount = 3;
+
+    // The number of frames that a quad swapchain is submitted for.
+    constexpr uint64_t QuadFrameCount = 4;
+
+    std::atomic<uint64_t> g_violations{0};
+
+#define CHECK_STATE(condition)                                                                                         \
+    do {                                                                                                               \
+        if (!(condition)) {                                                                                            \
+            std::fprintf(stderr, "%s:%d: CHECK_STATE(%s) failed\n", __FILE__, __LINE__, #condition);                   \
+            g_violations++;                                                                                            \
+        }                                                                                                              \
+    } while (0)
+
+    uint64_t GetElapsedNs(Clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    void Spin(std::chrono::nanoseconds duration) {
+        if (duration.count()) {
+            const auto end = Clock::now() + duration;
+            while (Clock::now() < end) {
+            }
+        }
+    }
+
+    // A runtime that hands out handles and image indices after spinning for the latency of each call.
+    class StubRuntime {
+      public:
+        StubRuntime(const std::array<std::chrono::nanoseconds, (size_t)Call::Count>& latencies)
+            : m_latencies(latencies) {
+        }
+
+        // The handles of the destroyed swapchains are reused first.
+        Handle createSwapchain() {
+            Spin(m_latencies[(size_t)Call::CreateSwapchain]);
+            std::unique_lock lock(m_mutex);
+            if (m_freeHandles.empty()) {
+                return ++m_lastHandle;
+            }
+            const Handle handle = m_freeHandles.back();
+            m_freeHandles.pop_back();
+            return handle;
+        }
+
+        void destroySwapchain(Handle swapchain) {
+            Spin(m_latencies[(size_t)Call::DestroySwapchain]);
+            std::unique_lock lock(m_mutex);
+            m_freeHandles.push_back(swapchain);
+        }
+
+        uint32_t acquireSwapchainImage() {
+            Spin(m_latencies[(size_t)Call::AcquireSwapchainImage]);
+            return m_nextIndex.fetch_add(1, std::memory_order_relaxed) % ImageCount;
+        }
+
+        void waitSwapchainImage() {
+            Spin(m_latencies[(size_t)Call::WaitSwapchainImage]);
+        }
+
+        void releaseSwapchainImage() {
+            Spin(m_latencies[(size_t)Call::ReleaseSwapchainImage]);
+        }
+
+        void endFrame() {
+            Spin(m_latencies[(size_t)Call::EndFrame]);
+        }
+
+      private:
+        const std::array<std::chrono::nanoseconds, (size_t)Call::Count> m_latencies;
+
+        std::mutex m_mutex;
+        Handle m_lastHandle{0};
+        std::vector<Handle> m_freeHandles;
+        std::atomic<uint32_t> m_nextIndex{0};
+    };
+
+    // The latency of an entry point, and the time it spent waiting for and holding each lock.
+    struct CallStatistics {
+        util::LatencyHistogram latency;
+        std::array<util::LatencyHistogram, (size_t)Lock::Count> wait;
+        std::array<util::LatencyHistogram, (size_t)Lock::Count> hold;
+    };
+
+    // A lock guard attributing the wait and hold times to an entry point (InstrumentedMutex only keeps them per lock).
+    template <typename Mutex>
+    class TimedLock {
+      public:
+        TimedLock(Mutex& mutex, CallStatistics& statistics, Lock lock, bool shared = false)
+            : m_mutex(mutex), m_statistics(statistics), m_lock((size_t)lock), m_shared(shared) {
+            const auto start = Clock::now();
+            if (m_shared) {
+                if constexpr (std::is_same_v<Mutex, util::InstrumentedMutex<std::shared_mutex>>) {
+                    m_mutex.lock_shared();
+                }
+            } else {
+                m_mutex.lock();
+            }
+            m_acquiredTime = Clock::now();
+            m_statistics.wait[m_lock].record(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(m_acquiredTime - start).count());
+        }
+
+        ~TimedLock() {
+            m_statistics.hold[m_lock].record(GetElapsedNs(m_acquiredTime));
+            if (m_shared) {
+                if constexpr (std::is_same_v<Mutex, util::InstrumentedMutex<std::shared_mutex>>) {
+                    m_mutex.unlock_shared();
+                }
+            } else {
+                m_mutex.unlock();
+            }
+        }
+
+        TimedLock(const TimedLock&) = delete;
+        TimedLock& operator=(const TimedLock&) = delete;
+
+      private:
+        Mutex& m_mutex;
+        CallStatistics& m_statistics;
+        const size_t m_lock;
+        const bool m_shared;
+        Clock::time_point m_acquiredTime;
+    };
+
+    // The locking protocol of layer.cpp, over the frame state of the swapchains.
+    class Layer {
+      public:
+        using Mutex = util::InstrumentedMutex<std::mutex>;
+        using RegistryMutex = util::InstrumentedMutex<std::shared_mutex>;
+
+        Layer(StubRuntime& runtime) : m_runtime(runtime) {
+            m_registryLock.setStatistics(&m_lockStatistics[(size_t)Lock::Registry]);
+        }
+
+        Handle createSession() {
+            auto newSession = std::make_unique<Session>();
+            newSession->mutex.setStatistics(&m_lockStatistics[(size_t)Lock::Session]);
+
+            std::unique_lock registryLock(m_registryLock);
+            newSession->epoch = ++m_sessionEpoch;
+            const Handle session = ++m_lastSessionHandle;
+            m_sessions.insert(session, std::move(newSession));
+            return session;
+        }
+
+        void destroySession(Handle session) {
+            std::unique_lock registryLock(m_registryLock);
+            CHECK_STATE(m_swapchains.collect([&](const Swapchain& swapchain) {
+                                        return swapchain.frame.session == m_sessions.find(session);
+                                    }).empty());
+            m_sessions.erase(session);
+        }
+
+        // The registry is only updated once the runtime created the swapchain, and only if the session still exists.
+        Handle createSwapchain(Handle session) {
+            CallStatistics& statistics = m_calls[(size_t)Call::CreateSwapchain];
+            const auto start = Clock::now();
+
+            auto newSwapchain = std::make_unique<Swapchain>();
+            newSwapchain->mutex.setStatistics(&m_lockStatistics[(size_t)Lock::Swapchain]);
+            uint64_t sessionEpoch = 0;
+            {
+                TimedLock registryLock(m_registryLock, statistics, Lock::Registry, true);
+                Session* sessionState = m_sessions.find(session);
+                CHECK_STATE(sessionState);
+                if (sessionState) {
+                    newSwapchain->frame.session = sessionState;
+                    sessionEpoch = sessionState->epoch;
+                }
+            }
+
+            const Handle swapchain = m_runtime.createSwapchain();
+            {
+                TimedLock registryLock(m_registryLock, statistics, Lock::Registry);
+                CHECK_STATE(!m_swapchains.find(swapchain));
+                if (findSession(session, sessionEpoch)) {
+                    newSwapchain->epoch = ++m_swapchainEpoch;
+                    m_swapchains.insert(swapchain, std::move(newSwapchain));
+                }
+            }
+
+            statistics.latency.record(GetElapsedNs(start));
+            return swapchain;
+        }
+
+        // The state is removed from the registry once the runtime destroyed the swapchain, and retired to the session.
+        void destroySwapchain(Handle swapchain) {
+            CallStatistics& statistics = m_calls[(size_t)Call::DestroySwapchain];
+            const auto start = Clock::now();
+
+            m_runtime.destroySwapchain(swapchain);
+
+            std::unique_ptr<Swapchain> swapchainState;
+            {
+                TimedLock registryLock(m_registryLock, statistics, Lock::Registry);
+                swapchainState = m_swapchains.erase(swapchain);
+            }
+            CHECK_STATE(swapchainState);
+            if (swapchainState) {
+                TimedLock registryLock(m_registryLock, statistics, Lock::Registry, true);
+                Session& sessionState = *swapchainState->frame.session;
+                TimedLock sessionLock(sessionState.mutex, statistics, Lock::Session);
+                sessionState.retiredSwapchains.push_back(std::move(swapchainState));
+            }
+
+            statistics.latency.record(GetElapsedNs(start));
+        }
+
+        uint32_t acquireSwapchainImage(Handle swapchain) {
+            CallStatistics& statistics = m_calls[(size_t)Call::AcquireSwapchainImage];
+            const auto start = Clock::now();
+
+            uint64_t epoch = 0;
+            {
+                TimedLock registryLock(m_registryLock, statistics, Lock::Registry, true);
+                Swapchain* swapchainState = m_swapchains.find(swapchain);
+                CHECK_STATE(swapchainState);
+                if (swapchainState) {
+                    epoch = swapchainState->epoch;
+                    TimedLock lock(swapchainState->mutex, statistics, Lock::Swapchain);
+                    swapchainState->frame.usedSinceLastPoll = true;
+                }
+            }
+
+            const uint32_t index = m_runtime.acquireSwapchainImage();
+
+            if (epoch) {
+                TimedLock registryLock(m_registryLock, statistics, Lock::Registry, true);
+                Swapchain* swapchainState = findSwapchain(swapchain, epoch);
+                CHECK_STATE(swapchainState);
+                if (swapchainState) {
+                    TimedLock lock(swapchainState->mutex, statistics, Lock::Swapchain);
+                    auto& frame = swapchainState->frame;
+                    CHECK_STATE(frame.acquiredCount < ImageCount);
+                    if (frame.acquiredCount < ImageCount) {
+                        frame.acquiredIndex[(frame.acquiredHead + frame.acquiredCount++) % ImageCount] = index;
+                    }
+                }
+            }
+
+            statistics.latency.record(GetElapsedNs(start));
+            return index;
+        }
+
+        void waitSwapchainImage(Handle swapchain) {
+            CallStatistics& statistics = m_calls[(size_t)Call::WaitSwapchainImage];
+            const auto start = Clock::now();
+
+            uint64_t epoch = 0;
+            {
+                TimedLock registryLock(m_registryLock, statistics, Lock::Registry, true);
+                Swapchain* swapchainState = m_swapchains.find(swapchain);
+                CHECK_STATE(swapchainState);
+                if (swapchainState) {
+                    TimedLock lock(swapchainState->mutex, statistics, Lock::Swapchain);
+                    CHECK_STATE(swapchainState->frame.waitedCount < swapchainState->frame.acquiredCount);
+                    epoch = swapchainState->epoch;
+                }
+            }
+
+            m_runtime.waitSwapchainImage();
+
+            if (epoch) {
+                TimedLock registryLock(m_registryLock, statistics, Lock::Registry, true);
+                Swapchain* swapchainState = findSwapchain(swapchain, epoch);
+                CHECK_STATE(swapchainState);
+                if (swapchainState) {
+                    TimedLock lock(swapchainState->mutex, statistics, Lock::Swapchain);
+                    swapchainState->frame.waitedCount++;
+                }
+            }
+
+            statistics.latency.record(GetElapsedNs(start));
+        }
+
+        void releaseSwapchainImage(Handle swapchain) {
+            CallStatistics& statistics = m_calls[(size_t)Call::ReleaseSwapchainImage];
+            const auto start = Clock::now();
+
+            uint64_t epoch = 0;
+            {
+                TimedLock registryLock(m_registryLock, statistics, Lock::Registry, true);
+                Swapchain* swapchainState = m_swapchains.find(swapchain);
+                CHECK_STATE(swapchainState);
+                if (swapchainState) {
+                    epoch = swapchainState->epoch;
+                    TimedLock lock(swapchainState->mutex, statistics, Lock::Swapchain);
+                    CHECK_STATE(swapchainState->frame.waitedCount && swapchainState->frame.acquiredCount);
+                }
+            }
+
+            m_runtime.releaseSwapchainImage();
+
+            if (epoch) {
+                TimedLock registryLock(m_registryLock, statistics, Lock::Registry, true);
+                Swapchain* swapchainState = findSwapchain(swapchain, epoch);
+                CHECK_STATE(swapchainState);
+                if (swapchainState) {
+                    TimedLock lock(swapchainState->mutex, statistics, Lock::Swapchain);
+                    auto& frame = swapchainState->frame;
+                    if (frame.acquiredCount) {
+                        frame.lastReleasedIndex = frame.acquiredIndex[frame.acquiredHead];
+                        frame.acquiredHead = (frame.acquiredHead + 1) % ImageCount;
+                        frame.acquiredCount--;
+                        frame.waitedCount = frame.waitedCount ? frame.waitedCount - 1 : 0;
+                        frame.generation++;
+                    }
+                }
+            }
+
+            statistics.latency.record(GetElapsedNs(start));
+        }
+
+        // The session lock is held while gathering the swapchains of the frame, but neither the session nor the
+        // registry lock is held while calling the runtime.
+        void endFrame(Handle session, const std::vector<Handle>& swapchains) {
+            CallStatistics& statistics = m_calls[(size_t)Call::EndFrame];
+            const auto start = Clock::now();
+
+            {
+                TimedLock registryLock(m_registryLock, statistics, Lock::Registry, true);
+                Session* sessionState = m_sessions.find(session);
+                CHECK_STATE(sessionState);
+                if (sessionState) {
+                    TimedLock sessionLock(sessionState->mutex, statistics, Lock::Session);
+                    for (const Handle swapchain : swapchains) {
+                        Swapchain* swapchainState = m_swapchains.find(swapchain);
+                        CHECK_STATE(swapchainState);
+                        if (swapchainState) {
+                            TimedLock swapchainLock(swapchainState->mutex, statistics, Lock::Swapchain);
+                            auto& frame = swapchainState->frame;
+                            CHECK_STATE(frame.session == sessionState);
+                            CHECK_STATE(frame.lastReleasedIndex < ImageCount);
+                            CHECK_STATE(frame.submittedGeneration <= frame.generation);
+                            frame.submittedGeneration = frame.generation;
+                            frame.usedSinceLastPoll = true;
+                        }
+                    }
+
+                    // The retired swapchains are released once the runtime is done with them.
+                    sessionState->retiredSwapchains.clear();
+                    sessionState->frameCount++;
+                }
+            }
+
+            m_runtime.endFrame();
+
+            statistics.latency.record(GetElapsedNs(start));
+        }
+
+        CallStatistics& getCallStatistics(Call call) {
+            return m_calls[(size_t)call];
+        }
+
+        const util::LockStatistics& getLockStatistics(Lock lock) const {
+            return m_lockStatistics[(size_t)lock];
+        }
+
+        size_t getSwapchainCount() const {
+            std::shared_lock registryLock(m_registryLock);
+            return m_swapchains.size();
+        }
+
+      private:
+        struct Swapchain;
+
+        struct Session {
+            Mutex mutex;
+            uint64_t frameCount{0};
+            std::vector<std::unique_ptr<Swapchain>> retiredSwapchains;
+            uint64_t epoch{0};
+        };
+
+        struct Swapchain {
+            Mutex mutex;
+            struct {
+                Session* session{nullptr};
+                uint32_t lastReleasedIndex{0};
+                uint32_t acquiredHead{0};
+                uint32_t acquiredCount{0};
+                uint32_t waitedCount{0};
+                std::array<uint32_t, ImageCount> acquiredIndex{};
+                uint64_t generation{0};
+                uint64_t submittedGeneration{0};
+                bool usedSinceLastPoll{false};
+            } frame;
+            uint64_t epoch{0};
+        };
+
+        Swapchain* findSwapchain(Handle swapchain, uint64_t epoch) const {
+            Swapchain* swapchainState = m_swapchains.find(swapchain);
+            return swapchainState && swapchainState->epoch == epoch ? swapchainState : nullptr;
+        }
+
+        Session* findSession(Handle session, uint64_t epoch) const {
+            Session* sessionState = m_sessions.find(session);
+            return sessionState && sessionState->epoch == epoch ? sessionState : nullptr;
+        }
+
+        StubRuntime& m_runtime;
+
+        util::HandleRegistry<Handle, Session> m_sessions;
+        util::HandleRegistry<Handle, Swapchain> m_swapchains;
+        mutable RegistryMutex m_registryLock;
+        uint64_t m_sessionEpoch{0};
+        uint64_t m_swapchainEpoch{0};
+        Handle m_lastSessionHandle{0};
+
+        std::array<util::LockStatistics, (size_t)Lock::Count> m_lockStatistics;
+        std::array<CallStatistics, (size_t)Call::Count> m_calls;
+    };
+
+    struct Options {
+        std::vector<size_t> threadCounts{1, 2, 4, 8};
+        std::vector<size_t> swapchainCounts{4, 16};
+        std::chrono::milliseconds duration{1000};
+        std::array<std::chrono::nanoseconds, (size_t)Call::Count> latencies{};
+        bool quads{true};
+        std::string output;
+    };
+
+    struct Configuration {
+        size_t threadCount;
+        size_t swapchainCount;
+    };
+
+    std::vector<size_t> parseList(const std::string& value) {
+        std::vector<size_t> list;
+        std::stringstream stream(value);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            list.push_back(std::stoul(item));
+        }
+        if (list.empty()) {
+            throw std::invalid_argument("Empty list: " + value);
+        }
+        return list;
+    }
+
+    Options parseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg(argv[i]);
+            if (arg == "--no-quads") {
+                options.quads = false;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + std::string(arg));
+            }
+            const std::string value(argv[++i]);
+            if (arg == "--threads") {
+                options.threadCounts = parseList(value);
+            } else if (arg == "--swapchains") {
+                options.swapchainCounts = parseList(value);
+            } else if (arg == "--duration") {
+                options.duration = std::chrono::milliseconds(std::stoul(value));
+            } else if (arg == "--latency") {
+                const size_t separator = value.find('=');
+                const std::string name = value.substr(0, separator);
+                size_t call = 0;
+                while (call < (size_t)Call::Count && name != CallNames[call]) {
+                    call++;
+                }
+                if (separator == std::string::npos || call == (size_t)Call::Count) {
+                    throw std::invalid_argument("Invalid latency: " + value);
+                }
+                options.latencies[call] = std::chrono::nanoseconds(std::stoull(value.substr(separator + 1)));
+            } else if (arg == "--output") {
+                options.output = value;
+            } else {
+                throw std::invalid_argument("Unknown option: " + std::string(arg));
+            }
+        }
+        return options;
+    }
+
+    std::string formatHistogram(const util::LatencyHistogram& histogram) {
+        return "{\"count\": " + std::to_string(histogram.getCount()) +
+               ", \"p50Ns\": " + std::to_string(histogram.getPercentile(0.5)) +
+               ", \"p99Ns\": " + std::to_string(histogram.getPercentile(0.99)) +
+               ", \"p999Ns\": " + std::to_string(histogram.getPercentile(0.999)) + "}";
+    }
+
+    // Run the threads of the application for the duration, and return the results as a JSON object.
+    std::string run(const Options& options, const Configuration& configuration) {
+        StubRuntime runtime(options.latencies);
+        Layer layer(runtime);
+
+        const Handle session = layer.createSession();
+        std::vector<Handle> projections;
+        for (size_t i = 0; i < configuration.swapchainCount; i++) {
+            projections.push_back(layer.createSwapchain(session));
+        }
+
+        // The quad swapchains being submitted, shared by the loader and main threads.
+        std::mutex quadsMutex;
+        std::vector<Handle> quads;
+
+        std::atomic<bool> stop{false};
+        std::atomic<bool> mainThreadDone{false};
+        std::atomic<uint64_t> frameCount{0};
+        std::atomic<uint64_t> renderCount{0};
+        std::atomic<uint64_t> quadCount{0};
+
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < configuration.threadCount; t++) {
+            threads.emplace_back([&, t] {
+                uint64_t count = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    for (size_t i = t; i < projections.size(); i += configuration.threadCount) {
+                        layer.acquireSwapchainImage(projections[i]);
+                        layer.waitSwapchainImage(projections[i]);
+                        layer.releaseSwapchainImage(projections[i]);
+                        count++;
+                    }
+                }
+                renderCount += count;
+            });
+        }
+
+        threads.emplace_back([&] {
+            std::vector<Handle> swapchains;
+            while (!stop.load(std::memory_order_relaxed)) {
+                swapchains = projections;
+                {
+                    std::unique_lock lock(quadsMutex);
+                    swapchains.insert(swapchains.end(), quads.begin(), quads.end());
+                }
+                layer.endFrame(session, swapchains);
+                frameCount++;
+            }
+            mainThreadDone = true;
+        });
+
+        if (options.quads) {
+            threads.emplace_back([&] {
+                // A quad swapchain is destroyed once no frame in progress might be submitting it.
+                const auto waitForFrames = [&](uint64_t count) {
+                    const uint64_t target = frameCount + count;
+                    while (frameCount < target && !mainThreadDone) {
+                        std::this_thread::yield();
+                    }
+                };
+
+                while (!stop.load(std::memory_order_relaxed)) {
+                    const Handle quad = layer.createSwapchain(session);
+                    layer.acquireSwapchainImage(quad);
+                    layer.waitSwapchainImage(quad);
+                    layer.releaseSwapchainImage(quad);
+                    {
+                        std::unique_lock lock(quadsMutex);
+                        quads.push_back(quad);
+                    }
+                    waitForFrames(QuadFrameCount);
+                    {
+                        std::unique_lock lock(quadsMutex);
+                        quads.erase(std::find(quads.begin(), quads.end(), quad));
+                    }
+                    waitForFrames(1);
+                    layer.destroySwapchain(quad);
+                    quadCount++;
+                }
+            });
+        }
+
+        const auto start = Clock::now();
+        std::this_thread::sleep_for(options.duration);
+        stop = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        for (const Handle projection : projections) {
+            layer.destroySwapchain(projection);
+        }
+        CHECK_STATE(layer.getSwapchainCount() == 0);
+        layer.destroySession(session);
+
+        std::stringstream result;
+        result << "    {\"threads\": " << configuration.threadCount
+               << ", \"swapchains\": " << configuration.swapchainCount
+               << ", \"quads\": " << (options.quads ? "true" : "false") << ", \"frames\": " << frameCount
+               << ", \"framesPerSecond\": " << (uint64_t)(frameCount / seconds)
+               << ", \"rendersPerSecond\": " << (uint64_t)(renderCount / seconds)
+               << ", \"quadSwapchains\": " << quadCount << ",\n     \"calls\": [";
+        for (size_t call = 0; call < (size_t)Call::Count; call++) {
+            const CallStatistics& statistics = layer.getCallStatistics((Call)call);
+            if (!statistics.latency.getCount()) {
+                continue;
+            }
+            result << (call ? "," : "") << "\n      {\"call\": \"" << CallNames[call]
+                   << "\", \"latency\": " << formatHistogram(statistics.latency) << ", \"locks\": [";
+            bool first = true;
+            for (size_t lock = 0; lock < (size_t)Lock::Count; lock++) {
+                if (!statistics.wait[lock].getCount()) {
+                    continue;
+                }
+                result << (first ? "" : ", ") << "\n        {\"lock\": \"" << LockNames[lock]
+                       << "\", \"wait\": " << formatHistogram(statistics.wait[lock])
+                       << ", \"hold\": " << formatHistogram(statistics.hold[lock]) << "}";
+                first = false;
+            }
+            result << "]}";
+        }
+        result << "],\n     \"locks\": [";
+        for (size_t lock = 0; lock < (size_t)Lock::Count; lock++) {
+            const util::LockStatistics& statistics = layer.getLockStatistics((Lock)lock);
+            result << (lock ? "," : "") << "\n      {\"lock\": \"" << LockNames[lock]
+                   << "\", \"contended\": " << statistics.contendedCount.load()
+                   << ", \"wait\": " << formatHistogram(statistics.wait)
+                   << ", \"hold\": " << formatHistogram(statistics.hold)
+                   << ", \"sharedHold\": " << formatHistogram(statistics.sharedHold) << "}";
+        }
+        result << "]}";
+
+        std::cerr << configuration.threadCount << " threads, " << configuration.swapchainCount << " swapchains: "
+                  << (uint64_t)(frameCount / seconds) << " frames/s, " << (uint64_t)(renderCount / seconds)
+                  << " renders/s\n";
+        return result.str();
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        const Options options = parseOptions(argc, argv);
+
+        std::vector<std::string> results;
+        for (const size_t swapchainCount : options.swapchainCounts) {
+            for (const size_t threadCount : options.threadCounts) {
+                if (threadCount && threadCount <= swapchainCount) {
+                    results.push_back(run(options, {threadCount, swapchainCount}));
+                }
+            }
+        }
+
+        std::ofstream outputFile;
+        if (!options.output.empty()) {
+            outputFile.open(options.output, std::ios_base::trunc);
+            if (!outputFile.is_open()) {
+                throw std::runtime_error("Cannot open " + options.output);
+            }
+        }
+        std::ostream& out = outputFile.is_open() ? outputFile : std::cout;
+
+        out << "{\n  \"durationMs\": " << options.duration.count() << ",\n  \"runtimeLatencyNs\": {";
+        for (size_t call = 0; call < (size_t)Call::Count; call++) {
+            out << (call ? ", " : "") << "\"" << CallNames[call] << "\": " << options.latencies[call].count();
+        }
+        out << "},\n  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            out << results[i] << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "  ]\n}\n";
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Failed to write the results");
+        }
+    } catch (std::exception& exc) {
+        std::cerr << exc.what() << "\n";
+        return 1;
+    }
+
+    if (g_violations) {
+        std::cerr << g_violations << " inconsistencies of the frame state\n";
+        return 1;
+    }
+    return 0;
+}